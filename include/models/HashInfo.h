@@ -3,12 +3,17 @@
 
 #include <string>
 
+// Contents of ISOBOOTHASH, one field per line in this order. Files written by earlier versions stop after
+// driversInjected or verifiedBy; the missing fields read back empty.
 struct HashInfo {
-    std::string hash;
+    std::string hash; // full-content digest of the image, in algorithm
     std::string version;
     std::string mode;
     std::string format;
     std::string driversInjected; // "1" = drivers injected, "0" = no drivers
+    std::string fingerprint;     // ISOFingerprint of the image
+    std::string verifiedBy;      // which of the two the skip-copy check compares: "fingerprint" or "hash"
+    std::string algorithm;       // StreamHasher::name of hash's algorithm; empty means "md5"
 };
 
 #endif // HASHINFO_H
@@ -1,5 +1,9 @@
 // Define 7-Zip interface GUIDs explicitly to avoid INITGUID conflicts with Windows headers
+#ifdef _WIN32
 #include <guiddef.h>
+#else
+#include "Common/MyWindows.h"
+#endif
 
 // Base GUID parts used by 7-Zip
 #define Z7_DATA1 0x23170F69
@@ -7,6 +11,11 @@
 #define Z7_DATA3 0x278A
 
 extern "C" {
+#ifndef _WIN32
+// Windows links IID_IUnknown from uuid.lib; the portable builds (benchmarks) have to define it themselves
+const GUID IID_IUnknown = {0x00000000, 0x0000, 0x0000, {0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46}};
+#endif
+
 // IProgress (group=0, sub=5)
 GUID IID_IProgress = {Z7_DATA1, Z7_DATA2, Z7_DATA3, {0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00}};
 
@@ -5,7 +5,6 @@
 #include "../utils/Utils.h"
 #include "../utils/LocalizationHelpers.h"
 #include <windows.h>
-#include <filesystem>
 #include <algorithm>
 
 IniFileProcessor::IniFileProcessor(IniConfigurator &iniConfigurator) : iniConfigurator_(iniConfigurator) {}
@@ -65,23 +64,6 @@ int IniFileProcessor::extractAndProcessIniFilesFromIso(const std::string &mountD
     if (iniFiles.empty())
         return 0;
 
-    // Create temporary directory for INI file caching
-    std::filesystem::path tempIniDir;
-    bool                  tempDirAvailable = true;
-
-    try {
-        std::ostringstream tempDirName;
-        tempDirName << "EasyISOBoot_ini_cache_" << reinterpret_cast<uintptr_t>(this);
-        tempIniDir = std::filesystem::temp_directory_path() / tempDirName.str();
-
-        std::error_code dirEc;
-        std::filesystem::create_directories(tempIniDir, dirEc);
-        if (dirEc)
-            tempDirAvailable = false;
-    } catch (const std::exception &) {
-        tempDirAvailable = false;
-    }
-
     int processedCount = 0;
 
     for (const auto &entry : iniFiles) {
@@ -98,27 +80,14 @@ int IniFileProcessor::extractAndProcessIniFilesFromIso(const std::string &mountD
         std::string iniDest   = mountDir + "\\" + iniName;
         bool        processed = false;
 
-        if (tempDirAvailable) {
-            std::filesystem::path tempIniPath = tempIniDir / iniName;
-
-            // Remove existing temp file
-            std::error_code remEc;
-            std::filesystem::remove(tempIniPath, remEc);
-
-            // Extract to temp
-            if (isoReader->extractFile(isoPath, isoPathInArchive, tempIniPath.u8string())) {
-                // Process and copy to destination
-                if (iniConfigurator_.processIniFile(tempIniPath.u8string(), iniDest, driveLetter)) {
-                    logFile << ISOCopyManager::getTimestamp() << iniName
-                            << " processed and copied to boot.wim successfully" << std::endl;
-                    processed = true;
-                    processedCount++;
-                }
-            }
-
-            // Cleanup temp file
-            std::error_code cleanupEc;
-            std::filesystem::remove(tempIniPath, cleanupEc);
+        // Decode in memory and write the processed content straight to the mount
+        std::string content;
+        if (isoReader->readFileToBuffer(isoPath, isoPathInArchive, content) &&
+            iniConfigurator_.processIniContent(content, iniDest, driveLetter)) {
+            logFile << ISOCopyManager::getTimestamp() << iniName << " processed and copied to boot.wim successfully"
+                    << std::endl;
+            processed = true;
+            processedCount++;
         }
 
         // Fallback: direct extraction without processing
@@ -134,12 +103,6 @@ int IniFileProcessor::extractAndProcessIniFilesFromIso(const std::string &mountD
         }
     }
 
-    // Cleanup temp directory
-    if (tempDirAvailable) {
-        std::error_code cleanupDirEc;
-        std::filesystem::remove_all(tempIniDir, cleanupDirEc);
-    }
-
     return processedCount;
 }
 
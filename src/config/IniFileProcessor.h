@@ -15,7 +15,7 @@ class IniConfigurator;
  * - Extracting INI files from ISO
  * - Reconfiguring existing INI files in WIM
  * - Processing drive letter replacements
- * - Managing INI file caching and cleanup
+ * - Reading INI files from the ISO in memory (no temporary files)
  *
  * Follows Single Responsibility Principle for INI file management.
  */
@@ -110,7 +110,8 @@ void ProcessController::processInThread(const std::string &isoPath, const std::s
         LocalizedOrUtf8("log.process.verifyingPartitions", "Verificando estado de particiones...\r\n"));
     eventManager.notifyProgressUpdate(10);
 
-    auto prepareResult = processService->validateAndPrepare(isoPath, selectedFormat, skipIntegrityCheck);
+    auto prepareResult =
+        processService->validateAndPrepare(isoPath, selectedFormat, selectedBootModeKey, skipIntegrityCheck);
     if (!prepareResult.success) {
         eventManager.notifyLogUpdate("Error: " + prepareResult.errorMessage + "\r\n");
         eventManager.notifyError("Error: " + prepareResult.errorMessage);
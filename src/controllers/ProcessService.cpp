@@ -3,27 +3,38 @@
 #include "../utils/AppKeys.h"
 #include "../utils/LocalizationHelpers.h"
 #include "../../include/models/HashInfo.h"
+#include "../models/HashVerifier.h"
 #include "../models/ISOReader.h"
-#include <fstream>
+#include "../models/ISOCatalogCache.h"
+#include "../models/ExtractionJournal.h"
 #include "../utils/constants.h"
 
-static HashInfo readHashInfo(const std::string &path) {
-    HashInfo      info = {"", "", "", "", ""};
-    std::ifstream file(path);
-    if (file.is_open()) {
-        std::getline(file, info.hash);
-        std::getline(file, info.mode);
-        std::getline(file, info.format);
-        std::getline(file, info.driversInjected);
-    }
-    return info;
+// True if the volume at drive (e.g. "Z:") is formatted with format ("NTFS", "FAT32", "EXFAT")
+static bool volumeHasFormat(const std::string &drive, const std::string &format) {
+    char fsName[MAX_PATH] = {0};
+    if (!GetVolumeInformationA((drive + "\\").c_str(), NULL, 0, NULL, NULL, NULL, fsName, sizeof(fsName)))
+        return false;
+    return _stricmp(fsName, format.c_str()) == 0;
+}
+
+// True if the ISO is a Windows installation image (sources/boot.wim or install.wim/esd present)
+static bool isWindowsImage(const std::string &isoPath) {
+    ISOReader reader;
+    return reader.fileExists(isoPath, "sources/boot.wim") || reader.fileExists(isoPath, "sources/install.wim") ||
+           reader.fileExists(isoPath, "sources/install.esd");
+}
+
+// True if copyISO extracts the whole image for modeKey, which goes through ISOReader::extractDelta. RAM mode
+// only does so for non-Windows images.
+static bool extractsContent(const std::string &isoPath, const std::string &modeKey) {
+    return modeKey != AppKeys::BootModeRam || !isWindowsImage(isoPath);
 }
 
 ProcessService::ProcessService(PartitionManager *pm, ISOCopyManager *icm, BCDManager *bcm, EventManager &em)
     : partitionManager(pm), isoCopyManager(icm), bcdManager(bcm), eventManager(em), isWindowsISO(false) {}
 
 ProcessService::ProcessResult ProcessService::validateAndPrepare(const std::string &isoPath, const std::string &format,
-                                                                 bool skipIntegrityCheck) {
+                                                                 const std::string &modeKey, bool skipIntegrityCheck) {
     // CRITICAL: Check for duplicate ISOEFI partitions
     int efiCount = partitionManager->countEfiPartitions();
     if (efiCount > 1) {
@@ -79,10 +90,29 @@ ProcessService::ProcessResult ProcessService::validateAndPrepare(const std::stri
     if (partitionExists && !needsRecreation) {
         std::string partDrive = partitionManager->getPartitionDriveLetter();
         if (!partDrive.empty()) {
-            std::string hashFilePath = partDrive + "\\ISOBOOTHASH";
-            std::string md5          = Utils::calculateMD5(isoPath);
-            HashInfo    existing     = readHashInfo(hashFilePath);
-            if (existing.hash == md5 && existing.format == format && !existing.hash.empty()) {
+            std::string  hashFilePath = partDrive + "\\ISOBOOTHASH";
+            HashInfo     existing     = HashVerifier::readHashInfo(hashFilePath);
+            HashVerifier verifier;
+            // Contents worth keeping: this very image, or an interrupted extraction of it (ISOJOURNAL, which
+            // records the image and boot mode itself, as ISOBOOTHASH is only written once a run completes) or
+            // an earlier build (ISOMANIFEST) in the same boot mode when the copy that follows is an
+            // extractDelta pass, which resumes or updates them and removes what the new image no longer has.
+            // Anything else (a mode switch, a Windows image in RAM mode, a fallback ubuntu.iso copy) leaves
+            // files no manifest tracks, so the partition is reformatted.
+            auto exists = [&](const char *name) {
+                return GetFileAttributesA((partDrive + "\\" + name).c_str()) != INVALID_FILE_ATTRIBUTES;
+            };
+            ISOImageIdentity identity;
+            const bool       resumable = ISOCatalogCache::identify(isoPath, identity) &&
+                                         ExtractionJournal::describes(partDrive + "\\", identity, modeKey);
+
+            bool reusable = (resumable || (exists("ISOMANIFEST") && existing.mode == modeKey)) &&
+                            !exists("ubuntu.iso") && volumeHasFormat(partDrive, format) &&
+                            extractsContent(isoPath, modeKey);
+            // A leftover journal means the last extraction into the partition did not finish
+            bool sameImage =
+                existing.format == format && !exists("ISOJOURNAL") && verifier.matchesImage(isoPath, existing);
+            if (sameImage || reusable) {
                 // Skip format
             } else {
                 if (!partitionManager->reformatPartition(format)) {
@@ -180,10 +210,7 @@ bool ProcessService::copyISO(const std::string &isoPath, const std::string &dest
     std::string espDriveLocal = espPath;
 
     // Pre-detect if this is a Windows ISO by checking for sources/boot.wim or sources/install.wim
-    ISOReader tempReader;
-    bool      detectedWindowsISO = tempReader.fileExists(isoPath, "sources/boot.wim") ||
-                              tempReader.fileExists(isoPath, "sources/install.wim") ||
-                              tempReader.fileExists(isoPath, "sources/install.esd");
+    bool detectedWindowsISO = isWindowsImage(isoPath);
 
     this->isWindowsISO = detectedWindowsISO;
 
@@ -18,7 +18,8 @@ public:
         std::string errorMessage;
     };
 
-    ProcessResult validateAndPrepare(const std::string &isoPath, const std::string &format, bool skipIntegrityCheck);
+    ProcessResult validateAndPrepare(const std::string &isoPath, const std::string &format, const std::string &modeKey,
+                                     bool skipIntegrityCheck);
     ProcessResult copyIsoContent(const std::string &isoPath, const std::string &format, const std::string &modeKey,
                                  const std::string &modeLabel, bool injectDrivers);
     ProcessResult configureBoot(const std::string &modeKey);
@@ -17,11 +17,19 @@ bool ProgramsIntegrator::tryCopyFromDirectory(const std::string &sourceDir, cons
         return false;
     }
 
-    long long             programsSize = Utils::getDirectorySize(sourceDir);
+    // One listing of the folder gives both the progress total and the copy's file list
     std::set<std::string> excludeDirs;
+    CopyPlan              plan(sourceDir, destDir, CopyPlan::kDefaultClusterSize);
+    if (!fileCopyManager_.planCopy(sourceDir, destDir, excludeDirs, plan)) {
+        return false;
+    }
+    unsigned long long freeBytes = 0;
+    if (!fileCopyManager_.hasRoomFor(plan, freeBytes)) {
+        logFile << ISOCopyManager::getTimestamp() << "Programs needs " << (plan.allocatedBytes() >> 20)
+                << " MB next to the mounted boot.wim, " << (freeBytes >> 20) << " MB free" << std::endl;
+    }
 
-    if (fileCopyManager_.copyDirectoryWithProgress(sourceDir, destDir, programsSize, copiedSoFar, excludeDirs,
-                                                   "Integrando Programs en boot.wim")) {
+    if (fileCopyManager_.copyDirectoryWithProgress(plan, copiedSoFar, "Integrando Programs en boot.wim")) {
         logFile << ISOCopyManager::getTimestamp() << "Programs integrated into boot.wim successfully from " << sourceDir
                 << std::endl;
         return true;
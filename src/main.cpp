@@ -69,6 +69,12 @@ void ClearLogs() {
     Logger::instance().resetProcessLogs();
 }
 
+// Log lines still queued in the Logger are written before the process goes down on an unhandled exception
+LONG WINAPI FlushLogsOnCrash(EXCEPTION_POINTERS *) {
+    Logger::instance().flushOnCrash();
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow) {
@@ -77,6 +83,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     std::ofstream veryEarlyLog(veryEarlyLogPath.c_str(), std::ios::app);
     veryEarlyLog << "wWinMain started at " << __TIME__ << std::endl;
     veryEarlyLog.close();
+    SetUnhandledExceptionFilter(FlushLogsOnCrash);
 
     Gdiplus::GdiplusStartupInput gdiplusStartupInput;
     ULONG_PTR                    gdiplusToken;
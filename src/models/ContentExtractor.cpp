@@ -35,11 +35,28 @@ bool ContentExtractor::extractContent(const std::string &sourcePath, const std::
         eventManager_.notifyDetailedProgress(15, 100, progressMsg);
     }
     std::set<std::string> excludeDirs = {"efi", "EFI"};
-    if (!fileCopyManager_.copyDirectoryWithProgress(sourcePath, destPath, isoSize, copiedSoFar, excludeDirs,
-                                                    progressMsg)) {
+    CopyPlan              plan(sourcePath, destPath, CopyPlan::kDefaultClusterSize);
+    if (!fileCopyManager_.planCopy(sourcePath, destPath, excludeDirs, plan)) {
+        logFile << ISOCopyManager::getTimestamp() << "Content copy cancelled while listing the source" << std::endl;
+        return false;
+    }
+    // A short volume is only warned about: files an earlier, interrupted run left there are counted again
+    unsigned long long freeBytes = 0;
+    if (!fileCopyManager_.hasRoomFor(plan, freeBytes)) {
+        logFile << ISOCopyManager::getTimestamp() << "Content needs " << (plan.allocatedBytes() >> 20)
+                << " MB on the target, " << (freeBytes >> 20) << " MB free" << std::endl;
+        eventManager_.notifyLogUpdate("Advertencia: el contenido ocupa " + std::to_string(plan.allocatedBytes() >> 20) +
+                                      " MB y solo hay " + std::to_string(freeBytes >> 20) + " MB libres.\r\n");
+    }
+    if (!fileCopyManager_.copyDirectoryWithProgress(plan, copiedSoFar, progressMsg)) {
         logFile << ISOCopyManager::getTimestamp() << "Failed to copy content or cancelled" << std::endl;
         return false;
     }
+    const FileCopyStats &stats = fileCopyManager_.lastCopyStats();
+    logFile << ISOCopyManager::getTimestamp() << "Content copied: " << stats.files << " files (" << stats.smallFiles
+            << " small, batched), " << stats.images << " PE images checked, "
+            << static_cast<long long>(stats.filesPerSecond()) << " files/s, "
+            << static_cast<long long>(stats.megabytesPerSecond()) << " MB/s" << std::endl;
     eventManager_.notifyLogUpdate(LocalizedOrUtf8("log.content.copied", "Contenido del ISO copiado correctamente.") +
                                   "\r\n");
 
@@ -0,0 +1,101 @@
+#include "CopyPlan.h"
+
+namespace {
+constexpr unsigned long long kMB = 1024ull * 1024;
+constexpr unsigned long long kGB = 1024 * kMB;
+constexpr unsigned long long kTB = 1024 * kGB;
+
+// Upper volume size (inclusive) and the cluster size format.com defaults to up to there
+struct ClusterStep {
+    unsigned long long volumeBytes;
+    unsigned long long clusterSize;
+};
+
+constexpr ClusterStep kFat32Steps[] = {
+    {64 * kMB, 512}, {128 * kMB, 1024}, {256 * kMB, 2048}, {8 * kGB, 4096}, {16 * kGB, 8192}, {32 * kGB, 16384},
+    {~0ull, 32768}};
+constexpr ClusterStep kExFatSteps[] = {{256 * kMB, 4096}, {32 * kGB, 32768}, {~0ull, 131072}};
+constexpr ClusterStep kNtfsSteps[]  = {
+    {16 * kTB, 4096}, {32 * kTB, 8192}, {64 * kTB, 16384}, {128 * kTB, 32768}, {~0ull, 65536}};
+
+template <size_t N> unsigned long long LookUp(const ClusterStep (&steps)[N], unsigned long long volumeBytes) {
+    for (const ClusterStep &step : steps) {
+        if (volumeBytes <= step.volumeBytes)
+            return step.clusterSize;
+    }
+    return steps[N - 1].clusterSize;
+}
+
+bool SameName(const std::string &a, const char *b) {
+    size_t i = 0;
+    for (; i < a.size() && b[i]; ++i) {
+        const char c = a[i] >= 'a' && a[i] <= 'z' ? static_cast<char>(a[i] - 'a' + 'A') : a[i];
+        if (c != b[i])
+            return false;
+    }
+    return i == a.size() && !b[i];
+}
+} // namespace
+
+unsigned long long CopyPlan::defaultClusterSize(const std::string &format, unsigned long long volumeBytes) {
+    if (volumeBytes == 0)
+        return kDefaultClusterSize;
+    if (SameName(format, "FAT32"))
+        return LookUp(kFat32Steps, volumeBytes);
+    if (SameName(format, "EXFAT"))
+        return LookUp(kExFatSteps, volumeBytes);
+    if (SameName(format, "NTFS"))
+        return LookUp(kNtfsSteps, volumeBytes);
+    return kDefaultClusterSize;
+}
+
+unsigned long long CopyPlan::allocatedSize(unsigned long long size, unsigned long long clusterSize) {
+    if (clusterSize == 0)
+        return size;
+    return (size + clusterSize - 1) / clusterSize * clusterSize;
+}
+
+CopyPlan::CopyPlan(const std::string &source, const std::string &dest, unsigned long long clusterSize)
+    : source_(source), dest_(dest), clusterSize_(clusterSize ? clusterSize : kDefaultClusterSize) {}
+
+size_t CopyPlan::addDirectory(const std::string &path) {
+    dirs_.push_back(path);
+    allocatedBytes_ += clusterSize_;
+    return dirs_.size() - 1;
+}
+
+void CopyPlan::addFile(const std::string &source, const std::string &dest, size_t dir, unsigned long long size,
+                       uint32_t attributes, uint64_t writeTime) {
+    const unsigned long long allocated = allocatedSize(size, clusterSize_);
+    files_.push_back({source, dest, dir, size, allocated, attributes, writeTime});
+    totalBytes_ += size;
+    allocatedBytes_ += allocated;
+}
+
+const std::string &CopyPlan::source() const {
+    return source_;
+}
+
+const std::string &CopyPlan::dest() const {
+    return dest_;
+}
+
+const std::vector<std::string> &CopyPlan::dirs() const {
+    return dirs_;
+}
+
+const std::vector<PlannedFile> &CopyPlan::files() const {
+    return files_;
+}
+
+unsigned long long CopyPlan::clusterSize() const {
+    return clusterSize_;
+}
+
+unsigned long long CopyPlan::totalBytes() const {
+    return totalBytes_;
+}
+
+unsigned long long CopyPlan::allocatedBytes() const {
+    return allocatedBytes_;
+}
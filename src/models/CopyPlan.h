@@ -0,0 +1,64 @@
+#ifndef COPYPLAN_H
+#define COPYPLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One file of a CopyPlan, in enumeration order
+struct PlannedFile {
+    std::string        source;
+    std::string        dest;
+    size_t             dir;        // index into CopyPlan::dirs(), CopyPlan::kNoDir for the destination root
+    unsigned long long size;       // bytes of data
+    unsigned long long allocated;  // size rounded up to whole clusters of the target volume
+    uint32_t           attributes; // FILE_ATTRIBUTE_* of the source
+    uint64_t           writeTime;  // last-write time of the source, in FILETIME ticks
+};
+
+// A directory tree enumerated once, up front: what gets created and copied, and what it adds up to, both
+// in data (for progress) and in clusters on the target volume (for the free-space check). Filled by
+// FileCopyManager::planCopy, then only read.
+class CopyPlan {
+public:
+    static constexpr size_t             kNoDir              = static_cast<size_t>(-1);
+    static constexpr unsigned long long kDefaultClusterSize = 4096;
+
+    // Cluster size format ("FAT32", "EXFAT" or "NTFS", any case) gets on a volume of volumeBytes when
+    // format.com picks the default; kDefaultClusterSize for other names or a volumeBytes of 0 (unknown)
+    static unsigned long long defaultClusterSize(const std::string &format, unsigned long long volumeBytes);
+
+    // Space size bytes take on a volume with clusterSize clusters; empty files take none
+    static unsigned long long allocatedSize(unsigned long long size, unsigned long long clusterSize);
+
+    CopyPlan(const std::string &source, const std::string &dest, unsigned long long clusterSize);
+
+    // Directories are added parents first; the returned index is what files in it are added with
+    size_t addDirectory(const std::string &path);
+    void   addFile(const std::string &source, const std::string &dest, size_t dir, unsigned long long size,
+                   uint32_t attributes, uint64_t writeTime);
+
+    const std::string              &source() const;
+    const std::string              &dest() const;
+    const std::vector<std::string> &dirs() const;
+    const std::vector<PlannedFile> &files() const;
+    unsigned long long              clusterSize() const;
+
+    // Sum of the file sizes: what progress counts
+    unsigned long long totalBytes() const;
+
+    // Sum of the allocated sizes plus one cluster per directory: what the copy takes from the target
+    unsigned long long allocatedBytes() const;
+
+private:
+    std::string              source_;
+    std::string              dest_;
+    unsigned long long       clusterSize_;
+    std::vector<std::string> dirs_;
+    std::vector<PlannedFile> files_;
+    unsigned long long       totalBytes_     = 0;
+    unsigned long long       allocatedBytes_ = 0;
+};
+
+#endif // COPYPLAN_H
@@ -0,0 +1,166 @@
+#include "CoverageHasher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+// Reads [offset, offset + size) into buffer; false on a short read
+bool ReadRange(std::ifstream &in, unsigned long long offset, uint8_t *buffer, size_t size) {
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(reinterpret_cast<char *>(buffer), static_cast<std::streamsize>(size));
+    return static_cast<size_t>(in.gcount()) == size;
+}
+} // namespace
+
+CoverageHasher::CoverageHasher(const std::string &path, size_t maxPendingChunks)
+    : path_(path), maxPending_((std::max)(maxPendingChunks, static_cast<size_t>(1))) {
+    std::error_code ec;
+    size_     = std::filesystem::file_size(std::filesystem::u8path(path), ec);
+    readable_ = !ec;
+    if (!readable_)
+        size_ = 0;
+    const unsigned long long chunkSize = StreamHasher::kTreeChunkSize;
+    const size_t             chunks    = static_cast<size_t>((size_ + chunkSize - 1) / chunkSize);
+    leaves_.resize(chunks);
+    states_.assign(chunks, ChunkState::Open);
+}
+
+const std::string &CoverageHasher::path() const {
+    return path_;
+}
+
+unsigned long long CoverageHasher::fileSize() const {
+    return size_;
+}
+
+unsigned long long CoverageHasher::coveredBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return covered_;
+}
+
+size_t CoverageHasher::chunkLength(size_t chunk) const {
+    const unsigned long long begin = static_cast<unsigned long long>(chunk) * StreamHasher::kTreeChunkSize;
+    return static_cast<size_t>((std::min<unsigned long long>)(StreamHasher::kTreeChunkSize, size_ - begin));
+}
+
+void CoverageHasher::add(unsigned long long offset, const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    if (offset >= size_)
+        return;
+    size = static_cast<size_t>((std::min<unsigned long long>)(size, size_ - offset));
+
+    while (size != 0) {
+        const size_t chunk  = static_cast<size_t>(offset / StreamHasher::kTreeChunkSize);
+        const size_t begin  = static_cast<size_t>(offset % StreamHasher::kTreeChunkSize);
+        const size_t length = chunkLength(chunk);
+        const size_t take   = (std::min)(size, length - begin);
+
+        std::vector<uint8_t> complete;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (states_[chunk] == ChunkState::Open) {
+                auto found = pending_.find(chunk);
+                if (found == pending_.end()) {
+                    if (pending_.size() >= maxPending_) {
+                        auto oldest = std::min_element(
+                            pending_.begin(), pending_.end(),
+                            [](const auto &a, const auto &b) { return a.second.lastUse < b.second.lastUse; });
+                        pending_.erase(oldest);
+                    }
+                    found = pending_.emplace(chunk, PendingChunk()).first;
+                    found->second.data.resize(length);
+                }
+                PendingChunk &pending = found->second;
+                pending.lastUse       = ++useClock_;
+                std::copy(bytes, bytes + take, pending.data.begin() + static_cast<std::ptrdiff_t>(begin));
+
+                // Merge [begin, begin + take) into the covered ranges
+                std::pair<size_t, size_t> merged(begin, begin + take);
+                std::vector<std::pair<size_t, size_t>> ranges;
+                for (const auto &range : pending.ranges) {
+                    if (range.second < merged.first || range.first > merged.second) {
+                        ranges.push_back(range);
+                    } else {
+                        merged.first  = (std::min)(merged.first, range.first);
+                        merged.second = (std::max)(merged.second, range.second);
+                    }
+                }
+                ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), merged), merged);
+                pending.covered = 0;
+                for (const auto &range : ranges)
+                    pending.covered += range.second - range.first;
+                pending.ranges.swap(ranges);
+
+                if (pending.covered == length) {
+                    complete.swap(pending.data);
+                    pending_.erase(found);
+                    states_[chunk] = ChunkState::Hashing;
+                }
+            }
+        }
+
+        // Hashed outside the lock so readers on other threads are not held up
+        if (!complete.empty()) {
+            Leaf leaf;
+            StreamHasher::treeLeaf(complete.data(), complete.size(), leaf.data());
+            std::lock_guard<std::mutex> lock(mutex_);
+            leaves_[chunk] = leaf;
+            states_[chunk] = ChunkState::Done;
+            covered_ += complete.size();
+        }
+
+        offset += take;
+        bytes += take;
+        size -= take;
+    }
+}
+
+std::string CoverageHasher::finish() {
+    if (!readable_)
+        return std::string();
+    {
+        // Nothing came through add(): the parallel file hasher is faster than reading chunk by chunk here
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (covered_ == 0 && pending_.empty())
+            return FileHasher::hashFile(path_, HashAlgorithm::BLAKE2SP_TREE);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ifstream               in(std::filesystem::u8path(path_), std::ios::binary);
+    if (!in)
+        return std::string();
+
+    std::vector<uint8_t> buffer;
+    for (size_t chunk = 0; chunk < states_.size(); ++chunk) {
+        if (states_[chunk] == ChunkState::Done)
+            continue;
+        const unsigned long long base   = static_cast<unsigned long long>(chunk) * StreamHasher::kTreeChunkSize;
+        const size_t             length = chunkLength(chunk);
+
+        auto found = pending_.find(chunk);
+        if (found != pending_.end()) {
+            // Only the gaps between what was already read
+            PendingChunk &pending = found->second;
+            size_t        cursor  = 0;
+            for (const auto &range : pending.ranges) {
+                const size_t gap = range.first - cursor;
+                if (gap != 0 && !ReadRange(in, base + cursor, pending.data.data() + cursor, gap))
+                    return std::string();
+                cursor = range.second;
+            }
+            if (cursor < length && !ReadRange(in, base + cursor, pending.data.data() + cursor, length - cursor))
+                return std::string();
+            StreamHasher::treeLeaf(pending.data.data(), length, leaves_[chunk].data());
+            pending_.erase(found);
+        } else {
+            buffer.resize(length);
+            if (!ReadRange(in, base, buffer.data(), length))
+                return std::string();
+            StreamHasher::treeLeaf(buffer.data(), length, leaves_[chunk].data());
+        }
+        states_[chunk] = ChunkState::Done;
+    }
+    return StreamHasher::treeRoot(leaves_.empty() ? nullptr : leaves_.front().data(), leaves_.size(), size_);
+}
@@ -0,0 +1,65 @@
+#ifndef COVERAGEHASHER_H
+#define COVERAGEHASHER_H
+
+#include "FileHasher.h"
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Builds the BLAKE2SP_TREE digest of a file out of whatever another reader happens to read from it, in
+// any order and from any thread, so hashing the file costs no read of its own. A chunk is hashed as soon
+// as reads have covered all of it. finish() reads what was never covered (padding, unreferenced sectors,
+// chunks only partly read) from the file itself. Partly covered chunks are buffered; past
+// maxPendingChunks the least recently touched one is dropped and left for finish() to read.
+class CoverageHasher {
+public:
+    static constexpr size_t kDefaultMaxPendingChunks = 64;
+
+    explicit CoverageHasher(const std::string &path, size_t maxPendingChunks = kDefaultMaxPendingChunks);
+    CoverageHasher(const CoverageHasher &)            = delete;
+    CoverageHasher &operator=(const CoverageHasher &) = delete;
+
+    // Bytes [offset, offset + size) of the file, as a reader just got them
+    void add(unsigned long long offset, const void *data, size_t size);
+
+    // Lowercase hex digest, the same FileHasher::hashFile gives for BLAKE2SP_TREE; empty if the file
+    // could not be read. Call once, after the last add().
+    std::string finish();
+
+    const std::string &path() const;
+    unsigned long long fileSize() const;
+
+    // Bytes of the chunks hashed from add() so far; the rest is read by finish()
+    unsigned long long coveredBytes() const;
+
+private:
+    using Leaf = std::array<uint8_t, StreamHasher::kTreeDigestSize>;
+    enum class ChunkState : uint8_t { Open, Hashing, Done };
+
+    struct PendingChunk {
+        std::vector<uint8_t>                   data;
+        std::vector<std::pair<size_t, size_t>> ranges; // covered [begin, end), sorted and disjoint
+        size_t                                 covered = 0;
+        uint64_t                               lastUse = 0;
+    };
+
+    size_t chunkLength(size_t chunk) const;
+
+    std::string                              path_;
+    unsigned long long                       size_ = 0;
+    bool                                     readable_;
+    size_t                                   maxPending_;
+    mutable std::mutex                       mutex_;
+    std::vector<Leaf>                        leaves_;
+    std::vector<ChunkState>                  states_;
+    std::unordered_map<size_t, PendingChunk> pending_;
+    uint64_t                                 useClock_ = 0;
+    unsigned long long                       covered_  = 0;
+};
+
+#endif // COVERAGEHASHER_H
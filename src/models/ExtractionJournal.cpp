@@ -0,0 +1,304 @@
+#include "ExtractionJournal.h"
+
+#include "7zCrc.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+constexpr char     kMagic[8]       = {'B', 'T', 'I', 'S', 'O', 'J', 'N', 'L'};
+constexpr uint32_t kFormatVersion  = 3;
+constexpr uint32_t kKindChunk      = 1;
+constexpr uint32_t kKindComplete   = 2;
+constexpr size_t   kFlushRecords   = 64;       // completion records buffered before they are written out
+constexpr DWORD    kVerifyReadSize = 1u << 20; // read size used when re-checking data on the target
+constexpr int      kMaxChunkProbes = 2;
+
+struct JournalHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t chunkShift;
+    uint64_t fileSize;
+    uint64_t lastWriteTime;
+    uint64_t descriptorHash;
+    char     label[ExtractionJournal::kMaxLabel];
+};
+
+std::once_flag g_crcTableOnce;
+
+// CRC32 of [offset, offset + length) of an open file; false on a short read
+bool CrcOfRange(HANDLE file, uint64_t offset, uint64_t length, std::vector<char> &buffer, uint32_t &crc) {
+    LARGE_INTEGER pos;
+    pos.QuadPart = static_cast<LONGLONG>(offset);
+    if (!SetFilePointerEx(file, pos, nullptr, FILE_BEGIN))
+        return false;
+    UInt32 state = CRC_INIT_VAL;
+    while (length > 0) {
+        const DWORD want = static_cast<DWORD>(std::min<uint64_t>(length, buffer.size()));
+        DWORD       read = 0;
+        if (!ReadFile(file, buffer.data(), want, &read, nullptr) || read != want)
+            return false;
+        state = CrcUpdate(state, buffer.data(), read);
+        length -= read;
+    }
+    crc = CRC_GET_DIGEST(state);
+    return true;
+}
+
+uint32_t ChunkShift() {
+    uint32_t shift = 0;
+    while ((1ULL << shift) < ExtractionJournal::kChunkSize)
+        ++shift;
+    return shift;
+}
+
+JournalHeader MakeHeader(const ISOImageIdentity &identity, const std::string &label) {
+    JournalHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version        = kFormatVersion;
+    header.chunkShift     = ChunkShift();
+    header.fileSize       = identity.fileSize;
+    header.lastWriteTime  = identity.lastWriteTime;
+    header.descriptorHash = identity.descriptorHash;
+    std::memcpy(header.label, label.data(), std::min<size_t>(label.size(), sizeof(header.label)));
+    return header;
+}
+
+std::wstring JournalPath(const std::string &destDir) {
+    return (std::filesystem::u8path(destDir) / "ISOJOURNAL").wstring();
+}
+} // namespace
+
+struct ExtractionJournal::Record {
+    uint32_t index;
+    uint32_t kind;
+    uint64_t value;     // chunk ordinal or item size
+    uint64_t hashState; // manifest hash state up to the end of the chunk or item
+    uint32_t crc;
+    uint32_t check; // CRC32 of the fields above
+};
+
+ExtractionJournal::ExtractionJournal() {
+    std::call_once(g_crcTableOnce, CrcGenerateTable);
+}
+
+ExtractionJournal::~ExtractionJournal() {
+    close();
+}
+
+bool ExtractionJournal::open(const std::string &destDir, const ISOImageIdentity &identity, const std::string &label) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.clear();
+    journaledBytes_ = 0;
+    path_           = JournalPath(destDir);
+
+    HANDLE file = CreateFileW(path_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_HIDDEN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER     size{};
+    std::vector<char> contents;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart < (1LL << 30)) {
+        contents.resize(static_cast<size_t>(size.QuadPart));
+        DWORD read = 0;
+        if (!ReadFile(file, contents.data(), static_cast<DWORD>(contents.size()), &read, nullptr))
+            read = 0;
+        contents.resize(read);
+    }
+
+    const JournalHeader header = MakeHeader(identity, label);
+
+    // Records of another image (or another journal layout) are worthless: start over
+    size_t validEnd = 0;
+    if (contents.size() >= sizeof(header) && std::memcmp(contents.data(), &header, sizeof(header)) == 0) {
+        validEnd = sizeof(header);
+        while (validEnd + sizeof(Record) <= contents.size()) {
+            Record record;
+            std::memcpy(&record, contents.data() + validEnd, sizeof(record));
+            if (CrcCalc(&record, offsetof(Record, check)) != record.check)
+                break;
+            apply(record);
+            validEnd += sizeof(record);
+        }
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(validEnd);
+    DWORD written = 0;
+    bool  ok      = SetFilePointerEx(file, end, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+    if (ok && validEnd == 0) {
+        ok = WriteFile(file, &header, sizeof(header), &written, nullptr) && written == sizeof(header);
+    }
+    if (!ok) {
+        CloseHandle(file);
+        items_.clear();
+        return false;
+    }
+    file_ = file;
+    return true;
+}
+
+bool ExtractionJournal::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != INVALID_HANDLE_VALUE;
+}
+
+bool ExtractionJournal::describes(const std::string &destDir, const ISOImageIdentity &identity,
+                                  const std::string &label) {
+    HANDLE file = CreateFileW(JournalPath(destDir).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    JournalHeader stored{};
+    DWORD         read = 0;
+    const bool    ok   = ReadFile(file, &stored, sizeof(stored), &read, nullptr) && read == sizeof(stored);
+    CloseHandle(file);
+    const JournalHeader expected = MakeHeader(identity, label);
+    return ok && std::memcmp(&stored, &expected, sizeof(expected)) == 0;
+}
+
+void ExtractionJournal::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return;
+    flushPending();
+    FlushFileBuffers(file_);
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+void ExtractionJournal::discard() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+    pending_.clear();
+    items_.clear();
+    if (!path_.empty())
+        DeleteFileW(path_.c_str());
+}
+
+bool ExtractionJournal::resumePoint(uint32_t index, uint64_t size, const std::wstring &path, uint64_t &offset,
+                                    uint64_t &hashState) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    offset  = 0;
+    auto it = items_.find(index);
+    if (it == items_.end())
+        return false;
+    const Item &item = it->second;
+
+    WIN32_FILE_ATTRIBUTE_DATA info{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &info))
+        return false;
+    const uint64_t onDisk = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+
+    const bool recent = journaledBytes_ - item.position < kVerifyTailBytes;
+    if (item.complete && item.size == size && onDisk == size && !recent) {
+        offset    = size;
+        hashState = item.hashState;
+        return true;
+    }
+
+    // Everything else is checked against the data: the most recent chunk (and tail) of an item is what a
+    // power loss would have left unwritten, so earlier chunks are trusted once the last one matches
+    uint64_t chunks = std::min<uint64_t>(item.chunkCrcs.size(), std::min<uint64_t>(onDisk, size) / kChunkSize);
+    HANDLE   file   = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    std::vector<char> buffer(kVerifyReadSize);
+    uint32_t          crc = 0;
+
+    if (item.complete && item.size == size && onDisk == size && chunks == size / kChunkSize &&
+        CrcOfRange(file, chunks * kChunkSize, size - chunks * kChunkSize, buffer, crc) && crc == item.tailCrc &&
+        (chunks == 0 || (CrcOfRange(file, (chunks - 1) * kChunkSize, kChunkSize, buffer, crc) &&
+                         crc == item.chunkCrcs[chunks - 1]))) {
+        CloseHandle(file);
+        offset    = size;
+        hashState = item.hashState;
+        return true;
+    }
+    for (int probes = 0; chunks > 0; --chunks) {
+        if (CrcOfRange(file, (chunks - 1) * kChunkSize, kChunkSize, buffer, crc) && crc == item.chunkCrcs[chunks - 1])
+            break;
+        // Damage reaching further back than this is not worth re-reading chunk by chunk
+        if (++probes == kMaxChunkProbes) {
+            chunks = 0;
+            break;
+        }
+    }
+    CloseHandle(file);
+    offset = chunks * kChunkSize;
+    if (chunks > 0)
+        hashState = item.chunkHashes[chunks - 1];
+    return chunks > 0;
+}
+
+void ExtractionJournal::recordChunk(uint32_t index, uint64_t chunk, uint32_t crc, uint64_t hashState) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return;
+    Record record{index, kKindChunk, chunk, hashState, crc, 0};
+    // A chunk is the expensive thing to redo, so it is written out right away
+    append(record, true);
+}
+
+void ExtractionJournal::recordComplete(uint32_t index, uint64_t size, uint32_t tailCrc, uint64_t hashState) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return;
+    Record record{index, kKindComplete, size, hashState, tailCrc, 0};
+    append(record, false);
+}
+
+void ExtractionJournal::apply(const Record &record) {
+    Item &item = items_[record.index];
+    if (record.kind == kKindChunk) {
+        // A rewrite from the start (or from an earlier boundary) supersedes what followed
+        if (record.value < item.chunkCrcs.size() || record.value == 0) {
+            item.chunkCrcs.resize(static_cast<size_t>(record.value));
+            item.chunkHashes.resize(static_cast<size_t>(record.value));
+        }
+        if (record.value == item.chunkCrcs.size()) {
+            item.chunkCrcs.push_back(record.crc);
+            item.chunkHashes.push_back(record.hashState);
+        }
+        item.complete = false;
+        journaledBytes_ += kChunkSize;
+    } else if (record.kind == kKindComplete) {
+        const uint64_t chunks = record.value / kChunkSize;
+        if (item.chunkCrcs.size() > chunks) {
+            item.chunkCrcs.resize(static_cast<size_t>(chunks));
+            item.chunkHashes.resize(static_cast<size_t>(chunks));
+        }
+        item.size      = record.value;
+        item.tailCrc   = record.crc;
+        item.hashState = record.hashState;
+        item.complete  = item.chunkCrcs.size() == chunks;
+        journaledBytes_ += record.value - chunks * kChunkSize;
+        item.position = journaledBytes_;
+    }
+}
+
+void ExtractionJournal::append(const Record &record, bool flushNow) {
+    Record stamped = record;
+    stamped.check  = CrcCalc(&stamped, offsetof(Record, check));
+    apply(stamped);
+    const char *bytes = reinterpret_cast<const char *>(&stamped);
+    pending_.insert(pending_.end(), bytes, bytes + sizeof(stamped));
+    if (flushNow || pending_.size() >= kFlushRecords * sizeof(Record))
+        flushPending();
+}
+
+void ExtractionJournal::flushPending() {
+    if (pending_.empty() || file_ == INVALID_HANDLE_VALUE)
+        return;
+    DWORD written = 0;
+    WriteFile(file_, pending_.data(), static_cast<DWORD>(pending_.size()), &written, nullptr);
+    pending_.clear();
+}
@@ -0,0 +1,88 @@
+#ifndef EXTRACTIONJOURNAL_H
+#define EXTRACTIONJOURNAL_H
+
+#include "ISOCatalogCache.h"
+
+#include <windows.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Append-only record of what an extraction pass has finished writing, kept on the target as ISOJOURNAL
+// so an interrupted pass (cancel, crash, power loss) can be resumed against the same image. Items are
+// keyed by archive index: every full kChunkSize chunk of an item gets a record with its CRC32, and the
+// completion record carries the item size and the CRC32 of the remainder after the last chunk. Both also
+// carry the manifest hash state (ExtractionManifest::hashUpdate) over the item up to that point, so a
+// resumed pass can list the item in ISOMANIFEST without reading it again. A record is only written once
+// the data it describes has been written out. Records are fixed-size and self-checked, so a torn tail is
+// simply dropped on the next open. The journal is deleted once a pass completes; from then on
+// ISOBOOTHASH describes the target.
+class ExtractionJournal {
+public:
+    static constexpr uint64_t kChunkSize = 64ULL << 20;
+    static constexpr size_t   kMaxLabel  = 16;
+
+    // Completed items among the most recently journaled bytes may not have reached the disk yet when the
+    // machine lost power, so they are re-read and checked against their CRCs before being trusted
+    static constexpr uint64_t kVerifyTailBytes = 256ULL << 20;
+
+    ExtractionJournal();
+    ~ExtractionJournal();
+    ExtractionJournal(const ExtractionJournal &)            = delete;
+    ExtractionJournal &operator=(const ExtractionJournal &) = delete;
+
+    // Opens destDir\ISOJOURNAL, keeping its records if they were written for the same image and label and
+    // starting a fresh journal otherwise; false if the file cannot be created. label tells passes over the
+    // same image apart (the boot mode they extract for); up to kMaxLabel characters are kept.
+    bool open(const std::string &destDir, const ISOImageIdentity &identity, const std::string &label = {});
+    bool isOpen() const;
+
+    // True if destDir holds a journal that open() would resume with identity and label
+    static bool describes(const std::string &destDir, const ISOImageIdentity &identity, const std::string &label);
+
+    // Writes out pending records and closes the file, leaving it for the next run
+    void close();
+
+    // Closes and deletes the journal (the pass it describes completed)
+    void discard();
+
+    // Where extraction of an item of the given size can pick up, given the file at path: size when the
+    // journal has it complete, otherwise the end of the last chunk whose CRC still matches the data on
+    // disk. hashState is the manifest hash state over the item's first offset bytes. False when nothing
+    // of the item can be reused.
+    bool resumePoint(uint32_t index, uint64_t size, const std::wstring &path, uint64_t &offset,
+                     uint64_t &hashState) const;
+
+    // chunk is the ordinal of a full kChunkSize chunk; recording chunk 0 forgets earlier records of index.
+    // hashState covers the item from its first byte to the end of the chunk (or of the item).
+    void recordChunk(uint32_t index, uint64_t chunk, uint32_t crc, uint64_t hashState);
+    void recordComplete(uint32_t index, uint64_t size, uint32_t tailCrc, uint64_t hashState);
+
+private:
+    struct Item {
+        std::vector<uint32_t> chunkCrcs;
+        std::vector<uint64_t> chunkHashes; // manifest hash state at the end of each chunk
+        uint64_t              size      = 0;
+        uint32_t              tailCrc   = 0;
+        uint64_t              hashState = 0; // over the whole item, once complete
+        bool                  complete  = false;
+        uint64_t              position  = 0; // journaled bytes up to and including the completion record
+    };
+    struct Record;
+
+    void apply(const Record &record);
+    void append(const Record &record, bool flushNow);
+    void flushPending();
+
+    mutable std::mutex                 mutex_;
+    HANDLE                             file_ = INVALID_HANDLE_VALUE;
+    std::wstring                       path_;
+    std::unordered_map<uint32_t, Item> items_;
+    std::vector<char>                  pending_;
+    uint64_t                           journaledBytes_ = 0;
+};
+
+#endif // EXTRACTIONJOURNAL_H
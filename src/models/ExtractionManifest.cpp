@@ -0,0 +1,146 @@
+#include "ExtractionManifest.h"
+#include "ISOCatalog.h"
+
+#include <windows.h>
+
+#include "XzCrc64.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+namespace {
+const char kHeader[] = "BTISOMANIFEST 1";
+
+std::once_flag g_crc64TableOnce;
+
+std::string ToHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string       out(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        out[static_cast<size_t>(i)] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return out;
+}
+} // namespace
+
+bool ExtractionManifest::load(const std::string &manifestPath) {
+    clear();
+    std::ifstream file(std::filesystem::u8path(manifestPath), std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::string line;
+    if (!std::getline(file, line) || line != kHeader)
+        return false;
+
+    // hash \t size \t writeTime \t path
+    while (std::getline(file, line)) {
+        const size_t tab1 = line.find('\t');
+        const size_t tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+        const size_t tab3 = tab2 == std::string::npos ? tab2 : line.find('\t', tab2 + 1);
+        if (tab3 == std::string::npos || tab3 + 1 >= line.size()) {
+            clear();
+            return false;
+        }
+        Entry entry;
+        entry.hash      = std::strtoull(line.c_str(), nullptr, 16);
+        entry.size      = std::strtoull(line.c_str() + tab1 + 1, nullptr, 10);
+        entry.writeTime = std::strtoull(line.c_str() + tab2 + 1, nullptr, 10);
+        entry.path      = line.substr(tab3 + 1);
+        index_.emplace(key(entry.path), entries_.size());
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool ExtractionManifest::save(const std::string &manifestPath, const std::string &destDir) {
+    const std::filesystem::path base = std::filesystem::u8path(destDir);
+    for (auto &entry : entries_) {
+        entry.writeTime = fileWriteTime((base / std::filesystem::u8path(entry.path)).wstring());
+    }
+
+    // Write to a temporary name and rename, so an interrupted save leaves the previous manifest intact
+    const std::filesystem::path finalPath = std::filesystem::u8path(manifestPath);
+    std::filesystem::path       tempPath  = finalPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file << kHeader << '\n';
+        for (const auto &entry : entries_) {
+            file << ToHex(entry.hash) << '\t' << entry.size << '\t' << entry.writeTime << '\t' << entry.path << '\n';
+        }
+        if (!file.good())
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+void ExtractionManifest::add(const std::string &path, uint64_t size, uint64_t hash) {
+    Entry entry;
+    entry.path = path;
+    std::replace(entry.path.begin(), entry.path.end(), '\\', '/');
+    entry.size = size;
+    entry.hash = hash;
+
+    const std::string k  = key(entry.path);
+    auto              it = index_.find(k);
+    if (it != index_.end()) {
+        entries_[it->second] = std::move(entry);
+        return;
+    }
+    index_.emplace(k, entries_.size());
+    entries_.push_back(std::move(entry));
+}
+
+const ExtractionManifest::Entry *ExtractionManifest::find(const std::string &path) const {
+    auto it = index_.find(key(path));
+    return it == index_.end() ? nullptr : &entries_[it->second];
+}
+
+const std::vector<ExtractionManifest::Entry> &ExtractionManifest::entries() const {
+    return entries_;
+}
+
+void ExtractionManifest::clear() {
+    entries_.clear();
+    index_.clear();
+}
+
+uint64_t ExtractionManifest::hashInit() {
+    std::call_once(g_crc64TableOnce, Crc64GenerateTable);
+    return CRC64_INIT_VAL;
+}
+
+uint64_t ExtractionManifest::hashUpdate(uint64_t state, const void *data, size_t size) {
+    return Crc64Update(state, data, size);
+}
+
+uint64_t ExtractionManifest::hashFinal(uint64_t state) {
+    return CRC64_GET_DIGEST(state);
+}
+
+uint64_t ExtractionManifest::fileWriteTime(const std::wstring &path, uint64_t *size) {
+    WIN32_FILE_ATTRIBUTE_DATA info{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &info))
+        return 0;
+    if (size)
+        *size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    return (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+}
+
+std::string ExtractionManifest::key(const std::string &path) {
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    return ISOCatalog::foldCase(normalized);
+}
@@ -0,0 +1,49 @@
+#ifndef EXTRACTIONMANIFEST_H
+#define EXTRACTIONMANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What an extraction left on the target, kept next to ISOBOOTHASH as ISOMANIFEST: one line per file with
+// the CRC-64 of its content, its size, the write time it had right after extraction and its path inside
+// the image. A later extraction of a newer build compares the new image against it and only rewrites
+// what changed; the write time catches files that were modified on the target after extraction.
+// Lookups are case-insensitive, like the target filesystem.
+class ExtractionManifest {
+public:
+    struct Entry {
+        std::string path; // UTF-8, '/' separators
+        uint64_t    size      = 0;
+        uint64_t    hash      = 0;
+        uint64_t    writeTime = 0; // FILETIME as 100 ns ticks, 0 if not stamped yet
+    };
+
+    bool load(const std::string &manifestPath);
+
+    // Stamps every entry with the current write time of its file under destDir and replaces manifestPath
+    bool save(const std::string &manifestPath, const std::string &destDir);
+
+    void         add(const std::string &path, uint64_t size, uint64_t hash);
+    const Entry *find(const std::string &path) const;
+
+    const std::vector<Entry> &entries() const;
+    void                      clear();
+
+    // The content hash: CRC-64 (ECMA-182, as used by xz)
+    static uint64_t hashInit();
+    static uint64_t hashUpdate(uint64_t state, const void *data, size_t size);
+    static uint64_t hashFinal(uint64_t state);
+
+    // Write time of path as 100 ns ticks, 0 if it does not exist
+    static uint64_t fileWriteTime(const std::wstring &path, uint64_t *size = nullptr);
+
+private:
+    static std::string key(const std::string &path);
+
+    std::vector<Entry>                      entries_;
+    std::unordered_map<std::string, size_t> index_;
+};
+
+#endif // EXTRACTIONMANIFEST_H
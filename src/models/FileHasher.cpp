@@ -0,0 +1,558 @@
+#include "FileHasher.h"
+
+#include "Blake2.h"
+#include "Sha1.h"
+#include "Sha256.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// RFC 1321. The SDK has no MD5 kernel, and CryptoAPI is Windows-only.
+class Md5 {
+public:
+    void init() {
+        state_[0] = 0x67452301;
+        state_[1] = 0xefcdab89;
+        state_[2] = 0x98badcfe;
+        state_[3] = 0x10325476;
+        count_    = 0;
+    }
+
+    void update(const uint8_t *data, size_t size) {
+        const size_t used = static_cast<size_t>(count_ & 63);
+        count_ += size;
+        if (used != 0) {
+            const size_t fill = 64 - used;
+            if (size < fill) {
+                memcpy(buffer_ + used, data, size);
+                return;
+            }
+            memcpy(buffer_ + used, data, fill);
+            transform(buffer_);
+            data += fill;
+            size -= fill;
+        }
+        for (; size >= 64; data += 64, size -= 64)
+            transform(data);
+        if (size != 0)
+            memcpy(buffer_, data, size);
+    }
+
+    void finish(uint8_t digest[16]) {
+        const uint64_t bits      = count_ * 8;
+        const size_t   used      = static_cast<size_t>(count_ & 63);
+        uint8_t        pad[64]   = {0x80};
+        uint8_t        length[8] = {};
+        for (int i = 0; i < 8; ++i)
+            length[i] = static_cast<uint8_t>(bits >> (8 * i));
+        update(pad, used < 56 ? 56 - used : 120 - used);
+        update(length, sizeof(length));
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                digest[i * 4 + j] = static_cast<uint8_t>(state_[i] >> (8 * j));
+    }
+
+private:
+    static uint32_t rotl(uint32_t x, unsigned n) {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    void transform(const uint8_t *block) {
+        static const uint32_t kSines[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+        uint32_t words[16];
+        for (int i = 0; i < 16; ++i) {
+            words[i] = static_cast<uint32_t>(block[i * 4]) | static_cast<uint32_t>(block[i * 4 + 1]) << 8 |
+                       static_cast<uint32_t>(block[i * 4 + 2]) << 16 | static_cast<uint32_t>(block[i * 4 + 3]) << 24;
+        }
+
+        // Four steps per iteration rotate the roles of a, b, c and d instead of moving the values around
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        auto     f = [](uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (~x & z); };
+        auto     g = [](uint32_t x, uint32_t y, uint32_t z) { return (z & x) | (~z & y); };
+        auto     h = [](uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; };
+        auto     k = [](uint32_t x, uint32_t y, uint32_t z) { return y ^ (x | ~z); };
+        for (int i = 0; i < 16; i += 4) {
+            a = b + rotl(a + f(b, c, d) + kSines[i] + words[i], 7);
+            d = a + rotl(d + f(a, b, c) + kSines[i + 1] + words[i + 1], 12);
+            c = d + rotl(c + f(d, a, b) + kSines[i + 2] + words[i + 2], 17);
+            b = c + rotl(b + f(c, d, a) + kSines[i + 3] + words[i + 3], 22);
+        }
+        for (int i = 16; i < 32; i += 4) {
+            a = b + rotl(a + g(b, c, d) + kSines[i] + words[(5 * i + 1) & 15], 5);
+            d = a + rotl(d + g(a, b, c) + kSines[i + 1] + words[(5 * i + 6) & 15], 9);
+            c = d + rotl(c + g(d, a, b) + kSines[i + 2] + words[(5 * i + 11) & 15], 14);
+            b = c + rotl(b + g(c, d, a) + kSines[i + 3] + words[(5 * i + 16) & 15], 20);
+        }
+        for (int i = 32; i < 48; i += 4) {
+            a = b + rotl(a + h(b, c, d) + kSines[i] + words[(3 * i + 5) & 15], 4);
+            d = a + rotl(d + h(a, b, c) + kSines[i + 1] + words[(3 * i + 8) & 15], 11);
+            c = d + rotl(c + h(d, a, b) + kSines[i + 2] + words[(3 * i + 11) & 15], 16);
+            b = c + rotl(b + h(c, d, a) + kSines[i + 3] + words[(3 * i + 14) & 15], 23);
+        }
+        for (int i = 48; i < 64; i += 4) {
+            a = b + rotl(a + k(b, c, d) + kSines[i] + words[(7 * i) & 15], 6);
+            d = a + rotl(d + k(a, b, c) + kSines[i + 1] + words[(7 * i + 7) & 15], 10);
+            c = d + rotl(c + k(d, a, b) + kSines[i + 2] + words[(7 * i + 14) & 15], 15);
+            b = c + rotl(b + k(c, d, a) + kSines[i + 3] + words[(7 * i + 21) & 15], 21);
+        }
+
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+    }
+
+    uint32_t state_[4];
+    uint64_t count_;
+    uint8_t  buffer_[64];
+};
+
+// Selects the SHA block functions for this CPU; the SDK requires it once before any Sha*_Init
+void PrepareShaKernels() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        Sha1Prepare();
+        Sha256Prepare();
+    });
+}
+
+std::string ToHex(const uint8_t *digest, size_t size) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string       hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex += kDigits[digest[i] >> 4];
+        hex += kDigits[digest[i] & 0xf];
+    }
+    return hex;
+}
+
+// BLAKE2SP_TREE root: the leaf digests were fed in order, the input length closes it
+void FinishTreeRoot(CBlake2sp &root, unsigned long long length, uint8_t digest[BLAKE2S_DIGEST_SIZE]) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = static_cast<uint8_t>(length >> (8 * i));
+    Blake2sp_Update(&root, bytes, sizeof(bytes));
+    Blake2sp_Final(&root, digest);
+}
+
+// A file opened for a front-to-back pass, with the OS told so (sequential read-ahead). The tree workers
+// each open their own and read chunks at explicit offsets, still moving forward through the file.
+class SequentialFile {
+public:
+    SequentialFile(const SequentialFile &)            = delete;
+    SequentialFile &operator=(const SequentialFile &) = delete;
+    SequentialFile()                                  = default;
+
+#ifdef _WIN32
+    ~SequentialFile() {
+        if (handle_ != INVALID_HANDLE_VALUE)
+            CloseHandle(handle_);
+    }
+
+    bool open(const std::string &path) {
+        handle_ = CreateFileW(std::filesystem::u8path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size{};
+        if (handle_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle_, &size))
+            return false;
+        size_ = static_cast<unsigned long long>(size.QuadPart);
+        return true;
+    }
+
+    // Bytes read, 0 at end of file, -1 on error
+    long long read(void *buffer, size_t size) {
+        DWORD read = 0;
+        if (!ReadFile(handle_, buffer, static_cast<DWORD>(size), &read, nullptr))
+            return -1;
+        return read;
+    }
+
+    long long readAt(void *buffer, size_t size, unsigned long long offset) {
+        OVERLAPPED position{};
+        position.Offset     = static_cast<DWORD>(offset);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read          = 0;
+        if (!ReadFile(handle_, buffer, static_cast<DWORD>(size), &read, &position))
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+        return read;
+    }
+#else
+    ~SequentialFile() {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool open(const std::string &path) {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info{};
+        if (fd_ < 0 || fstat(fd_, &info) != 0)
+            return false;
+        size_ = static_cast<unsigned long long>(info.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    // Bytes read, 0 at end of file, -1 on error
+    long long read(void *buffer, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            const ssize_t n = ::read(fd_, static_cast<char *>(buffer) + done, size - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                return -1;
+            if (n == 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<long long>(done);
+    }
+
+    long long readAt(void *buffer, size_t size, unsigned long long offset) {
+        size_t done = 0;
+        while (done < size) {
+            const ssize_t n = ::pread(fd_, static_cast<char *>(buffer) + done, size - done,
+                                      static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                return -1;
+            if (n == 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<long long>(done);
+    }
+#endif
+
+    unsigned long long size() const {
+        return size_;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+    unsigned long long size_ = 0;
+};
+
+// BLAKE2SP_TREE over a file larger than one chunk: workers take chunks in order from a shared counter, so
+// up to one read per worker is in flight, and the leaves are combined once all of them are in.
+std::string HashTreeParallel(const std::string &path, unsigned long long total, const FileHasher::Progress &progress) {
+    const size_t chunkSize = StreamHasher::kTreeChunkSize;
+    const size_t chunks    = static_cast<size_t>((total + chunkSize - 1) / chunkSize);
+    const size_t workers   = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunks);
+
+    using Leaf = std::array<uint8_t, StreamHasher::kTreeDigestSize>;
+    std::vector<Leaf>   leaves(chunks);
+    std::atomic<size_t> next{0};
+    std::atomic<bool>   failed{false};
+    std::mutex          progressMutex;
+    unsigned long long  hashed = 0;
+
+    auto work = [&] {
+        SequentialFile file;
+        if (!file.open(path)) {
+            failed = true;
+            return;
+        }
+        std::vector<uint8_t> buffer(chunkSize);
+        for (size_t chunk = next++; chunk < chunks && !failed; chunk = next++) {
+            const unsigned long long offset   = static_cast<unsigned long long>(chunk) * chunkSize;
+            const size_t             expected =
+                static_cast<size_t>(std::min<unsigned long long>(chunkSize, total - offset));
+            if (file.readAt(buffer.data(), expected, offset) != static_cast<long long>(expected)) {
+                failed = true;
+                return;
+            }
+            StreamHasher::treeLeaf(buffer.data(), expected, leaves[chunk].data());
+            if (progress) {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                hashed += expected;
+                progress(hashed, total);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; ++i)
+        pool.emplace_back(work);
+    work();
+    for (auto &thread : pool)
+        thread.join();
+    if (failed)
+        return std::string();
+
+    return StreamHasher::treeRoot(leaves.front().data(), leaves.size(), total);
+}
+} // namespace
+
+struct StreamHasher::State {
+    HashAlgorithm      algorithm;
+    Md5                md5;
+    CSha1              sha1;
+    CSha256            sha256;
+    CBlake2sp          treeLeaf;
+    CBlake2sp          treeRoot;
+    size_t             treeLeafFill;
+    unsigned long long treeLength;
+
+    // Closes the current chunk and feeds its digest to the root
+    void finishTreeLeaf() {
+        uint8_t digest[BLAKE2S_DIGEST_SIZE];
+        Blake2sp_Final(&treeLeaf, digest);
+        Blake2sp_Update(&treeRoot, digest, sizeof(digest));
+        Blake2sp_Init(&treeLeaf);
+        treeLeafFill = 0;
+    }
+};
+
+StreamHasher::StreamHasher(HashAlgorithm algorithm) : state_(std::make_unique<State>()) {
+    state_->algorithm = algorithm;
+    PrepareShaKernels();
+    reset();
+}
+
+StreamHasher::~StreamHasher() = default;
+
+HashAlgorithm StreamHasher::algorithm() const {
+    return state_->algorithm;
+}
+
+void StreamHasher::reset() {
+    switch (state_->algorithm) {
+    case HashAlgorithm::MD5:
+        state_->md5.init();
+        break;
+    case HashAlgorithm::SHA1:
+        Sha1_Init(&state_->sha1);
+        break;
+    case HashAlgorithm::SHA256:
+        Sha256_Init(&state_->sha256);
+        break;
+    case HashAlgorithm::BLAKE2SP_TREE:
+        Blake2sp_Init(&state_->treeLeaf);
+        Blake2sp_Init(&state_->treeRoot);
+        state_->treeLeafFill = 0;
+        state_->treeLength   = 0;
+        break;
+    }
+}
+
+void StreamHasher::update(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    switch (state_->algorithm) {
+    case HashAlgorithm::MD5:
+        state_->md5.update(bytes, size);
+        break;
+    case HashAlgorithm::SHA1:
+        Sha1_Update(&state_->sha1, bytes, size);
+        break;
+    case HashAlgorithm::SHA256:
+        Sha256_Update(&state_->sha256, bytes, size);
+        break;
+    case HashAlgorithm::BLAKE2SP_TREE:
+        state_->treeLength += size;
+        while (size != 0) {
+            // A full chunk is only closed once more data arrives, so the last one is never empty
+            if (state_->treeLeafFill == kTreeChunkSize)
+                state_->finishTreeLeaf();
+            const size_t take = std::min(size, kTreeChunkSize - state_->treeLeafFill);
+            Blake2sp_Update(&state_->treeLeaf, bytes, take);
+            state_->treeLeafFill += take;
+            bytes += take;
+            size -= take;
+        }
+        break;
+    }
+}
+
+std::string StreamHasher::finish() {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    switch (state_->algorithm) {
+    case HashAlgorithm::MD5:
+        state_->md5.finish(digest);
+        return ToHex(digest, 16);
+    case HashAlgorithm::SHA1:
+        Sha1_Final(&state_->sha1, digest);
+        return ToHex(digest, SHA1_DIGEST_SIZE);
+    case HashAlgorithm::SHA256:
+        Sha256_Final(&state_->sha256, digest);
+        return ToHex(digest, SHA256_DIGEST_SIZE);
+    case HashAlgorithm::BLAKE2SP_TREE:
+        // Empty input has no chunks at all; the root then covers only the length
+        if (state_->treeLeafFill != 0)
+            state_->finishTreeLeaf();
+        FinishTreeRoot(state_->treeRoot, state_->treeLength, digest);
+        return ToHex(digest, BLAKE2S_DIGEST_SIZE);
+    }
+    return std::string();
+}
+
+const char *StreamHasher::name(HashAlgorithm algorithm) {
+    switch (algorithm) {
+    case HashAlgorithm::MD5:
+        return "md5";
+    case HashAlgorithm::SHA1:
+        return "sha1";
+    case HashAlgorithm::SHA256:
+        return "sha256";
+    case HashAlgorithm::BLAKE2SP_TREE:
+        return "blake2sp-tree";
+    }
+    return "";
+}
+
+bool StreamHasher::parse(const std::string &name, HashAlgorithm &algorithm) {
+    for (HashAlgorithm candidate :
+         {HashAlgorithm::MD5, HashAlgorithm::SHA1, HashAlgorithm::SHA256, HashAlgorithm::BLAKE2SP_TREE}) {
+        if (name == StreamHasher::name(candidate)) {
+            algorithm = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StreamHasher::hardwareAccelerated(HashAlgorithm algorithm) {
+    PrepareShaKernels();
+    switch (algorithm) {
+    case HashAlgorithm::MD5:
+    case HashAlgorithm::BLAKE2SP_TREE:
+        return false;
+    case HashAlgorithm::SHA1: {
+        CSha1 probe;
+        return Sha1_SetFunction(&probe, SHA1_ALGO_HW) != 0;
+    }
+    case HashAlgorithm::SHA256: {
+        CSha256 probe;
+        return Sha256_SetFunction(&probe, SHA256_ALGO_HW) != 0;
+    }
+    }
+    return false;
+}
+
+void StreamHasher::treeLeaf(const void *chunk, size_t size, uint8_t digest[kTreeDigestSize]) {
+    CBlake2sp leaf;
+    Blake2sp_Init(&leaf);
+    Blake2sp_Update(&leaf, static_cast<const Byte *>(chunk), size);
+    Blake2sp_Final(&leaf, digest);
+}
+
+std::string StreamHasher::treeRoot(const uint8_t *leaves, size_t leafCount, unsigned long long length) {
+    CBlake2sp root;
+    Blake2sp_Init(&root);
+    Blake2sp_Update(&root, leaves, leafCount * kTreeDigestSize);
+    uint8_t digest[kTreeDigestSize];
+    FinishTreeRoot(root, length, digest);
+    return ToHex(digest, sizeof(digest));
+}
+
+std::string FileHasher::hashFile(const std::string &path, HashAlgorithm algorithm, const Progress &progress,
+                                 size_t bufferSize) {
+    SequentialFile file;
+    if (!file.open(path))
+        return std::string();
+    const unsigned long long total = file.size();
+    if (algorithm == HashAlgorithm::BLAKE2SP_TREE && total > StreamHasher::kTreeChunkSize)
+        return HashTreeParallel(path, total, progress);
+    StreamHasher hasher(algorithm);
+
+    if (total <= bufferSize) {
+        std::vector<uint8_t> data(static_cast<size_t>(total));
+        const long long      read = total != 0 ? file.read(data.data(), data.size()) : 0;
+        if (read < 0)
+            return std::string();
+        hasher.update(data.data(), static_cast<size_t>(read));
+        if (progress)
+            progress(static_cast<unsigned long long>(read), total);
+        return hasher.finish();
+    }
+
+    // Two buffers: the reader thread fills one while this thread hashes the other. A ready buffer with
+    // length 0 ends the pass (end of file, or a read error when failed is set).
+    struct Buffer {
+        std::vector<uint8_t> data;
+        size_t               length = 0;
+        bool                 ready  = false;
+    };
+    Buffer                  buffers[2];
+    std::mutex              mutex;
+    std::condition_variable changed;
+    bool                    failed = false;
+    for (auto &buffer : buffers)
+        buffer.data.resize(bufferSize);
+
+    std::thread reader([&] {
+        for (int slot = 0;; slot ^= 1) {
+            Buffer &buffer = buffers[slot];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return !buffer.ready; });
+            }
+            const long long read = file.read(buffer.data.data(), bufferSize);
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer.length = read > 0 ? static_cast<size_t>(read) : 0;
+            buffer.ready  = true;
+            failed        = read < 0;
+            changed.notify_all();
+            if (read <= 0)
+                return;
+        }
+    });
+
+    unsigned long long hashed = 0;
+    for (int slot = 0;; slot ^= 1) {
+        Buffer &buffer = buffers[slot];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return buffer.ready; });
+        }
+        if (buffer.length == 0)
+            break;
+        hasher.update(buffer.data.data(), buffer.length);
+        hashed += buffer.length;
+        if (progress)
+            progress(hashed, total);
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.ready = false;
+        changed.notify_all();
+    }
+    reader.join();
+
+    if (failed)
+        return std::string();
+    return hasher.finish();
+}
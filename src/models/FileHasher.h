@@ -0,0 +1,72 @@
+#ifndef FILEHASHER_H
+#define FILEHASHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+enum class HashAlgorithm {
+    MD5,          // what ISOBOOTHASH recorded before BLAKE2SP_TREE
+    SHA1,         // SHA-NI / ARMv8 crypto when available
+    SHA256,       // SHA-NI / ARMv8 crypto when available
+    BLAKE2SP_TREE // BLAKE2sp leaves over fixed-size chunks combined into a root; chunks hash on all cores
+};
+
+// Incremental digest in one of the supported algorithms. SHA-1 and SHA-256 run on the 7-Zip SDK kernels,
+// which pick the hardware-accelerated block functions at runtime when the CPU has them.
+class StreamHasher {
+public:
+    // BLAKE2SP_TREE: the input is split into chunks of this size, each chunk's BLAKE2sp digest is a leaf and
+    // the root is the BLAKE2sp digest of the leaves in order followed by the input length (64-bit LE).
+    // Part of the digest definition, so it never changes.
+    static constexpr size_t kTreeChunkSize  = 1u << 20;
+    static constexpr size_t kTreeDigestSize = 32;
+
+    explicit StreamHasher(HashAlgorithm algorithm);
+    ~StreamHasher();
+    StreamHasher(const StreamHasher &)            = delete;
+    StreamHasher &operator=(const StreamHasher &) = delete;
+
+    HashAlgorithm algorithm() const;
+    void          reset();
+    void          update(const void *data, size_t size);
+
+    // Lowercase hex digest of everything passed to update() since construction or the last reset()
+    std::string finish();
+
+    // "md5", "sha1", "sha256", "blake2sp-tree"
+    static const char *name(HashAlgorithm algorithm);
+    static bool        parse(const std::string &name, HashAlgorithm &algorithm);
+
+    // True if the running CPU hashes algorithm with dedicated instructions
+    static bool hardwareAccelerated(HashAlgorithm algorithm);
+
+    // BLAKE2SP_TREE pieces for callers that see the chunks out of order: the leaf digest of one chunk, and
+    // the lowercase hex root over leafCount leaves (in chunk order) of an input of length bytes
+    static void        treeLeaf(const void *chunk, size_t size, uint8_t digest[kTreeDigestSize]);
+    static std::string treeRoot(const uint8_t *leaves, size_t leafCount, unsigned long long length);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+// Hashes whole files with large reads on a reader thread, so the next block is being read while the
+// current one is hashed. Small files are read and hashed in a single call. BLAKE2SP_TREE files larger than
+// one chunk are hashed by a pool of workers, each reading and hashing whole chunks with its own handle, so
+// both the cores and the device queue are kept busy.
+class FileHasher {
+public:
+    static constexpr size_t kDefaultBufferSize = 4u << 20;
+
+    // (bytes hashed, file size), called after every buffer or chunk; never concurrently, always increasing
+    using Progress = std::function<void(unsigned long long, unsigned long long)>;
+
+    // Digest of the file at path (UTF-8) as lowercase hex; empty if the file cannot be opened or read
+    static std::string hashFile(const std::string &path, HashAlgorithm algorithm, const Progress &progress = nullptr,
+                                size_t bufferSize = kDefaultBufferSize);
+};
+
+#endif // FILEHASHER_H
@@ -0,0 +1,179 @@
+#include "HashMemo.h"
+
+#ifdef _WIN32
+#include "../utils/Utils.h"
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+constexpr const char *kStoreHeader     = "BTHASHMEMO 1";
+constexpr size_t      kMaxMemoEntries  = 32;
+constexpr size_t      kMaxDigestLength = 128;
+} // namespace
+
+HashMemo &HashMemo::instance() {
+#ifdef _WIN32
+    static HashMemo memo(Utils::getExeDirectory() + "logs\\hash_memo.txt");
+#else
+    static HashMemo memo((std::filesystem::temp_directory_path() / "bootthatiso_hash_memo.txt").string());
+#endif
+    return memo;
+}
+
+HashMemo::HashMemo(const std::string &storePath) : storePath_(storePath) {}
+
+bool HashMemo::identify(const std::string &path, FileIdentity &identity) {
+#ifdef _WIN32
+    // Attribute-only access: this works while another process has the image open for writing
+    HANDLE file = CreateFileW(std::filesystem::u8path(path).c_str(), FILE_READ_ATTRIBUTES,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION info{};
+    if (!GetFileInformationByHandle(file, &info)) {
+        CloseHandle(file);
+        return false;
+    }
+    identity.volumeSerial  = info.dwVolumeSerialNumber;
+    identity.fileIdHigh    = 0;
+    identity.fileIdLow     = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    identity.fileSize      = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    identity.lastWriteTime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                             info.ftLastWriteTime.dwLowDateTime;
+
+    // The 64-bit index is not unique on ReFS; prefer the full 128-bit ID and 64-bit serial where available
+    FILE_ID_INFO idInfo{};
+    if (GetFileInformationByHandleEx(file, FileIdInfo, &idInfo, sizeof(idInfo))) {
+        uint64_t low = 0, high = 0;
+        std::memcpy(&low, idInfo.FileId.Identifier, sizeof(low));
+        std::memcpy(&high, idInfo.FileId.Identifier + sizeof(low), sizeof(high));
+        identity.volumeSerial = idInfo.VolumeSerialNumber;
+        identity.fileIdHigh   = high;
+        identity.fileIdLow    = low;
+    }
+    CloseHandle(file);
+    return true;
+#else
+    struct stat info{};
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+    identity.volumeSerial  = static_cast<uint64_t>(info.st_dev);
+    identity.fileIdHigh    = 0;
+    identity.fileIdLow     = static_cast<uint64_t>(info.st_ino);
+    identity.fileSize      = static_cast<uint64_t>(info.st_size);
+    identity.lastWriteTime = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull +
+                             static_cast<uint64_t>(info.st_mtim.tv_nsec);
+    return true;
+#endif
+}
+
+std::string HashMemo::hashFile(const std::string &path, HashAlgorithm algorithm, const FileHasher::Progress &progress) {
+    FileIdentity before;
+    if (!identify(path, before))
+        return FileHasher::hashFile(path, algorithm, progress);
+
+    std::string digest = lookup(before, algorithm);
+    if (!digest.empty())
+        return digest;
+
+    digest = FileHasher::hashFile(path, algorithm, progress);
+
+    // Only keep the digest if the file was not touched while it was being read
+    FileIdentity after;
+    if (!digest.empty() && identify(path, after) && after == before)
+        remember(before, algorithm, digest);
+    return digest;
+}
+
+std::string HashMemo::lookup(const FileIdentity &identity, HashAlgorithm algorithm) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    ensureLoaded();
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry &entry) {
+        return entry.algorithm == algorithm && entry.identity == identity;
+    });
+    if (it == entries_.end())
+        return "";
+    std::rotate(entries_.begin(), it, it + 1);
+    return entries_.front().digest;
+}
+
+void HashMemo::remember(const FileIdentity &identity, HashAlgorithm algorithm, const std::string &digest) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    ensureLoaded();
+    // Earlier digests of the same file are stale now, whatever else changed
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [&](const Entry &entry) {
+                                      return entry.algorithm == algorithm &&
+                                             entry.identity.volumeSerial == identity.volumeSerial &&
+                                             entry.identity.fileIdHigh == identity.fileIdHigh &&
+                                             entry.identity.fileIdLow == identity.fileIdLow;
+                                  }),
+                   entries_.end());
+    entries_.insert(entries_.begin(), Entry{identity, algorithm, digest});
+    if (entries_.size() > kMaxMemoEntries)
+        entries_.resize(kMaxMemoEntries);
+    save();
+}
+
+void HashMemo::ensureLoaded() {
+    if (loaded_)
+        return;
+    loaded_ = true;
+
+    std::ifstream in(std::filesystem::u8path(storePath_));
+    std::string   line;
+    if (!in || !std::getline(in, line) || line != kStoreHeader)
+        return;
+    while (entries_.size() < kMaxMemoEntries && std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string        name;
+        Entry              entry{};
+        fields >> name >> entry.identity.volumeSerial >> entry.identity.fileIdHigh >> entry.identity.fileIdLow >>
+            entry.identity.fileSize >> entry.identity.lastWriteTime >> entry.digest;
+        // Skip anything damaged rather than trusting part of it
+        if (!fields || !StreamHasher::parse(name, entry.algorithm) || entry.digest.size() > kMaxDigestLength ||
+            entry.digest.find_first_not_of("0123456789abcdef") != std::string::npos)
+            continue;
+        entries_.push_back(entry);
+    }
+}
+
+void HashMemo::save() const {
+    const std::filesystem::path finalPath = std::filesystem::u8path(storePath_);
+    std::filesystem::path       tempPath  = finalPath;
+    tempPath += ".tmp";
+
+    std::error_code ec;
+    if (finalPath.has_parent_path())
+        std::filesystem::create_directories(finalPath.parent_path(), ec);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return;
+        out << kStoreHeader << "\n";
+        for (const auto &entry : entries_) {
+            out << StreamHasher::name(entry.algorithm) << ' ' << entry.identity.volumeSerial << ' '
+                << entry.identity.fileIdHigh << ' ' << entry.identity.fileIdLow << ' ' << entry.identity.fileSize
+                << ' ' << entry.identity.lastWriteTime << ' ' << entry.digest << "\n";
+        }
+        if (!out.flush()) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+    // Rename over the old store so a crash never leaves a half-written one behind
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec)
+        std::filesystem::remove(tempPath, ec);
+}
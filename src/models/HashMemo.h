@@ -0,0 +1,63 @@
+#ifndef HASHMEMO_H
+#define HASHMEMO_H
+
+#include "FileHasher.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What identifies the contents of a file without reading it: the volume and file ID/inode pin down the
+// file, size and last-write time change whenever it is rewritten. Any difference means a different file.
+struct FileIdentity {
+    uint64_t volumeSerial  = 0; // volume serial number / st_dev
+    uint64_t fileIdHigh    = 0; // 128-bit file ID (ReFS needs the upper half) / 0
+    uint64_t fileIdLow     = 0; // / st_ino
+    uint64_t fileSize      = 0;
+    uint64_t lastWriteTime = 0; // FILETIME as 100 ns ticks / st_mtim in ns
+
+    bool operator==(const FileIdentity &other) const {
+        return volumeSerial == other.volumeSerial && fileIdHigh == other.fileIdHigh &&
+               fileIdLow == other.fileIdLow && fileSize == other.fileSize && lastWriteTime == other.lastWriteTime;
+    }
+    bool operator!=(const FileIdentity &other) const { return !(*this == other); }
+};
+
+// Digests of whole files keyed by FileIdentity, kept in memory for the run and persisted to a small text
+// store (logs\hash_memo.txt) for the next one, so an unchanged image is never read again just to hash it.
+class HashMemo {
+public:
+    static HashMemo &instance();
+
+    explicit HashMemo(const std::string &storePath);
+    HashMemo(const HashMemo &)            = delete;
+    HashMemo &operator=(const HashMemo &) = delete;
+
+    static bool identify(const std::string &path, FileIdentity &identity);
+
+    // Same result as FileHasher::hashFile; the file is only read when no entry matches its current identity
+    std::string hashFile(const std::string &path, HashAlgorithm algorithm,
+                         const FileHasher::Progress &progress = nullptr);
+
+    // Cached digest for identity, empty if there is none
+    std::string lookup(const FileIdentity &identity, HashAlgorithm algorithm);
+    void        remember(const FileIdentity &identity, HashAlgorithm algorithm, const std::string &digest);
+
+private:
+    struct Entry {
+        FileIdentity  identity;
+        HashAlgorithm algorithm;
+        std::string   digest;
+    };
+
+    void ensureLoaded();
+    void save() const;
+
+    std::mutex         mutex_;
+    std::string        storePath_;
+    std::vector<Entry> entries_; // most recently used first
+    bool               loaded_ = false;
+};
+
+#endif // HASHMEMO_H
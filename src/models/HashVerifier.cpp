@@ -1,36 +1,83 @@
 #include "HashVerifier.h"
-#include "../utils/Utils.h"
+#include "CoverageHasher.h"
+#include "ISOFingerprint.h"
 #include "../../build/version.h"
 #include <fstream>
 
-HashVerifier::HashVerifier() {}
+namespace {
+constexpr const char *kVerifiedByFingerprint = "fingerprint";
+constexpr const char *kVerifiedByHash        = "hash";
+} // namespace
+
+HashVerifier::HashVerifier(HashAlgorithm algorithm, ImageCheck check) : algorithm_(algorithm), check_(check) {}
 
 HashVerifier::~HashVerifier() {}
 
 bool HashVerifier::shouldSkipCopy(const std::string &isoPath, const std::string &hashFilePath, const std::string &mode,
                                   const std::string &format, bool driversInjected) {
-    std::string md5         = calculateMD5(isoPath);
     HashInfo    existing    = readHashInfo(hashFilePath);
     std::string driversFlag = driversInjected ? "1" : "0";
-    return (existing.hash == md5 && existing.version == APP_VERSION && existing.mode == mode &&
-            existing.format == format && existing.driversInjected == driversFlag && !existing.hash.empty());
+    // Compare the cheap fields first; the image is only looked at if they all match
+    return (existing.version == APP_VERSION && existing.mode == mode && existing.format == format &&
+            existing.driversInjected == driversFlag && !extractionPending(hashFilePath) &&
+            matchesImage(isoPath, existing));
 }
 
-void HashVerifier::saveHashInfo(const std::string &hashFilePath, const std::string &md5, const std::string &mode,
-                                const std::string &format, bool driversInjected) {
+void HashVerifier::saveHashInfo(const std::string &hashFilePath, const std::string &hash, HashAlgorithm hashAlgorithm,
+                                const std::string &fingerprint, const std::string &mode, const std::string &format,
+                                bool driversInjected) {
+    const bool    byFingerprint = check_ == ImageCheck::Fingerprint && !fingerprint.empty();
     std::ofstream hashFile(hashFilePath);
     if (hashFile.is_open()) {
-        hashFile << md5 << std::endl;
+        hashFile << hash << std::endl;
         hashFile << APP_VERSION << std::endl;
         hashFile << mode << std::endl;
         hashFile << format << std::endl;
         hashFile << (driversInjected ? "1" : "0") << std::endl;
+        hashFile << fingerprint << std::endl;
+        hashFile << (byFingerprint ? kVerifiedByFingerprint : kVerifiedByHash) << std::endl;
+        hashFile << StreamHasher::name(hashAlgorithm) << std::endl;
         hashFile.close();
     }
 }
 
+void HashVerifier::invalidate(const std::string &hashFilePath) {
+    HashInfo info = readHashInfo(hashFilePath);
+    if (info.version.empty())
+        return; // nothing recorded
+    std::ofstream hashFile(hashFilePath, std::ios::trunc);
+    if (hashFile.is_open()) {
+        hashFile << std::endl; // hash
+        hashFile << info.version << std::endl;
+        hashFile << info.mode << std::endl;
+        hashFile << info.format << std::endl;
+        hashFile << info.driversInjected << std::endl;
+        hashFile << std::endl; // fingerprint
+        hashFile << info.verifiedBy << std::endl;
+        hashFile << info.algorithm << std::endl;
+        hashFile.close();
+    }
+}
+
+bool HashVerifier::extractionPending(const std::string &hashFilePath) {
+    const std::string journalPath = hashFilePath.substr(0, hashFilePath.find_last_of("\\/") + 1) + "ISOJOURNAL";
+    return std::ifstream(journalPath).is_open();
+}
+
+bool HashVerifier::matchesImage(const std::string &isoPath, const HashInfo &existing) {
+    if (check_ == ImageCheck::Fingerprint && existing.verifiedBy == kVerifiedByFingerprint &&
+        !existing.fingerprint.empty()) {
+        return existing.fingerprint == calculateFingerprint(isoPath);
+    }
+    // Hashed in the record's own algorithm, so files written with MD5 still match
+    HashAlgorithm recorded;
+    if (existing.hash.empty() || !recordedAlgorithm(existing, recorded))
+        return false;
+    return existing.hash == HashMemo::instance().hashFile(isoPath, recorded);
+}
+
 HashInfo HashVerifier::readHashInfo(const std::string &path) {
-    HashInfo      info = {"", "", "", "", ""};
+    HashInfo      info = {"", "", "", "", "", "", "", ""};
     std::ifstream file(path);
     if (file.is_open()) {
         std::getline(file, info.hash);
@@ -38,10 +85,60 @@ HashInfo HashVerifier::readHashInfo(const std::string &path) {
         std::getline(file, info.mode);
         std::getline(file, info.format);
         std::getline(file, info.driversInjected);
+        std::getline(file, info.fingerprint);
+        std::getline(file, info.verifiedBy);
+        std::getline(file, info.algorithm);
     }
     return info;
 }
 
-std::string HashVerifier::calculateMD5(const std::string &filePath) {
-    return Utils::calculateMD5(filePath);
-}
\ No newline at end of file
+bool HashVerifier::recordedAlgorithm(const HashInfo &info, HashAlgorithm &algorithm) {
+    if (info.algorithm.empty()) {
+        algorithm = HashAlgorithm::MD5;
+        return true;
+    }
+    return StreamHasher::parse(info.algorithm, algorithm);
+}
+
+HashAlgorithm HashVerifier::algorithm() const {
+    return algorithm_;
+}
+
+std::string HashVerifier::calculateHash(const std::string &filePath) {
+    return HashMemo::instance().hashFile(filePath, algorithm_);
+}
+
+std::future<std::string> HashVerifier::calculateHashAsync(const std::string &filePath) {
+    const HashAlgorithm algorithm = algorithm_;
+    return std::async(std::launch::async,
+                      [filePath, algorithm]() { return HashMemo::instance().hashFile(filePath, algorithm); });
+}
+
+std::shared_ptr<CoverageHasher> HashVerifier::beginContentHash(const std::string &isoPath) {
+    // Only tree leaves can be hashed in whatever order the extraction reads the image
+    if (algorithm_ != HashAlgorithm::BLAKE2SP_TREE || !HashMemo::identify(isoPath, contentIdentity_))
+        return nullptr;
+    if (!HashMemo::instance().lookup(contentIdentity_, algorithm_).empty())
+        return nullptr;
+    return std::make_shared<CoverageHasher>(isoPath);
+}
+
+std::string HashVerifier::finishContentHash(CoverageHasher &hasher) {
+    const std::string digest = hasher.finish();
+    // Same rule as HashMemo::hashFile: only remembered if the image was not touched meanwhile
+    FileIdentity after;
+    if (!digest.empty() && HashMemo::identify(hasher.path(), after) && after == contentIdentity_)
+        HashMemo::instance().remember(contentIdentity_, algorithm_, digest);
+    return digest;
+}
+
+std::string HashVerifier::calculateFingerprint(const std::string &isoPath) {
+    FileIdentity identity;
+    if (!HashMemo::identify(isoPath, identity))
+        return ISOFingerprint::compute(isoPath);
+    if (fingerprint_.empty() || identity != fingerprintIdentity_) {
+        fingerprint_         = ISOFingerprint::compute(isoPath);
+        fingerprintIdentity_ = identity;
+    }
+    return fingerprint_;
+}
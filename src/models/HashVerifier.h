@@ -1,18 +1,72 @@
 #pragma once
+#include <future>
+#include <memory>
 #include <string>
 #include "../../include/models/HashInfo.h"
+#include "FileHasher.h"
+#include "HashMemo.h"
+
+class CoverageHasher;
+
+// How shouldSkipCopy recognizes the image a target was built from
+enum class ImageCheck {
+    Fingerprint, // ISOFingerprint: size, descriptors and sampled blocks, a few MB read
+    FullHash     // the whole image through the hasher
+};
 
 class HashVerifier {
 public:
-    HashVerifier();
+    // algorithm is what new ISOBOOTHASH files record; existing ones are checked in the algorithm they name
+    explicit HashVerifier(HashAlgorithm algorithm = HashAlgorithm::BLAKE2SP_TREE,
+                          ImageCheck check = ImageCheck::Fingerprint);
     ~HashVerifier();
 
+    // Never true while an ISOJOURNAL next to hashFilePath says an extraction into the target was interrupted
     bool shouldSkipCopy(const std::string &isoPath, const std::string &hashFilePath, const std::string &mode,
                         const std::string &format, bool driversInjected);
-    void saveHashInfo(const std::string &hashFilePath, const std::string &md5, const std::string &mode,
-                      const std::string &format, bool driversInjected);
+    void saveHashInfo(const std::string &hashFilePath, const std::string &hash, HashAlgorithm hashAlgorithm,
+                      const std::string &fingerprint, const std::string &mode, const std::string &format,
+                      bool driversInjected);
+
+    // Clears the image hash and fingerprint of the record at hashFilePath, keeping its other fields, so it
+    // matches no image until saveHashInfo runs again: for a target whose content is about to change
+    static void invalidate(const std::string &hashFilePath);
+
+    // True if an extraction into the directory of hashFilePath was interrupted (its ISOJOURNAL is there)
+    static bool extractionPending(const std::string &hashFilePath);
+
+    // True if existing was recorded for the image at isoPath. Uses the fingerprint when both this verifier
+    // and the record allow it, the full hash otherwise (records from earlier versions only have that).
+    bool matchesImage(const std::string &isoPath, const HashInfo &existing);
+
+    HashAlgorithm algorithm() const;
+
+    // Digest of filePath in this verifier's algorithm
+    std::string calculateHash(const std::string &filePath);
+
+    // Same as calculateHash, on its own thread so it can overlap the extraction
+    std::future<std::string> calculateHashAsync(const std::string &filePath);
+
+    // Hasher to feed with the reads of an extraction of isoPath (see ISOReader::setContentHasher), so the
+    // image is hashed without a read of its own. nullptr when that does not apply: the algorithm is not
+    // BLAKE2SP_TREE or the digest is already known, and calculateHashAsync is the way to go.
+    std::shared_ptr<CoverageHasher> beginContentHash(const std::string &isoPath);
+
+    // Digest from a hasher given by beginContentHash, once the extraction is done
+    std::string finishContentHash(CoverageHasher &hasher);
+
+    // ISOFingerprint of isoPath, computed once per file identity
+    std::string calculateFingerprint(const std::string &isoPath);
+
+    static HashInfo readHashInfo(const std::string &path);
+
+    // Algorithm of info.hash: MD5 for records that do not name one, false if the name is unknown
+    static bool recordedAlgorithm(const HashInfo &info, HashAlgorithm &algorithm);
 
 private:
-    HashInfo    readHashInfo(const std::string &path);
-    std::string calculateMD5(const std::string &filePath);
-};
\ No newline at end of file
+    HashAlgorithm algorithm_;
+    ImageCheck    check_;
+    FileIdentity  fingerprintIdentity_;
+    std::string   fingerprint_;
+    FileIdentity  contentIdentity_;
+};
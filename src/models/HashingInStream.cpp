@@ -0,0 +1,64 @@
+#include "HashingInStream.h"
+#include "CoverageHasher.h"
+
+CMyComPtr<IInStream> HashingInStream::wrap(IInStream *inner, CoverageHasher *hasher, HashingInStream **spec) {
+    HashingInStream     *stream = new HashingInStream(inner, hasher);
+    CMyComPtr<IInStream> result;
+    result.Attach(stream);
+    if (spec)
+        *spec = stream;
+    return result;
+}
+
+HashingInStream::HashingInStream(IInStream *inner, CoverageHasher *hasher)
+    : _ref(1), _inner(inner), _hasher(hasher) {}
+
+void HashingInStream::setHasher(CoverageHasher *hasher) {
+    _hasher.store(hasher, std::memory_order_release);
+}
+
+STDMETHODIMP HashingInStream::QueryInterface(REFIID riid, void **ppvObject) {
+    if (!ppvObject)
+        return E_POINTER;
+    *ppvObject = nullptr;
+    if (riid == IID_IUnknown || riid == IID_ISequentialInStream || riid == IID_IInStream) {
+        *ppvObject = static_cast<IInStream *>(this);
+        AddRef();
+        return S_OK;
+    }
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) HashingInStream::AddRef() {
+    return (ULONG)InterlockedIncrement(&_ref);
+}
+
+STDMETHODIMP_(ULONG) HashingInStream::Release() {
+    ULONG r = (ULONG)InterlockedDecrement(&_ref);
+    if (r == 0)
+        delete this;
+    return r;
+}
+
+STDMETHODIMP HashingInStream::Read(void *data, UInt32 size, UInt32 *processedSize) {
+    UInt32  done   = 0;
+    HRESULT result = _inner->Read(data, size, &done);
+    if (processedSize)
+        *processedSize = done;
+    if (done != 0) {
+        if (CoverageHasher *hasher = _hasher.load(std::memory_order_acquire))
+            hasher->add(_pos, data, done);
+        _pos += done;
+    }
+    return result;
+}
+
+STDMETHODIMP HashingInStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) {
+    UInt64  position = 0;
+    HRESULT result   = _inner->Seek(offset, seekOrigin, &position);
+    if (result == S_OK)
+        _pos = position;
+    if (newPosition)
+        *newPosition = _pos;
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef HASHINGINSTREAM_H
+#define HASHINGINSTREAM_H
+
+#include <atomic>
+#include <windows.h>
+
+#include "7zip/IStream.h"
+#include "Common/MyCom.h"
+
+class CoverageHasher;
+
+// Pass-through IInStream over the image stream that hands every byte the handlers read to a
+// CoverageHasher, so the image digest is built from the extraction's own reads. Without a hasher
+// attached it only forwards. The hasher can be attached after the archive was opened; the caller keeps
+// it alive until the stream is released or detached.
+class HashingInStream : public IInStream {
+public:
+    static CMyComPtr<IInStream> wrap(IInStream *inner, CoverageHasher *hasher, HashingInStream **spec = nullptr);
+
+    void setHasher(CoverageHasher *hasher);
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize) override;
+    STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) override;
+
+private:
+    HashingInStream(IInStream *inner, CoverageHasher *hasher);
+    ~HashingInStream() = default;
+
+    LONG                          _ref;
+    CMyComPtr<IInStream>          _inner;
+    std::atomic<CoverageHasher *> _hasher;
+    UInt64                        _pos = 0;
+};
+
+#endif // HASHINGINSTREAM_H
@@ -0,0 +1,452 @@
+#include "ISOCatalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+
+namespace {
+constexpr uint64_t kFnvOffset = 1469598103934665603ULL;
+constexpr uint64_t kFnvPrime  = 1099511628211ULL;
+
+inline uint64_t HashBytes(uint64_t h, const char *data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= kFnvPrime;
+    }
+    return h;
+}
+
+// Hash of "<parent path>/<name>" continuing from the parent's hash
+inline uint64_t HashChild(uint64_t parentHash, bool hasParent, const char *name, size_t length) {
+    uint64_t h = parentHash;
+    if (hasParent) {
+        h ^= static_cast<unsigned char>('/');
+        h *= kFnvPrime;
+    }
+    return HashBytes(h, name, length);
+}
+
+inline bool IsSeparator(char ch) {
+    return ch == '/' || ch == '\\';
+}
+
+void AppendUtf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Splits a path into normalized components (empty components dropped)
+std::vector<std::string> SplitPath(const std::string &path) {
+    std::vector<std::string> parts;
+    std::string              current;
+    for (char ch : path) {
+        if (IsSeparator(ch)) {
+            if (!current.empty())
+                parts.push_back(std::move(current));
+            current.clear();
+        } else {
+            current.push_back(ch);
+        }
+    }
+    if (!current.empty())
+        parts.push_back(std::move(current));
+    return parts;
+}
+} // namespace
+
+uint64_t ISOCatalog::hashBytes(const void *data, size_t length, uint64_t seed) {
+    return HashBytes(seed, static_cast<const char *>(data), length);
+}
+
+std::string ISOCatalog::foldCase(const std::string &text) {
+    std::string out;
+    out.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            out.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : static_cast<char>(c));
+            ++i;
+            continue;
+        }
+        // Decode one UTF-8 sequence; malformed bytes are copied unchanged
+        size_t   extra = 0;
+        uint32_t cp    = 0;
+        if ((c & 0xE0) == 0xC0) {
+            extra = 1;
+            cp    = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            extra = 2;
+            cp    = c & 0x0F;
+        } else if ((c & 0xF8) == 0xF0) {
+            extra = 3;
+            cp    = c & 0x07;
+        } else {
+            out.push_back(static_cast<char>(c));
+            ++i;
+            continue;
+        }
+        bool valid = i + extra < text.size();
+        for (size_t k = 1; valid && k <= extra; ++k) {
+            unsigned char cc = static_cast<unsigned char>(text[i + k]);
+            if ((cc & 0xC0) != 0x80)
+                valid = false;
+            else
+                cp = (cp << 6) | (cc & 0x3F);
+        }
+        if (!valid) {
+            out.push_back(static_cast<char>(c));
+            ++i;
+            continue;
+        }
+        if (cp <= 0xFFFF) {
+            cp = static_cast<uint32_t>(std::towlower(static_cast<wint_t>(cp)));
+        }
+        AppendUtf8(out, cp);
+        i += extra + 1;
+    }
+    return out;
+}
+
+void ISOCatalog::reserve(size_t count) {
+    entries_.reserve(count);
+    firstChild_.reserve(count);
+    lastChild_.reserve(count);
+    nextSibling_.reserve(count);
+    byArchiveIndex_.reserve(count);
+    pool_.reserve(count * 8);
+}
+
+void ISOCatalog::clear() {
+    entries_.clear();
+    pool_.clear();
+    internedNames_.clear();
+    hashIndex_.clear();
+    firstChild_.clear();
+    lastChild_.clear();
+    nextSibling_.clear();
+    byArchiveIndex_.clear();
+    roots_.clear();
+    separator_     = '/';
+    separatorSeen_ = false;
+}
+
+uint32_t ISOCatalog::internName(const char *data, size_t length) {
+    std::string key(data, length);
+    auto        it = internedNames_.find(key);
+    if (it != internedNames_.end())
+        return it->second;
+    const uint32_t offset = static_cast<uint32_t>(pool_.size());
+    pool_.append(data, length);
+    internedNames_.emplace(std::move(key), offset);
+    return offset;
+}
+
+void ISOCatalog::growIndex() {
+    size_t capacity = hashIndex_.empty() ? 1024 : hashIndex_.size() * 2;
+    while (capacity < entries_.size() * 2)
+        capacity *= 2;
+    hashIndex_.assign(capacity, kNone);
+    // Re-insert in entry order so that the first of several equal paths stays first in its probe chain
+    for (uint32_t i = 0; i + 1 < entries_.size(); ++i) {
+        insertIndex(i);
+    }
+}
+
+void ISOCatalog::insertIndex(uint32_t index) {
+    const size_t mask = hashIndex_.size() - 1;
+    size_t       slot = static_cast<size_t>(entries_[index].foldedHash) & mask;
+    while (hashIndex_[slot] != kNone) {
+        slot = (slot + 1) & mask;
+    }
+    hashIndex_[slot] = index;
+}
+
+void ISOCatalog::linkChild(uint32_t parent, uint32_t child) {
+    if (parent == kNone) {
+        roots_.push_back(child);
+        return;
+    }
+    if (lastChild_[parent] == kNone) {
+        firstChild_[parent] = child;
+    } else {
+        nextSibling_[lastChild_[parent]] = child;
+    }
+    lastChild_[parent] = child;
+}
+
+uint32_t ISOCatalog::findChild(uint32_t parent, const char *foldedName, size_t foldedLength,
+                               uint64_t foldedHash) const {
+    if (hashIndex_.empty())
+        return kNone;
+    const size_t mask = hashIndex_.size() - 1;
+    for (size_t slot = static_cast<size_t>(foldedHash) & mask; hashIndex_[slot] != kNone; slot = (slot + 1) & mask) {
+        const Entry &e = entries_[hashIndex_[slot]];
+        if (e.foldedHash == foldedHash && e.parent == parent && e.foldedLength == foldedLength &&
+            pool_.compare(e.foldedOffset, e.foldedLength, foldedName, foldedLength) == 0) {
+            return hashIndex_[slot];
+        }
+    }
+    return kNone;
+}
+
+uint32_t ISOCatalog::add(const std::string &path, uint64_t size, bool isDir, uint32_t archiveIndex,
+                         uint64_t offset) {
+    if (!separatorSeen_) {
+        for (char ch : path) {
+            if (IsSeparator(ch)) {
+                separator_     = ch;
+                separatorSeen_ = true;
+                break;
+            }
+        }
+    }
+
+    const std::vector<std::string> parts = SplitPath(path);
+    if (parts.empty())
+        return kNone;
+
+    uint32_t parent     = kNone;
+    uint64_t parentHash = kFnvOffset;
+    uint32_t result     = kNone;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const bool        leaf   = (i + 1 == parts.size());
+        const std::string folded = foldCase(parts[i]);
+        const uint64_t    h      = HashChild(parentHash, parent != kNone, folded.data(), folded.size());
+
+        // Intermediate components reuse an existing directory; the leaf binds to an implied entry if present
+        uint32_t existing = findChild(parent, folded.data(), folded.size(), h);
+        if (existing != kNone && (!leaf || entries_[existing].archiveIndex == kNone)) {
+            if (leaf) {
+                Entry &e       = entries_[existing];
+                e.archiveIndex = archiveIndex;
+                e.size         = size;
+                e.offset       = offset;
+                e.isDir        = isDir;
+                result         = existing;
+            }
+            parent     = existing;
+            parentHash = h;
+            continue;
+        }
+
+        Entry e{};
+        e.parent       = parent;
+        e.nameOffset   = internName(parts[i].data(), parts[i].size());
+        e.nameLength   = static_cast<uint32_t>(parts[i].size());
+        e.foldedOffset = internName(folded.data(), folded.size());
+        e.foldedLength = static_cast<uint32_t>(folded.size());
+        e.archiveIndex = leaf ? archiveIndex : kNone;
+        e.size         = leaf ? size : 0;
+        e.offset       = leaf ? offset : kNoOffset;
+        e.foldedHash   = h;
+        e.isDir        = leaf ? isDir : true;
+
+        const uint32_t index = static_cast<uint32_t>(entries_.size());
+        entries_.push_back(e);
+        appendLinks(index);
+
+        parent     = index;
+        parentHash = h;
+        result     = index;
+    }
+
+    if (archiveIndex != kNone) {
+        if (byArchiveIndex_.size() <= archiveIndex)
+            byArchiveIndex_.resize(static_cast<size_t>(archiveIndex) + 1, kNone);
+        if (byArchiveIndex_[archiveIndex] == kNone)
+            byArchiveIndex_[archiveIndex] = result;
+    }
+    return result;
+}
+
+// Registers the last pushed entry in the child lists and the hash index
+void ISOCatalog::appendLinks(uint32_t index) {
+    firstChild_.push_back(kNone);
+    lastChild_.push_back(kNone);
+    nextSibling_.push_back(kNone);
+    linkChild(entries_[index].parent, index);
+
+    if (entries_.size() * 2 > hashIndex_.size()) {
+        growIndex();
+    }
+    insertIndex(index);
+}
+
+void ISOCatalog::serialize(std::string &out) const {
+    const uint64_t counts[2] = {static_cast<uint64_t>(entries_.size()), static_cast<uint64_t>(pool_.size())};
+    out.clear();
+    out.reserve(sizeof(counts) + 1 + entries_.size() * sizeof(Entry) + pool_.size());
+    out.append(reinterpret_cast<const char *>(counts), sizeof(counts));
+    out.push_back(separator_);
+    for (const Entry &e : entries_) {
+        out.append(reinterpret_cast<const char *>(&e), sizeof(Entry));
+    }
+    out.append(pool_);
+}
+
+bool ISOCatalog::deserialize(const char *data, size_t size) {
+    clear();
+    uint64_t counts[2] = {0, 0};
+    if (size < sizeof(counts) + 1)
+        return false;
+    std::memcpy(counts, data, sizeof(counts));
+    const size_t headerSize = sizeof(counts) + 1;
+    if (counts[0] > (size - headerSize) / sizeof(Entry) ||
+        counts[1] != size - headerSize - counts[0] * sizeof(Entry) || counts[0] >= kNone) {
+        return false;
+    }
+    separator_     = data[sizeof(counts)];
+    separatorSeen_ = true;
+
+    const size_t count = static_cast<size_t>(counts[0]);
+    const char  *cur   = data + headerSize;
+    pool_.assign(cur + count * sizeof(Entry), static_cast<size_t>(counts[1]));
+    reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Entry e;
+        std::memcpy(&e, cur + i * sizeof(Entry), sizeof(Entry));
+        // Reject anything that would index outside the pool or point forward to a parent not yet linked
+        if ((e.parent != kNone && e.parent >= i) || uint64_t(e.nameOffset) + e.nameLength > pool_.size() ||
+            uint64_t(e.foldedOffset) + e.foldedLength > pool_.size()) {
+            clear();
+            return false;
+        }
+        const uint32_t index = static_cast<uint32_t>(entries_.size());
+        entries_.push_back(e);
+        appendLinks(index);
+        if (e.archiveIndex != kNone) {
+            if (byArchiveIndex_.size() <= e.archiveIndex)
+                byArchiveIndex_.resize(static_cast<size_t>(e.archiveIndex) + 1, kNone);
+            if (byArchiveIndex_[e.archiveIndex] == kNone)
+                byArchiveIndex_[e.archiveIndex] = index;
+        }
+    }
+    return true;
+}
+
+bool ISOCatalog::matchesFolded(uint32_t index, const std::string &foldedPath) const {
+    size_t end = foldedPath.size();
+    while (index != kNone) {
+        const Entry &e = entries_[index];
+        if (e.foldedLength > end)
+            return false;
+        const size_t start = end - e.foldedLength;
+        if (foldedPath.compare(start, e.foldedLength, pool_, e.foldedOffset, e.foldedLength) != 0)
+            return false;
+        if (e.parent == kNone)
+            return start == 0;
+        if (start == 0 || foldedPath[start - 1] != '/')
+            return false;
+        end   = start - 1;
+        index = e.parent;
+    }
+    return false;
+}
+
+uint32_t ISOCatalog::find(const std::string &path) const {
+    if (hashIndex_.empty())
+        return kNone;
+
+    // Normalize to "a/b/c" before folding so the key matches the stored hashes
+    std::string normalized;
+    normalized.reserve(path.size());
+    for (const auto &part : SplitPath(path)) {
+        if (!normalized.empty())
+            normalized.push_back('/');
+        normalized += part;
+    }
+    if (normalized.empty())
+        return kNone;
+    const std::string folded = foldCase(normalized);
+    const uint64_t    h      = HashBytes(kFnvOffset, folded.data(), folded.size());
+
+    const size_t mask = hashIndex_.size() - 1;
+    for (size_t slot = static_cast<size_t>(h) & mask; hashIndex_[slot] != kNone; slot = (slot + 1) & mask) {
+        const uint32_t candidate = hashIndex_[slot];
+        if (entries_[candidate].foldedHash == h && matchesFolded(candidate, folded))
+            return candidate;
+    }
+    return kNone;
+}
+
+std::vector<uint32_t> ISOCatalog::entriesUnder(const std::string &dirPath) const {
+    std::vector<uint32_t> result;
+    std::vector<uint32_t> stack;
+    if (SplitPath(dirPath).empty()) {
+        stack.assign(roots_.rbegin(), roots_.rend());
+    } else {
+        const uint32_t dir = find(dirPath);
+        if (dir == kNone || !entries_[dir].isDir)
+            return result;
+        for (uint32_t child = firstChild_[dir]; child != kNone; child = nextSibling_[child])
+            stack.push_back(child);
+        std::reverse(stack.begin(), stack.end());
+    }
+
+    while (!stack.empty()) {
+        const uint32_t current = stack.back();
+        stack.pop_back();
+        result.push_back(current);
+        const size_t mark = stack.size();
+        for (uint32_t child = firstChild_[current]; child != kNone; child = nextSibling_[child])
+            stack.push_back(child);
+        std::reverse(stack.begin() + static_cast<std::ptrdiff_t>(mark), stack.end());
+    }
+
+    std::stable_sort(result.begin(), result.end(), [this](uint32_t a, uint32_t b) {
+        return entries_[a].archiveIndex < entries_[b].archiveIndex;
+    });
+    return result;
+}
+
+size_t ISOCatalog::size() const {
+    return entries_.size();
+}
+
+const ISOCatalog::Entry &ISOCatalog::entry(uint32_t index) const {
+    return entries_[index];
+}
+
+std::string ISOCatalog::name(uint32_t index) const {
+    const Entry &e = entries_[index];
+    return pool_.substr(e.nameOffset, e.nameLength);
+}
+
+std::string ISOCatalog::fullPath(uint32_t index) const {
+    return relativePath(index, kNone);
+}
+
+std::string ISOCatalog::relativePath(uint32_t index, uint32_t ancestor) const {
+    std::vector<uint32_t> chain;
+    for (uint32_t cur = index; cur != kNone && cur != ancestor; cur = entries_[cur].parent) {
+        chain.push_back(cur);
+    }
+    std::string out;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if (!out.empty())
+            out.push_back(separator_);
+        const Entry &e = entries_[*it];
+        out.append(pool_, e.nameOffset, e.nameLength);
+    }
+    return out;
+}
+
+uint32_t ISOCatalog::byArchiveIndex(uint32_t archiveIndex) const {
+    if (archiveIndex >= byArchiveIndex_.size())
+        return kNone;
+    return byArchiveIndex_[archiveIndex];
+}
@@ -0,0 +1,90 @@
+#ifndef ISOCATALOG_H
+#define ISOCATALOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Flat, interned view of an ISO directory tree built once per opened image.
+// Path components are stored once in a shared string pool; entries reference their parent and name by
+// index/offset. A case-folded full-path hash index answers lookups with a single probe sequence.
+class ISOCatalog {
+public:
+    static constexpr uint32_t kNone     = 0xFFFFFFFFu;
+    static constexpr uint64_t kNoOffset = 0xFFFFFFFFFFFFFFFFULL;
+
+    struct Entry {
+        uint32_t parent;       // entry index of the parent directory, kNone for top-level items
+        uint32_t nameOffset;   // offset of the component name in the string pool
+        uint32_t nameLength;   // byte length of the component name (UTF-8)
+        uint32_t foldedOffset; // offset of the case-folded name in the string pool
+        uint32_t foldedLength;
+        uint32_t archiveIndex; // item index inside the archive, kNone for implied directories
+        uint64_t size;         // uncompressed size in bytes (0 for directories)
+        uint64_t offset;       // byte offset of the first extent in the image, kNoOffset if unknown
+        uint64_t foldedHash;   // hash of the case-folded full path
+        bool     isDir;
+    };
+
+    // Adds an archive item. path is UTF-8 with '/' or '\\' separators; missing parent directories are
+    // created as implied entries and later bound to their archive item if one is added.
+    uint32_t add(const std::string &path, uint64_t size, bool isDir, uint32_t archiveIndex,
+                 uint64_t offset = kNoOffset);
+
+    void reserve(size_t count);
+    void clear();
+
+    // Returns the entry index for path (case-insensitive, either separator) or kNone
+    uint32_t find(const std::string &path) const;
+
+    // All entries below dirPath (recursive), in archive order. Empty dirPath means the whole tree.
+    std::vector<uint32_t> entriesUnder(const std::string &dirPath) const;
+
+    size_t       size() const;
+    const Entry &entry(uint32_t index) const;
+    std::string  name(uint32_t index) const;
+
+    // Full path using the separator observed in the archive's own paths
+    std::string fullPath(uint32_t index) const;
+
+    // Path relative to an ancestor entry (kNone = relative to the root)
+    std::string relativePath(uint32_t index, uint32_t ancestor) const;
+
+    // Entry index for an archive item, kNone if the item was not catalogued
+    uint32_t byArchiveIndex(uint32_t archiveIndex) const;
+
+    // Flat binary image of the entries and string pool (host byte order, no pointers), and its inverse.
+    // deserialize() rebuilds the hash index and child links without re-interning any name.
+    void serialize(std::string &out) const;
+    bool deserialize(const char *data, size_t size);
+
+    // 64-bit FNV-1a, the hash used for path keys; exposed for callers that fingerprint related data
+    static uint64_t hashBytes(const void *data, size_t length, uint64_t seed = 1469598103934665603ULL);
+
+    // Case folding used for every key (UTF-8 in, UTF-8 out)
+    static std::string foldCase(const std::string &text);
+
+private:
+    uint32_t internName(const char *data, size_t length);
+    uint32_t findChild(uint32_t parent, const char *foldedName, size_t foldedLength, uint64_t foldedHash) const;
+    bool     matchesFolded(uint32_t index, const std::string &foldedPath) const;
+    void     insertIndex(uint32_t index);
+    void     growIndex();
+    void     linkChild(uint32_t parent, uint32_t child);
+    void     appendLinks(uint32_t index);
+
+    std::vector<Entry>                        entries_;
+    std::string                               pool_;
+    std::unordered_map<std::string, uint32_t> internedNames_;
+    std::vector<uint32_t>                     hashIndex_; // open addressing, power-of-two capacity
+    std::vector<uint32_t>                     firstChild_;
+    std::vector<uint32_t>                     nextSibling_;
+    std::vector<uint32_t>                     byArchiveIndex_;
+    std::vector<uint32_t>                     lastChild_;
+    std::vector<uint32_t>                     roots_;
+    char                                      separator_     = '/';
+    bool                                      separatorSeen_ = false;
+};
+
+#endif // ISOCATALOG_H
@@ -0,0 +1,183 @@
+#include "ISOCatalogCache.h"
+#include "ISOCatalog.h"
+#include "../utils/Utils.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace {
+constexpr char     kMagic[8]         = {'B', 'T', 'I', 'S', 'O', 'C', 'A', 'T'};
+constexpr uint32_t kFormatVersion    = 1;
+constexpr uint64_t kSectorSize       = 2048;
+constexpr uint64_t kDescriptorFirst  = 16;  // first ISO9660 volume descriptor
+constexpr uint64_t kDescriptorLast   = 64;  // exclusive; covers VDS, UDF VRS and the usual main VDS
+constexpr uint64_t kUdfAnchorSector  = 256; // anchor volume descriptor pointer
+constexpr size_t   kMaxCachedEntries = 8;
+
+struct CacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numItems;
+    uint64_t fileSize;
+    uint64_t lastWriteTime;
+    uint64_t descriptorHash;
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+bool ReadAt(HANDLE file, uint64_t offset, void *buffer, DWORD size, DWORD &read) {
+    LARGE_INTEGER pos;
+    pos.QuadPart = static_cast<LONGLONG>(offset);
+    if (!SetFilePointerEx(file, pos, nullptr, FILE_BEGIN))
+        return false;
+    return ReadFile(file, buffer, size, &read, nullptr) != FALSE;
+}
+
+std::string ToHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string       out(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        out[static_cast<size_t>(i)] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return out;
+}
+} // namespace
+
+ISOCatalogCache::ISOCatalogCache() : directory_(Utils::getExeDirectory() + "logs\\iso_cache") {}
+
+ISOCatalogCache::ISOCatalogCache(const std::string &directory) : directory_(directory) {}
+
+bool ISOCatalogCache::identify(const std::string &isoPath, ISOImageIdentity &identity) {
+    const std::wstring        wpath = Utils::utf8_to_wstring(isoPath);
+    WIN32_FILE_ATTRIBUTE_DATA info{};
+    if (!GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &info))
+        return false;
+    identity.fileSize      = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    identity.lastWriteTime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+                             info.ftLastWriteTime.dwLowDateTime;
+
+    HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    std::vector<char> buffer(static_cast<size_t>((kDescriptorLast - kDescriptorFirst) * kSectorSize));
+    uint64_t          hash = ISOCatalog::hashBytes(&identity.fileSize, sizeof(identity.fileSize));
+    DWORD             read = 0;
+    if (ReadAt(file, kDescriptorFirst * kSectorSize, buffer.data(), static_cast<DWORD>(buffer.size()), read)) {
+        hash = ISOCatalog::hashBytes(buffer.data(), read, hash);
+    }
+    if (ReadAt(file, kUdfAnchorSector * kSectorSize, buffer.data(), static_cast<DWORD>(kSectorSize), read)) {
+        hash = ISOCatalog::hashBytes(buffer.data(), read, hash);
+    }
+    CloseHandle(file);
+
+    identity.descriptorHash = hash;
+    return true;
+}
+
+std::string ISOCatalogCache::entryPath(const ISOImageIdentity &identity) const {
+    return directory_ + "\\" + ToHex(identity.descriptorHash) + "-" + ToHex(identity.fileSize) + ".cat";
+}
+
+bool ISOCatalogCache::load(const ISOImageIdentity &identity, ISOCatalog &catalog, uint32_t &numItems) const {
+    const std::wstring wpath = Utils::utf8_to_wstring(entryPath(identity));
+    HANDLE             file  = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(CacheHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    const char *view = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!view)
+        return false;
+
+    CacheHeader header{};
+    std::memcpy(&header, view, sizeof(header));
+    const char *payload = view + sizeof(header);
+    bool        ok      = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kFormatVersion;
+    ok = ok && header.fileSize == identity.fileSize && header.lastWriteTime == identity.lastWriteTime &&
+         header.descriptorHash == identity.descriptorHash;
+    ok = ok && header.payloadSize == static_cast<uint64_t>(size.QuadPart) - sizeof(header) &&
+         ISOCatalog::hashBytes(payload, static_cast<size_t>(header.payloadSize)) == header.payloadHash;
+    if (ok) {
+        ok       = catalog.deserialize(payload, static_cast<size_t>(header.payloadSize));
+        numItems = header.numItems;
+    }
+    UnmapViewOfFile(view);
+
+    if (!ok) {
+        // Stale or damaged entry (e.g. the image was modified in place): drop it so it gets rebuilt
+        DeleteFileW(wpath.c_str());
+    }
+    return ok;
+}
+
+bool ISOCatalogCache::store(const ISOImageIdentity &identity, const ISOCatalog &catalog, uint32_t numItems) const {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(directory_), ec);
+
+    std::string payload;
+    catalog.serialize(payload);
+
+    CacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version        = kFormatVersion;
+    header.numItems       = numItems;
+    header.fileSize       = identity.fileSize;
+    header.lastWriteTime  = identity.lastWriteTime;
+    header.descriptorHash = identity.descriptorHash;
+    header.payloadSize    = payload.size();
+    header.payloadHash    = ISOCatalog::hashBytes(payload.data(), payload.size());
+
+    // Write to a temporary name and rename so a reader never sees a partial entry
+    const std::wstring finalPath = Utils::utf8_to_wstring(entryPath(identity));
+    const std::wstring tempPath  = finalPath + L".tmp";
+    HANDLE             file =
+        CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    DWORD written = 0;
+    bool  ok      = WriteFile(file, &header, sizeof(header), &written, nullptr) && written == sizeof(header);
+    for (size_t pos = 0; ok && pos < payload.size(); pos += written) {
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(payload.size() - pos, 1u << 24));
+        ok                = WriteFile(file, payload.data() + pos, chunk, &written, nullptr) && written == chunk;
+    }
+    CloseHandle(file);
+    if (!ok || !MoveFileExW(tempPath.c_str(), finalPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+void ISOCatalogCache::prune() const {
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+    for (const auto &item : std::filesystem::directory_iterator(std::filesystem::u8path(directory_), ec)) {
+        if (item.path().extension() == ".cat")
+            entries.emplace_back(item.last_write_time(ec), item.path());
+    }
+    if (entries.size() <= kMaxCachedEntries)
+        return;
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (size_t i = kMaxCachedEntries; i < entries.size(); ++i) {
+        std::filesystem::remove(entries[i].second, ec);
+    }
+}
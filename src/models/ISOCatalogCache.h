@@ -0,0 +1,38 @@
+#ifndef ISOCATALOGCACHE_H
+#define ISOCATALOGCACHE_H
+
+#include <cstdint>
+#include <string>
+
+class ISOCatalog;
+
+// What identifies an ISO image for caching purposes. The descriptor hash covers the ISO9660 volume
+// descriptor set (sectors 16..63, which also holds the UDF recognition and main descriptor sequences on
+// typical images) and the UDF anchor at sector 256, so rebuilding or patching the image invalidates it.
+struct ISOImageIdentity {
+    uint64_t fileSize       = 0;
+    uint64_t lastWriteTime  = 0; // FILETIME as 100 ns ticks
+    uint64_t descriptorHash = 0;
+};
+
+// Persistent catalog store under logs\iso_cache. Each entry is a single file: a fixed header followed
+// by the ISOCatalog::serialize() payload, read back through a read-only file mapping.
+class ISOCatalogCache {
+public:
+    ISOCatalogCache();
+    explicit ISOCatalogCache(const std::string &directory);
+
+    static bool identify(const std::string &isoPath, ISOImageIdentity &identity);
+
+    // Fills catalog and numItems when a valid entry exists for identity
+    bool load(const ISOImageIdentity &identity, ISOCatalog &catalog, uint32_t &numItems) const;
+    bool store(const ISOImageIdentity &identity, const ISOCatalog &catalog, uint32_t numItems) const;
+
+private:
+    std::string entryPath(const ISOImageIdentity &identity) const;
+    void        prune() const;
+
+    std::string directory_;
+};
+
+#endif // ISOCATALOGCACHE_H
@@ -0,0 +1,99 @@
+#include "ISOFingerprint.h"
+#include "FileHasher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+constexpr uint64_t kSectorSize         = 2048;
+constexpr uint64_t kDescriptorFirst    = 16;  // first ISO9660 volume descriptor
+constexpr uint64_t kDescriptorLast     = 64;  // exclusive; covers VDS, UDF VRS and the usual main VDS
+constexpr uint64_t kUdfAnchorSector    = 256; // anchor volume descriptor pointer
+constexpr uint32_t kMaxVdsSectors      = 64;
+constexpr uint32_t kMaxIntegritySize   = 64 * 1024;
+constexpr uint16_t kTagAnchor          = 2;
+constexpr uint16_t kTagLogicalVolume   = 6;
+constexpr uint16_t kTagTerminating     = 8;
+constexpr uint16_t kTagIntegrity       = 9;
+constexpr size_t   kLvdIntegrityExtent = 432; // extent_ad in the logical volume descriptor
+
+uint16_t Get16(const char *p) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8));
+}
+
+uint32_t Get32(const char *p) {
+    return static_cast<uint32_t>(Get16(p)) | (static_cast<uint32_t>(Get16(p + 2)) << 16);
+}
+
+// Bytes read at offset (fewer near the end of the file)
+size_t ReadAt(std::ifstream &in, uint64_t offset, char *buffer, size_t size) {
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(buffer, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(in.gcount());
+}
+
+// The LVID changes whenever the volume is rewritten by a UDF-aware tool, even if nothing else sampled does
+bool ReadIntegrityDescriptor(std::ifstream &in, std::vector<char> &out) {
+    char sector[kSectorSize];
+    if (ReadAt(in, kUdfAnchorSector * kSectorSize, sector, kSectorSize) != kSectorSize || Get16(sector) != kTagAnchor)
+        return false;
+    const uint32_t vdsSectors  =
+        std::min<uint32_t>(Get32(sector + 16) / static_cast<uint32_t>(kSectorSize), kMaxVdsSectors);
+    const uint32_t vdsLocation = Get32(sector + 20);
+
+    for (uint32_t i = 0; i < vdsSectors; ++i) {
+        if (ReadAt(in, (static_cast<uint64_t>(vdsLocation) + i) * kSectorSize, sector, kSectorSize) != kSectorSize)
+            return false;
+        const uint16_t tag = Get16(sector);
+        if (tag == kTagTerminating)
+            return false;
+        if (tag != kTagLogicalVolume)
+            continue;
+
+        const uint32_t length   = std::min<uint32_t>(Get32(sector + kLvdIntegrityExtent), kMaxIntegritySize);
+        const uint32_t location = Get32(sector + kLvdIntegrityExtent + 4);
+        if (length == 0)
+            return false;
+        out.resize(length);
+        out.resize(ReadAt(in, static_cast<uint64_t>(location) * kSectorSize, out.data(), length));
+        return out.size() >= 2 && Get16(out.data()) == kTagIntegrity;
+    }
+    return false;
+}
+} // namespace
+
+std::string ISOFingerprint::compute(const std::string &isoPath) {
+    std::ifstream in(std::filesystem::u8path(isoPath), std::ios::binary);
+    if (!in)
+        return "";
+    in.seekg(0, std::ios::end);
+    const std::streamoff end = in.tellg();
+    if (end <= 0)
+        return "";
+    const uint64_t fileSize = static_cast<uint64_t>(end);
+
+    StreamHasher hasher(HashAlgorithm::SHA256);
+    char         sizeBytes[8];
+    for (int i = 0; i < 8; ++i)
+        sizeBytes[i] = static_cast<char>(fileSize >> (8 * i));
+    hasher.update(sizeBytes, sizeof(sizeBytes));
+
+    std::vector<char> buffer(static_cast<size_t>((kDescriptorLast - kDescriptorFirst) * kSectorSize));
+    hasher.update(buffer.data(), ReadAt(in, kDescriptorFirst * kSectorSize, buffer.data(), buffer.size()));
+
+    std::vector<char> integrity;
+    if (ReadIntegrityDescriptor(in, integrity))
+        hasher.update(integrity.data(), integrity.size());
+
+    // Samples at fixed, sector-aligned fractions of the file, first and last block included
+    buffer.resize(kSampleSize);
+    const uint64_t span = fileSize > kSampleSize ? fileSize - kSampleSize : 0;
+    for (uint32_t i = 0; i < kSampleCount; ++i) {
+        const uint64_t offset = span / (kSampleCount - 1) * i / kSectorSize * kSectorSize;
+        hasher.update(buffer.data(), ReadAt(in, i + 1 == kSampleCount ? span : offset, buffer.data(), kSampleSize));
+    }
+    return hasher.finish();
+}
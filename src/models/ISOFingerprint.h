@@ -0,0 +1,19 @@
+#ifndef ISOFINGERPRINT_H
+#define ISOFINGERPRINT_H
+
+#include <cstdint>
+#include <string>
+
+// Cheap stand-in for a full-content hash when deciding whether a target already holds an image: SHA-256
+// over the image size, the volume descriptor set, the UDF logical volume integrity descriptor and a fixed
+// set of blocks sampled across the whole file. About 4 MB is read regardless of the image size.
+class ISOFingerprint {
+public:
+    static constexpr uint32_t kSampleCount = 64;
+    static constexpr uint32_t kSampleSize  = 64 * 1024;
+
+    // Lowercase hex, empty if the image cannot be read
+    static std::string compute(const std::string &isoPath);
+};
+
+#endif // ISOFINGERPRINT_H
@@ -7,19 +7,36 @@
 #include <string>
 #include <unordered_map>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 #include <windows.h>
 #include <OleAuto.h>
 
 #include "../utils/Utils.h"
+#include "../utils/PatternMatcher.h"
 
+#include "CoverageHasher.h"
 #include "EventManager.h"
+#include "ExtractionJournal.h"
+#include "ExtractionManifest.h"
+#include "ISOCatalog.h"
+#include "ISOCatalogCache.h"
+#include "HashingInStream.h"
+#include "MappedInStream.h"
+#include "PEHeaderValidator.h"
+#include "PrefetchInStream.h"
+#include "WriteBehindQueue.h"
 
 // 7-Zip SDK headers
 #include "7zip/Archive/IArchive.h"
 #include "7zip/PropID.h"
 #include "7zip/Common/FileStreams.h"
+#include "7zip/Common/StreamUtils.h"
 #include "Common/MyCom.h"
 #include "Windows/PropVariant.h"
+#include "7zCrc.h"
 
 // Functions exported by ArchiveExports.cpp (linked statically)
 STDAPI CreateArchiver(const GUID *clsid, const GUID *iid, void **outObject);
@@ -100,6 +117,240 @@ bool GetIsoHandlerClsid(GUID &outClsid) {
     return false;
 }
 
+// Content hash of an item written by a pass (see ExtractionManifest), by archive index. Each slot is
+// only ever written by the worker that extracted the item.
+struct ItemHash {
+    UInt64 size  = 0;
+    UInt64 hash  = 0;
+    bool   known = false;
+};
+
+// Watches the data of one item as it is written. For the extraction journal it emits a chunk record with
+// the CRC of every full ExtractionJournal::kChunkSize chunk and a completion record with the CRC of the
+// remainder; for the manifest (and the journal) it hashes the whole item; for a PE image report it checks
+// the headers. Data going through a WriteBehindQueue is journaled once the queue has written it, and the
+// completion record once the file's handle is closed.
+class OutputTap {
+public:
+    // Starts an item at offset, hashState being the manifest hash state over the bytes before it
+    void begin(ExtractionJournal *journal, std::vector<ItemHash> *hashes, UInt32 index, UInt64 offset = 0,
+               UInt64 hashState = ExtractionManifest::hashInit()) {
+        _journal = journal;
+        _hashes  = hashes;
+        _images  = nullptr;
+        _index   = index;
+        _written = offset;
+        _crc     = CRC_INIT_VAL;
+        _hash    = hashState;
+    }
+    // The item is written through queue into file
+    void writeThrough(WriteBehindQueue *queue, std::shared_ptr<WriteBehindQueue::File> file) {
+        _queue = queue;
+        _file  = std::move(file);
+    }
+    // Final manifest hash of the item; valid after update() has seen all of it
+    UInt64 hash() const {
+        return ExtractionManifest::hashFinal(_hash);
+    }
+    // Records the item's PE headers in report under path when it ends; only from the first byte
+    void watchImage(PEImageReport *report, std::string path) {
+        if (!report || _written != 0)
+            return;
+        _images    = report;
+        _imagePath = std::move(path);
+        _validator.reset();
+    }
+    bool active() const {
+        return _journal || _hashes || _images;
+    }
+    void update(const void *data, size_t size) {
+        if (_images && !_validator.complete())
+            _validator.update(data, size);
+        if (!_journal) {
+            if (_hashes)
+                _hash = ExtractionManifest::hashUpdate(_hash, data, size);
+            _written += size;
+            return;
+        }
+        const Byte *p = static_cast<const Byte *>(data);
+        while (size > 0) {
+            const UInt64 room = ExtractionJournal::kChunkSize - _written % ExtractionJournal::kChunkSize;
+            const size_t n    = static_cast<size_t>(std::min<UInt64>(room, size));
+            _crc              = CrcUpdate(_crc, p, n);
+            _hash             = ExtractionManifest::hashUpdate(_hash, p, n);
+            _written += n;
+            p += n;
+            size -= n;
+            if (_written % ExtractionJournal::kChunkSize == 0) {
+                ExtractionJournal *journal = _journal;
+                const UInt32       index   = _index;
+                const UInt64       chunk   = _written / ExtractionJournal::kChunkSize - 1;
+                const UInt32       crc     = CRC_GET_DIGEST(_crc);
+                const UInt64       state   = _hash;
+                if (_queue) {
+                    _queue->after(*_file, [journal, index, chunk, crc, state](bool written) {
+                        if (written)
+                            journal->recordChunk(index, chunk, crc, state);
+                    });
+                } else {
+                    journal->recordChunk(index, chunk, crc, state);
+                }
+                _crc = CRC_INIT_VAL;
+            }
+        }
+    }
+    // Ends the item; only a successfully decoded one is recorded
+    void end(bool ok) {
+        if (_journal && ok) {
+            ExtractionJournal *journal = _journal;
+            const UInt32       index   = _index;
+            const UInt64       size    = _written;
+            const UInt32       crc     = CRC_GET_DIGEST(_crc);
+            const UInt64       state   = _hash;
+            if (_queue) {
+                _queue->afterClose(*_file, [journal, index, size, crc, state](bool closed) {
+                    if (closed)
+                        journal->recordComplete(index, size, crc, state);
+                });
+            } else {
+                journal->recordComplete(index, size, crc, state);
+            }
+        }
+        if (_hashes && ok)
+            (*_hashes)[_index] = {_written, hash(), true};
+        if (_images && ok)
+            _images->record(_imagePath, _validator.info());
+        _journal = nullptr;
+        _hashes  = nullptr;
+        _images  = nullptr;
+        _queue   = nullptr;
+        _file.reset();
+    }
+
+private:
+    ExtractionJournal                      *_journal = nullptr;
+    std::vector<ItemHash>                  *_hashes  = nullptr;
+    PEImageReport                          *_images  = nullptr;
+    WriteBehindQueue                       *_queue   = nullptr;
+    std::shared_ptr<WriteBehindQueue::File> _file;
+    UInt32                                  _index   = 0;
+    UInt64                                  _written = 0;
+    UInt32                                  _crc     = CRC_INIT_VAL;
+    UInt64                                  _hash    = 0;
+    PEHeaderValidator                       _validator;
+    std::string                             _imagePath;
+};
+
+// ISequentialOutStream over a WriteBehindQueue file: Write() only copies into the staging buffer, and
+// the final Release() hands the tail and the handle close to the queue's thread
+class QueuedOutStream : public ISequentialOutStream {
+public:
+    QueuedOutStream(WriteBehindQueue &queue, std::shared_ptr<WriteBehindQueue::File> file, OutputTap *tap = nullptr)
+        : _ref(1), _queue(queue), _file(std::move(file)), _tap(tap) {}
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObject) override {
+        if (!ppvObject)
+            return E_POINTER;
+        *ppvObject = nullptr;
+        if (riid == IID_IUnknown || riid == IID_ISequentialOutStream) {
+            *ppvObject = static_cast<ISequentialOutStream *>(this);
+            AddRef();
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    STDMETHOD_(ULONG, AddRef)() override {
+        return (ULONG)InterlockedIncrement(&_ref);
+    }
+    STDMETHOD_(ULONG, Release)() override {
+        ULONG r = (ULONG)InterlockedDecrement(&_ref);
+        if (r == 0)
+            delete this;
+        return r;
+    }
+
+    STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize) override {
+        if (processedSize)
+            *processedSize = 0;
+        if (!_queue.write(*_file, data, size))
+            return E_FAIL;
+        if (_tap)
+            _tap->update(data, size);
+        if (processedSize)
+            *processedSize = size;
+        return S_OK;
+    }
+
+private:
+    ~QueuedOutStream() {
+        _queue.close(*_file);
+    }
+    LONG                                    _ref;
+    WriteBehindQueue                       &_queue;
+    std::shared_ptr<WriteBehindQueue::File> _file;
+    OutputTap                              *_tap;
+};
+
+// Progress of one extraction pass. The handler thread only stores counters (atomics, so another thread
+// may sample them); publish() forwards them to the EventManager at most every kPublishInterval, or sooner
+// when the current item changed, and builds the "Extrayendo: <path>" message only at that point, reusing
+// one string buffer.
+class ExtractProgress {
+public:
+    ExtractProgress(IInArchive *archive, EventManager *eventManager) : _archive(archive), _eventManager(eventManager) {}
+
+    void setTotal(UInt64 total) {
+        _total = total;
+    }
+    void setCompleted(UInt64 completed) {
+        _completed = completed;
+    }
+    void setItem(UInt32 index) {
+        _item = index;
+    }
+
+    // Called on the handler thread (the only one allowed to query the archive)
+    void publish() {
+        if (!_eventManager)
+            return;
+        const auto   now       = std::chrono::steady_clock::now();
+        const UInt32 item      = _item.load();
+        const UInt64 completed = _completed.load();
+        const UInt64 total     = _total.load();
+        const bool   finished  = total != 0 && completed >= total;
+        const auto   elapsed   = now - _lastPublish;
+        if (!finished && elapsed < kPublishInterval && (item == _publishedItem || elapsed < kMinItemInterval))
+            return;
+        _lastPublish = now;
+
+        if (item != _publishedItem) {
+            _publishedItem = item;
+            _message.assign("Extrayendo: ");
+            NWindows::NCOM::CPropVariant prop;
+            if (item != kNoItem && _archive->GetProperty(item, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR &&
+                prop.bstrVal) {
+                _message.append(WideToUtf8(std::wstring(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal))));
+            }
+        }
+        _eventManager->notifyDetailedProgress(static_cast<long long>(completed), static_cast<long long>(total),
+                                              _message);
+    }
+
+private:
+    static constexpr UInt32                    kNoItem          = (UInt32)(Int32)-1;
+    static constexpr std::chrono::milliseconds kPublishInterval = std::chrono::milliseconds(50); // 20 Hz
+    static constexpr std::chrono::milliseconds kMinItemInterval = std::chrono::milliseconds(10);
+
+    IInArchive                           *_archive;
+    EventManager                         *_eventManager;
+    std::atomic<UInt64>                   _total{0};
+    std::atomic<UInt64>                   _completed{0};
+    std::atomic<UInt32>                   _item{kNoItem};
+    UInt32                                _publishedItem = kNoItem;
+    std::chrono::steady_clock::time_point _lastPublish;
+    std::string                           _message;
+};
+
 // Extract callback implementation: writes files under baseDir
 class ExtractCallback : public IArchiveExtractCallback {
 public:
@@ -108,7 +359,7 @@ public:
                              std::function<void(unsigned long long, unsigned long long)> progressCb    = nullptr,
                              EventManager                                               *eventManager  = nullptr)
         : _ref(1), _archive(arc), _baseDir(base), _overridePaths(overridePaths), _progressCallback(progressCb),
-          _eventManager(eventManager) {
+          _progress(arc, eventManager) {
         if (!_baseDir.empty() && (_baseDir.back() == L'/' || _baseDir.back() == L'\\')) {
             _baseDir.pop_back();
         }
@@ -143,15 +394,18 @@ public:
     // IProgress
     STDMETHOD(SetTotal)(UInt64 total) override {
         _totalBytes = total;
+        _progress.setTotal(total);
         return S_OK;
     }
     STDMETHOD(SetCompleted)(const UInt64 *completeValue) override {
+        if (_abortFlag && _abortFlag->load())
+            return E_ABORT;
         if (completeValue && _progressCallback) {
             _progressCallback(*completeValue, _totalBytes);
         }
-        if (_eventManager && !_currentFile.empty()) {
-            std::string progressMsg = "Extrayendo: " + WideToUtf8(_currentFile);
-            _eventManager->notifyDetailedProgress(*completeValue, _totalBytes, progressMsg);
+        if (completeValue) {
+            _progress.setCompleted(*completeValue);
+            _progress.publish();
         }
         return S_OK;
     }
@@ -161,15 +415,16 @@ public:
         if (!outStream)
             return E_POINTER;
         *outStream = nullptr;
+        _tap.end(false);
         if (askExtractMode != NArchive::NExtract::NAskMode::kExtract)
             return S_OK;
+        _progress.setItem(index);
 
         // get item path
         NWindows::NCOM::CPropVariant prop;
         std::wstring                 relPath;
         if (_archive->GetProperty(index, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
             relPath.assign(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            _currentFile = relPath; // Set current file for progress
         }
         NWindows::NCOM::PropVariant_Clear(&prop);
 
@@ -204,6 +459,23 @@ public:
 
         std::filesystem::create_directories(outPath.parent_path(), ec);
 
+        if (_writeQueue) {
+            UInt64 size = 0;
+            if (_archive->GetProperty(index, kpidSize, &prop) == S_OK && prop.vt == VT_UI8) {
+                size = prop.uhVal.QuadPart;
+            }
+            NWindows::NCOM::PropVariant_Clear(&prop);
+            auto file = _writeQueue->open(outPath.native(), size);
+            if (!file)
+                return S_OK; // skip file on failure to create
+            _tap.begin(_journal, _itemHashes, index);
+            _tap.writeThrough(_writeQueue, file);
+            if (_imageReport && PEHeaderValidator::isImageName(outPath.native()))
+                _tap.watchImage(_imageReport, WideToUtf8(outPath.native()));
+            *outStream = new QueuedOutStream(*_writeQueue, std::move(file), _tap.active() ? &_tap : nullptr);
+            return S_OK;
+        }
+
         // create file stream
         CMyComPtr<ISequentialOutStream> out;
         COutFileStream                 *fileSpec = new COutFileStream();
@@ -218,10 +490,36 @@ public:
     STDMETHOD(PrepareOperation)(Int32) override {
         return S_OK;
     }
-    STDMETHOD(SetOperationResult)(Int32) override {
+    STDMETHOD(SetOperationResult)(Int32 opRes) override {
+        _tap.end(opRes == NArchive::NExtract::NOperationResult::kOK);
         return S_OK;
     }
 
+    // Makes the running Extract() stop with E_ABORT at the next progress callback once *flag is set
+    void setAbortFlag(const std::atomic<bool> *flag) {
+        _abortFlag = flag;
+    }
+
+    // Routes file data through queue instead of a synchronous COutFileStream per item
+    void setWriteQueue(WriteBehindQueue *queue) {
+        _writeQueue = queue;
+    }
+
+    // Records every file written through the queue in journal (see ExtractionJournal)
+    void setJournal(ExtractionJournal *journal) {
+        _journal = journal;
+    }
+
+    // Stores the content hash of every file written through the queue in hashes[index]
+    void setItemHashes(std::vector<ItemHash> *hashes) {
+        _itemHashes = hashes;
+    }
+
+    // Records the PE headers of every .efi/.exe/.dll written through the queue in report
+    void setImageReport(PEImageReport *report) {
+        _imageReport = report;
+    }
+
 private:
     ~ExtractCallback() = default;
     LONG                                                        _ref;
@@ -229,28 +527,181 @@ private:
     std::wstring                                                _baseDir;
     const std::unordered_map<UInt32, std::wstring>             *_overridePaths;
     std::function<void(unsigned long long, unsigned long long)> _progressCallback;
-    EventManager                                               *_eventManager;
-    std::wstring                                                _currentFile;
+    ExtractProgress                                             _progress;
     UInt64                                                      _totalBytes = 0;
+    const std::atomic<bool>                                    *_abortFlag   = nullptr;
+    WriteBehindQueue                                           *_writeQueue  = nullptr;
+    ExtractionJournal                                          *_journal     = nullptr;
+    std::vector<ItemHash>                                      *_itemHashes  = nullptr;
+    PEImageReport                                              *_imageReport = nullptr;
+    OutputTap                                                   _tap;
 };
 
+// Runs Extract() with output going through a write-behind queue, and waits for the queue so that a true
+// result means every file was written and closed. PE images written are checked into images, if given.
+bool RunExtract(IInArchive *archive, const UInt32 *indices, UInt32 count, ExtractCallback *spec,
+                PEImageReport *images) {
+    CMyComPtr<IArchiveExtractCallback> cb;
+    cb.Attach(spec); // adopt the constructor's reference
+    WriteBehindQueue writer;
+    spec->setWriteQueue(&writer);
+    spec->setImageReport(images);
+    const HRESULT result  = archive->Extract(indices, count, 0, cb);
+    const bool    written = writer.finish();
+    spec->setWriteQueue(nullptr);
+    return result == S_OK && written;
+}
+
+// The data of one item through the handler's IInArchiveGetStream (both Udf and Iso provide it), without
+// going through an extract callback or the filesystem
+bool OpenEntryStream(IInArchive *archive, UInt32 index, CMyComPtr<ISequentialInStream> &stream) {
+    CMyComPtr<IInArchiveGetStream> getStream;
+    if (archive->QueryInterface(IID_IInArchiveGetStream, (void **)&getStream) != S_OK || !getStream)
+        return false;
+    return getStream->GetStream(index, &stream) == S_OK && stream;
+}
+
+// Decodes one item straight into memory
+bool ReadEntry(IInArchive *archive, UInt32 index, void *buffer, size_t size) {
+    CMyComPtr<ISequentialInStream> stream;
+    if (!OpenEntryStream(archive, index, stream))
+        return false;
+    size_t processed = size;
+    return ReadStream(stream, buffer, &processed) == S_OK && processed == size;
+}
+
+// Manifest hash of one item's content in the image
+bool HashEntry(IInArchive *archive, UInt32 index, UInt64 size, UInt64 &hash) {
+    CMyComPtr<ISequentialInStream> stream;
+    if (!OpenEntryStream(archive, index, stream))
+        return false;
+    std::vector<Byte> buffer(WriteBehindQueue::kDefaultBufferSize);
+    UInt64            state = ExtractionManifest::hashInit();
+    for (UInt64 remaining = size; remaining > 0;) {
+        size_t processed = (size_t)std::min<UInt64>(remaining, buffer.size());
+        if (ReadStream(stream, buffer.data(), &processed) != S_OK || processed == 0)
+            return false;
+        state = ExtractionManifest::hashUpdate(state, buffer.data(), processed);
+        remaining -= processed;
+    }
+    hash = ExtractionManifest::hashFinal(state);
+    return true;
+}
+
+// Finishes an item a previous pass left half-written: the handler's stream is positioned at offset (a
+// chunk boundary the journal verified) and the rest is appended to the existing file, journaling further
+// chunks as they complete. hashState is the journaled manifest hash state at offset; hash receives the
+// item's manifest hash. False if the handler's stream is not seekable or any read/write fails.
+bool ResumeEntry(IInArchive *archive, UInt32 index, UInt64 size, UInt64 offset, UInt64 hashState,
+                 const std::wstring &path, ExtractionJournal &journal, UInt64 &hash) {
+    CMyComPtr<ISequentialInStream> sequential;
+    if (!OpenEntryStream(archive, index, sequential))
+        return false;
+    CMyComPtr<IInStream> stream;
+    if (sequential.QueryInterface(IID_IInStream, &stream) != S_OK || !stream ||
+        stream->Seek((Int64)offset, STREAM_SEEK_SET, nullptr) != S_OK)
+        return false;
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)offset;
+    bool ok      = SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+
+    OutputTap tap;
+    tap.begin(&journal, nullptr, index, offset, hashState);
+    std::vector<Byte> buffer(WriteBehindQueue::kDefaultBufferSize);
+    for (UInt64 remaining = size - offset; ok && remaining > 0;) {
+        size_t processed = (size_t)std::min<UInt64>(remaining, buffer.size());
+        DWORD  written   = 0;
+        ok = ReadStream(stream, buffer.data(), &processed) == S_OK && processed > 0 &&
+             WriteFile(file, buffer.data(), (DWORD)processed, &written, nullptr) && written == processed;
+        if (ok) {
+            tap.update(buffer.data(), processed);
+            remaining -= processed;
+        }
+    }
+    ok = CloseHandle(file) && ok;
+    tap.end(ok);
+    hash = tap.hash();
+    return ok;
+}
+
+// Drops from entries the files an interrupted pass already finished according to the journal, and
+// completes the ones it left half-written from their last verified chunk. When a manifest is being built,
+// their content hash comes from the journal. Returns how many files need no further extraction.
+size_t ResumeFromJournal(IInArchive *archive, const ISOCatalog &catalog, const std::string &destDir,
+                         ExtractionJournal &journal, std::vector<uint32_t> &entries, ExtractionManifest *manifest) {
+    const std::filesystem::path base    = std::filesystem::u8path(destDir);
+    size_t                      resumed = 0;
+    auto                        done    = [&](uint32_t entry) {
+        const ISOCatalog::Entry &e = catalog.entry(entry);
+        if (e.isDir || e.archiveIndex == ISOCatalog::kNone)
+            return false;
+        const std::wstring path      = (base / Utf8ToWide(catalog.fullPath(entry))).wstring();
+        UInt64             offset    = 0;
+        UInt64             hashState = 0;
+        if (!journal.resumePoint(e.archiveIndex, e.size, path, offset, hashState))
+            return false;
+        UInt64     hash     = ExtractionManifest::hashFinal(hashState);
+        const bool finished = offset == e.size ||
+                              ResumeEntry(archive, e.archiveIndex, e.size, offset, hashState, path, journal, hash);
+        if (!finished)
+            return false;
+        if (manifest)
+            manifest->add(catalog.fullPath(entry), e.size, hash);
+        ++resumed;
+        return true;
+    };
+    entries.erase(std::remove_if(entries.begin(), entries.end(), done), entries.end());
+    return resumed;
+}
+
 struct OpenResult {
     CMyComPtr<IInArchive> archive;      // the actual filesystem archive (UDF/ISO)
     CMyComPtr<IInStream>  inStream;     // stream backing 'archive'
     CMyComPtr<IUnknown>   outerArchive; // holds outer Ext archive alive if substream is used
-    bool                  ok = false;
+    CMyComPtr<IInStream>  baseStream;   // the image itself (same as inStream unless unwrapped from Ext)
+    // Concrete baseStream object when the image is read through PrefetchInStream
+    PrefetchInStream *prefetch = nullptr;
+    // Outermost wrapper of the image stream, where a content hasher is attached
+    HashingInStream *tee = nullptr;
+    bool             ok  = false;
 };
 
-OpenResult OpenIsoArchive(const std::wstring &isoPath) {
+void AddReadStats(const OpenResult &opened, ISOReadStats &stats) {
+    if (!opened.prefetch)
+        return;
+    const PrefetchInStream::Stats current = opened.prefetch->stats();
+    stats.hits += current.hits;
+    stats.misses += current.misses;
+    stats.bytesPrefetched += current.bytesPrefetched;
+    stats.bytesDiscarded += current.bytesDiscarded;
+}
+
+OpenResult OpenIsoArchive(const std::wstring &isoPath, CoverageHasher *contentHasher = nullptr) {
     OpenResult   res;
     const UInt64 kMaxCheckStartPosition = 1 << 20; // 1 MiB scan window
 
-    // Open base file stream
-    CInFileStream       *fileSpec = new CInFileStream();
-    CMyComPtr<IInStream> file     = fileSpec;
-    if (!fileSpec->Open(isoPath.c_str())) {
-        return res;
+    // Open base file stream: mapped when the image is on an internal fixed disk, with read-ahead on USB hard
+    // disks, removable and network media, plain file reads if neither works
+    CMyComPtr<IInStream> file;
+    if (MappedInStream::isInternalFixedDisk(isoPath)) {
+        file = MappedInStream::open(isoPath);
+    } else {
+        file = PrefetchInStream::open(isoPath, PrefetchInStream::kDefaultBufferSize,
+                                      PrefetchInStream::defaultBufferCount(isoPath), &res.prefetch);
+    }
+    if (!file) {
+        CInFileStream *fileSpec = new CInFileStream();
+        file                    = fileSpec;
+        if (!fileSpec->Open(isoPath.c_str())) {
+            return res;
+        }
     }
+    file           = HashingInStream::wrap(file, contentHasher, &res.tee);
+    res.baseStream = file;
 
     auto tryOpenWithClsid = [&](const GUID &clsid, CMyComPtr<IInArchive> &outArc, CMyComPtr<IInStream> &in) -> HRESULT {
         outArc.Release();
@@ -360,82 +811,335 @@ OpenResult OpenIsoArchive(const std::wstring &isoPath) {
 
     return res;
 }
-} // namespace
 
-ISOReader::ISOReader() {}
-
-ISOReader::~ISOReader() {}
-
-std::vector<std::string> ISOReader::listFiles(const std::string &isoPath) {
-    std::vector<std::string> files;
-    const std::wstring       wIso   = Utf8ToWide(isoPath);
-    auto                     opened = OpenIsoArchive(wIso);
-    if (!opened.ok) {
-        return files;
-    }
+void CreateDirs(const std::string &path) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(path), ec);
+}
 
+// Reads every item's path, size and directory flag once and interns them into the catalog
+void BuildCatalog(IInArchive *archive, ISOCatalog &catalog) {
+    catalog.clear();
     UInt32 numItems = 0;
-    if (opened.archive->GetNumberOfItems(&numItems) != S_OK) {
-        return files;
-    }
-    files.reserve(numItems);
+    if (archive->GetNumberOfItems(&numItems) != S_OK)
+        return;
+    catalog.reserve(numItems);
 
     for (UInt32 i = 0; i < numItems; ++i) {
         NWindows::NCOM::CPropVariant prop;
-        if (opened.archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
-            std::wstring ws(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            files.emplace_back(WideToUtf8(ws));
+        std::string                  path;
+        if (archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
+            path = WideToUtf8(std::wstring(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal)));
+        }
+        NWindows::NCOM::PropVariant_Clear(&prop);
+        if (path.empty())
+            continue;
+
+        bool isDir = false;
+        if (archive->GetProperty(i, kpidIsDir, &prop) == S_OK && prop.vt == VT_BOOL) {
+            isDir = (prop.boolVal != VARIANT_FALSE);
+        }
+        NWindows::NCOM::PropVariant_Clear(&prop);
+
+        UInt64 size = 0;
+        if (archive->GetProperty(i, kpidSize, &prop) == S_OK && prop.vt == VT_UI8) {
+            size = prop.uhVal.QuadPart;
         }
         NWindows::NCOM::PropVariant_Clear(&prop);
+
+        UInt64 offset = ISOCatalog::kNoOffset;
+        if (archive->GetProperty(i, kpidOffset, &prop) == S_OK && prop.vt == VT_UI8) {
+            offset = prop.uhVal.QuadPart;
+        }
+        NWindows::NCOM::PropVariant_Clear(&prop);
+
+        catalog.add(path, size, isDir, i, offset);
     }
-    opened.archive->Close();
-    return files;
 }
 
-bool ISOReader::fileExists(const std::string &isoPath, const std::string &filePath) {
-    auto        files  = listFiles(isoPath);
-    std::string target = filePath;
-    NormalizeSlashes(target);
-    target = Utils::toLower(target);
-    for (auto file : files) {
-        NormalizeSlashes(file);
-        if (Utils::toLower(file) == target)
-            return true;
+// Orders archive items by the position of their first extent in the image so an extraction pass reads
+// the source front to back. Items without a known offset (directories, Ext-only layouts) go last, in
+// archive order.
+constexpr UInt64 kSectorSize = 2048; // ISO9660/UDF logical sector, the unit of an LBA
+
+void SortByPhysicalOffset(const ISOCatalog &catalog, std::vector<UInt32> &indices) {
+    auto offsetOf = [&catalog](UInt32 archiveIndex) {
+        const uint32_t entry = catalog.byArchiveIndex(archiveIndex);
+        return entry == ISOCatalog::kNone ? ISOCatalog::kNoOffset : catalog.entry(entry).offset;
+    };
+    std::sort(indices.begin(), indices.end(), [&](UInt32 a, UInt32 b) {
+        const uint64_t offsetA = offsetOf(a);
+        const uint64_t offsetB = offsetOf(b);
+        return offsetA != offsetB ? offsetA < offsetB : a < b;
+    });
+}
+
+// Catalog entries that survive excludePatterns. Patterns use Utils::matchesPattern syntax and are
+// matched case-insensitively against the item's full path with '/' separators (e.g.
+// "sources/install.wim", "*.esd"); a matching directory excludes everything below it.
+std::vector<uint32_t> FilterExcluded(const ISOCatalog &catalog, const std::vector<std::string> &excludePatterns) {
+    std::vector<uint32_t> entries = catalog.entriesUnder("");
+    if (excludePatterns.empty())
+        return entries;
+
+    auto matchKey = [](std::string path) {
+        NormalizeSlashes(path);
+        return ISOCatalog::foldCase(path);
+    };
+    PatternMatcher matcher;
+    for (const auto &pattern : excludePatterns) {
+        matcher.add(matchKey(pattern));
     }
-    return false;
+
+    // 0 = not evaluated yet, 1 = kept, 2 = excluded; a parent is resolved before its children
+    std::vector<uint8_t>          state(catalog.size(), 0);
+    std::function<bool(uint32_t)> excluded = [&](uint32_t index) -> bool {
+        if (state[index] == 0) {
+            const uint32_t parent = catalog.entry(index).parent;
+            const bool     hit    = (parent != ISOCatalog::kNone && excluded(parent)) ||
+                               matcher.matches(matchKey(catalog.fullPath(index)));
+            state[index]          = hit ? 2 : 1;
+        }
+        return state[index] == 2;
+    };
+    entries.erase(std::remove_if(entries.begin(), entries.end(), excluded), entries.end());
+    return entries;
 }
 
-bool ISOReader::extractFile(const std::string &isoPath, const std::string &filePathInISO, const std::string &destPath,
-                            std::function<void(unsigned long long, unsigned long long)> progressCallback) {
-    const std::wstring wIso   = Utf8ToWide(isoPath);
-    auto               opened = OpenIsoArchive(wIso);
-    if (!opened.ok)
-        return false;
+// Parallel extraction splits the file list into units of roughly this many bytes or files, whichever
+// comes first, and hands them to workers from a shared queue so one huge file does not stall the rest.
+// Units follow the physical layout: a unit is a run of neighbouring files and is cut where the next file
+// starts further than kUnitMaxGap past the end of the previous one, so each worker streams one region.
+constexpr UInt64   kUnitMaxBytes         = 64ULL << 20;
+constexpr UInt64   kUnitMaxGap           = 1ULL << 20;
+constexpr size_t   kUnitMaxFiles         = 256;
+constexpr size_t   kParallelMinFiles     = 64;
+constexpr unsigned kMaxExtractionThreads = 8;
 
-    // Find index of the file
-    UInt32 numItems = 0;
-    if (opened.archive->GetNumberOfItems(&numItems) != S_OK)
-        return false;
-    std::wstring target = Utf8ToWide(filePathInISO);
-    NormalizeSlashes(target);
-    std::transform(target.begin(), target.end(), target.begin(), ::towlower);
-    Int32 found = -1;
-    for (UInt32 i = 0; i < numItems; ++i) {
-        NWindows::NCOM::CPropVariant prop;
-        if (opened.archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
-            std::wstring ws(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            NormalizeSlashes(ws);
-            std::transform(ws.begin(), ws.end(), ws.begin(), ::towlower);
-            if (ws == target) {
-                found = (Int32)i;
-                NWindows::NCOM::PropVariant_Clear(&prop);
+struct ExtractUnit {
+    std::vector<UInt32> indices;
+    UInt64              bytes = 0;
+};
+
+std::vector<ExtractUnit> PlanExtractUnits(const ISOCatalog &catalog, const std::vector<uint32_t> &entries) {
+    std::vector<UInt32> files;
+    files.reserve(entries.size());
+    for (uint32_t entry : entries) {
+        const ISOCatalog::Entry &e = catalog.entry(entry);
+        if (!e.isDir && e.archiveIndex != ISOCatalog::kNone)
+            files.push_back(e.archiveIndex);
+    }
+    SortByPhysicalOffset(catalog, files);
+
+    std::vector<ExtractUnit> units;
+    ExtractUnit              current;
+    uint64_t                 runEnd = ISOCatalog::kNoOffset;
+    for (UInt32 index : files) {
+        const ISOCatalog::Entry &e        = catalog.entry(catalog.byArchiveIndex(index));
+        const bool               detached = e.offset == ISOCatalog::kNoOffset || runEnd == ISOCatalog::kNoOffset ||
+                              e.offset < runEnd || e.offset - runEnd > kUnitMaxGap;
+        if (!current.indices.empty() && detached) {
+            units.push_back(std::move(current));
+            current = ExtractUnit();
+        }
+        current.indices.push_back(index);
+        current.bytes += e.size;
+        runEnd = e.offset == ISOCatalog::kNoOffset ? ISOCatalog::kNoOffset : e.offset + e.size;
+        if (current.bytes >= kUnitMaxBytes || current.indices.size() >= kUnitMaxFiles) {
+            units.push_back(std::move(current));
+            current = ExtractUnit();
+        }
+    }
+    if (!current.indices.empty())
+        units.push_back(std::move(current));
+    return units;
+}
+
+// Incremental pass against the manifest of an earlier extraction into destDir. A file is left in place
+// when the target still holds exactly what was extracted (same size and write time as recorded) and the
+// item in the new image hashes the same; such entries are dropped from entries and carried over into
+// next. Only items whose size matches are hashed (in physical order), the rest are known to differ.
+size_t SelectChanged(IInArchive *archive, const ISOCatalog &catalog, const std::string &destDir,
+                     const ExtractionManifest &previous, ExtractionManifest &next, std::vector<uint32_t> &entries,
+                     unsigned long long &bytesSkipped) {
+    const std::filesystem::path base = std::filesystem::u8path(destDir);
+    std::vector<UInt32>         candidates;
+    for (uint32_t entry : entries) {
+        const ISOCatalog::Entry &e = catalog.entry(entry);
+        if (e.isDir || e.archiveIndex == ISOCatalog::kNone)
+            continue;
+        const std::string                fullPath = catalog.fullPath(entry);
+        const ExtractionManifest::Entry *known    = previous.find(fullPath);
+        if (!known || known->size != e.size || known->writeTime == 0)
+            continue;
+        uint64_t onDisk = 0;
+        if (ExtractionManifest::fileWriteTime((base / Utf8ToWide(fullPath)).wstring(), &onDisk) != known->writeTime ||
+            onDisk != e.size)
+            continue;
+        candidates.push_back(e.archiveIndex);
+    }
+    SortByPhysicalOffset(catalog, candidates);
+
+    std::vector<bool> unchanged(catalog.size(), false);
+    size_t            count = 0;
+    for (UInt32 index : candidates) {
+        const uint32_t           entry = catalog.byArchiveIndex(index);
+        const ISOCatalog::Entry &e     = catalog.entry(entry);
+        const std::string        path  = catalog.fullPath(entry);
+        UInt64                   hash  = 0;
+        if (HashEntry(archive, index, e.size, hash) && hash == previous.find(path)->hash) {
+            next.add(path, e.size, hash);
+            unchanged[entry] = true;
+            bytesSkipped += e.size;
+            ++count;
+        }
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](uint32_t entry) { return unchanged[entry]; }),
+                  entries.end());
+    return count;
+}
+
+// Deletes the files an earlier extraction wrote that the new image no longer has, along with the
+// directories this leaves empty. Returns the number of files removed.
+size_t RemoveDeleted(const ISOCatalog &catalog, const std::string &destDir, const ExtractionManifest &previous) {
+    const std::filesystem::path base       = std::filesystem::u8path(destDir);
+    size_t                      removed    = 0;
+    size_t                      rootLength = base.native().size();
+    while (rootLength > 0 && (base.native()[rootLength - 1] == L'\\' || base.native()[rootLength - 1] == L'/'))
+        --rootLength;
+    for (const auto &known : previous.entries()) {
+        if (catalog.find(known.path) != ISOCatalog::kNone)
+            continue;
+        std::filesystem::path path = base / std::filesystem::u8path(known.path);
+        if (!DeleteFileW(path.c_str()))
+            continue;
+        ++removed;
+        // RemoveDirectoryW only succeeds on empty directories
+        for (path = path.parent_path(); path.native().size() > rootLength + 1; path = path.parent_path()) {
+            if (!RemoveDirectoryW(path.c_str()))
                 break;
+        }
+    }
+    return removed;
+}
+} // namespace
+
+// Where a pass reports what it wrote, besides the files themselves
+struct ISOSession::PassOutput {
+    ExtractionJournal     *journal = nullptr;
+    std::vector<ItemHash> *hashes  = nullptr;
+};
+
+struct ISOSession::Impl {
+    std::wstring                    isoPath;
+    OpenResult                      opened;
+    bool                            openAttempted = false;
+    ISOCatalog                      catalog;
+    bool                            catalogReady = false;
+    UInt32                          numItems     = 0;
+    ISOImageIdentity                identity;
+    bool                            haveIdentity = false;
+    ISOReadStats                    workerStats;   // read-ahead counters of finished extraction workers
+    std::shared_ptr<CoverageHasher> contentHasher; // fed by every stream opened on the image
+    std::shared_ptr<PEImageReport>  imageReport;   // PE headers of the images extracted, checked on the way
+    std::string                     journalLabel;  // see ExtractionJournal::open
+
+    // Opens the archive on first use. With a cached catalog, listing and lookups never get here, so the
+    // UDF/ISO tree is only parsed when item data is actually extracted.
+    IInArchive *archive() {
+        if (!openAttempted) {
+            openAttempted = true;
+            opened        = OpenIsoArchive(isoPath, contentHasher.get());
+            if (opened.ok) {
+                UInt32 count = 0;
+                if (opened.archive->GetNumberOfItems(&count) != S_OK)
+                    count = 0;
+                // A cached catalog must describe the same item list the handler produces
+                if (!catalogReady || count != numItems) {
+                    numItems = count;
+                    BuildCatalog(opened.archive, catalog);
+                    catalogReady = true;
+                    if (haveIdentity)
+                        ISOCatalogCache().store(identity, catalog, numItems);
+                }
             }
         }
-        NWindows::NCOM::PropVariant_Clear(&prop);
+        return opened.ok ? (IInArchive *)opened.archive : nullptr;
     }
-    if (found < 0)
+};
+
+ISOSession::ISOSession(const std::string &isoPath, std::unique_ptr<Impl> impl)
+    : path_(isoPath), impl_(std::move(impl)) {}
+
+ISOSession::~ISOSession() {
+    close();
+}
+
+std::shared_ptr<ISOSession> ISOSession::open(const std::string &isoPath) {
+    auto impl          = std::make_unique<Impl>();
+    impl->isoPath      = Utf8ToWide(isoPath);
+    impl->haveIdentity = ISOCatalogCache::identify(isoPath, impl->identity);
+    if (impl->haveIdentity && ISOCatalogCache().load(impl->identity, impl->catalog, impl->numItems)) {
+        impl->catalogReady = true;
+    } else if (!impl->archive()) {
+        return nullptr;
+    }
+    return std::shared_ptr<ISOSession>(new ISOSession(isoPath, std::move(impl)));
+}
+
+const std::string &ISOSession::path() const {
+    return path_;
+}
+
+bool ISOSession::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return impl_ != nullptr;
+}
+
+void ISOSession::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_)
+        return;
+    if (impl_->opened.archive)
+        impl_->opened.archive->Close();
+    impl_.reset();
+}
+
+std::vector<std::string> ISOSession::listFiles() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string>    files;
+    if (!impl_)
+        return files;
+    const ISOCatalog &catalog = impl_->catalog;
+
+    files.reserve(impl_->numItems);
+    for (UInt32 i = 0; i < impl_->numItems; ++i) {
+        const uint32_t entry = catalog.byArchiveIndex(i);
+        if (entry != ISOCatalog::kNone)
+            files.emplace_back(catalog.fullPath(entry));
+    }
+    return files;
+}
+
+bool ISOSession::fileExists(const std::string &filePath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_)
+        return false;
+    const uint32_t entry = impl_->catalog.find(filePath);
+    return entry != ISOCatalog::kNone && impl_->catalog.entry(entry).archiveIndex != ISOCatalog::kNone;
+}
+
+bool ISOSession::extractFile(const std::string &filePathInISO, const std::string &destPath,
+                             std::function<void(unsigned long long, unsigned long long)> progressCallback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
+        return false;
+
+    const uint32_t entry = impl_->catalog.find(filePathInISO);
+    if (entry == ISOCatalog::kNone || impl_->catalog.entry(entry).archiveIndex == ISOCatalog::kNone)
         return false;
+    const UInt32 index = impl_->catalog.entry(entry).archiveIndex;
 
     // Prepare destination directory for the target file
     std::filesystem::path destFs(destPath);
@@ -444,193 +1148,534 @@ bool ISOReader::extractFile(const std::string &isoPath, const std::string &fileP
         // If there is no parent (file in current dir), ensure at least base dir is set
         destDir = destFs.has_root_path() ? destFs.root_path().u8string() : std::string(".");
     }
-    createDirectories(destDir);
+    CreateDirs(destDir);
 
     // Extract only that item into the requested destination path
     std::unordered_map<UInt32, std::wstring> overrides;
-    overrides.emplace(static_cast<UInt32>(found), Utf8ToWide(destPath));
-    CMyComPtr<IArchiveExtractCallback> cb =
-        new ExtractCallback(opened.archive, Utf8ToWide(destDir), &overrides, progressCallback);
-    UInt32  index = (UInt32)found;
-    HRESULT hr    = opened.archive->Extract(&index, 1, 0, cb);
-    opened.archive->Close();
-    return hr == S_OK;
+    overrides.emplace(index, Utf8ToWide(destPath));
+    return RunExtract(archive, &index, 1,
+                      new ExtractCallback(archive, Utf8ToWide(destDir), &overrides, progressCallback),
+                      impl_->imageReport.get());
 }
 
-bool ISOReader::extractFiles(const std::string &isoPath, const std::vector<std::string> &filesInISO,
-                             const std::string &destDir) {
-    const std::wstring wIso   = Utf8ToWide(isoPath);
-    auto               opened = OpenIsoArchive(wIso);
-    if (!opened.ok)
+bool ISOSession::extractFiles(const std::vector<std::string> &filesInISO, const std::string &destDir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
         return false;
 
-    UInt32 numItems = 0;
-    if (opened.archive->GetNumberOfItems(&numItems) != S_OK)
-        return false;
     std::vector<UInt32> indices;
     indices.reserve(filesInISO.size());
-
-    // Build lookup set in lowercase with normalized slashes
-    std::vector<std::wstring> wanted;
-    for (const auto &s : filesInISO) {
-        std::string norm = s;
-        NormalizeSlashes(norm);
-        std::wstring ws = Utf8ToWide(Utils::toLower(norm));
-        wanted.push_back(ws);
-    }
-
-    for (UInt32 i = 0; i < numItems; ++i) {
-        NWindows::NCOM::CPropVariant prop;
-        if (opened.archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
-            std::wstring ws(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            NormalizeSlashes(ws);
-            std::wstring low;
-            low.resize(ws.size());
-            std::transform(ws.begin(), ws.end(), low.begin(), ::towlower);
-            for (const auto &w : wanted) {
-                if (low == w) {
-                    indices.push_back(i);
-                    break;
-                }
-            }
-        }
-        NWindows::NCOM::PropVariant_Clear(&prop);
+    for (const auto &file : filesInISO) {
+        const uint32_t entry = impl_->catalog.find(file);
+        if (entry != ISOCatalog::kNone && impl_->catalog.entry(entry).archiveIndex != ISOCatalog::kNone)
+            indices.push_back(impl_->catalog.entry(entry).archiveIndex);
     }
     if (indices.empty())
         return false;
 
     std::sort(indices.begin(), indices.end());
     indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    SortByPhysicalOffset(impl_->catalog, indices);
 
-    createDirectories(destDir);
-    CMyComPtr<IArchiveExtractCallback> cb = new ExtractCallback(opened.archive, Utf8ToWide(destDir));
-    HRESULT                            hr = opened.archive->Extract(indices.data(), (UInt32)indices.size(), 0, cb);
-    opened.archive->Close();
-    return hr == S_OK;
+    CreateDirs(destDir);
+    return RunExtract(archive, indices.data(), (UInt32)indices.size(),
+                      new ExtractCallback(archive, Utf8ToWide(destDir)), impl_->imageReport.get());
 }
 
-bool ISOReader::extractAll(const std::string &isoPath, const std::string &destDir,
-                           const std::vector<std::string> &excludePatterns, EventManager *eventManager) {
-    (void)excludePatterns; // TODO: add pattern filtering if needed
-    const std::wstring wIso   = Utf8ToWide(isoPath);
-    auto               opened = OpenIsoArchive(wIso);
-    if (!opened.ok)
+bool ISOSession::extractAll(const std::string &destDir, const std::vector<std::string> &excludePatterns,
+                            EventManager *eventManager) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
         return false;
 
-    createDirectories(destDir);
-    CMyComPtr<IArchiveExtractCallback> cb =
-        new ExtractCallback(opened.archive, Utf8ToWide(destDir), nullptr, nullptr, eventManager);
-    HRESULT hr = opened.archive->Extract(nullptr, (UInt32)(Int32)-1, 0, cb);
-    opened.archive->Close();
-    return hr == S_OK;
+    CreateDirs(destDir);
+    return extractEntries(FilterExcluded(impl_->catalog, excludePatterns), destDir, eventManager, nullptr);
 }
 
-bool ISOReader::extractDirectory(const std::string &isoPath, const std::string &dirPathInISO,
-                                 const std::string &destDir) {
-    const std::wstring wIso   = Utf8ToWide(isoPath);
-    auto               opened = OpenIsoArchive(wIso);
-    if (!opened.ok)
+bool ISOSession::extractDelta(const std::string &destDir, const std::string &manifestPath, bool incremental,
+                              const std::vector<std::string> &excludePatterns, EventManager *eventManager,
+                              ISODeltaStats *stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
         return false;
 
-    UInt32 numItems = 0;
-    if (opened.archive->GetNumberOfItems(&numItems) != S_OK)
+    CreateDirs(destDir);
+    std::vector<uint32_t> entries = FilterExcluded(impl_->catalog, excludePatterns);
+    ISODeltaStats         delta;
+    ExtractionManifest    previous;
+    ExtractionManifest    next;
+    const bool            havePrevious = incremental && previous.load(manifestPath);
+    if (havePrevious) {
+        delta.unchanged = SelectChanged(archive, impl_->catalog, destDir, previous, next, entries, delta.bytesSkipped);
+    }
+    for (uint32_t entry : entries) {
+        if (!impl_->catalog.entry(entry).isDir)
+            ++delta.written;
+    }
+
+    if (!extractEntries(std::move(entries), destDir, eventManager, &next))
+        return false;
+    // Removed files go only once the new content is complete, so an interrupted upgrade never leaves the
+    // target with less than either build
+    if (havePrevious)
+        delta.removed = RemoveDeleted(impl_->catalog, destDir, previous);
+    next.save(manifestPath, destDir);
+    if (stats)
+        *stats = delta;
+    return true;
+}
+
+// One extraction pass over entries, shared by extractAll and extractDelta: resumes from the target's
+// journal, runs the sequential or parallel extraction and, when manifest is given, adds every file the
+// pass put on the target to it
+bool ISOSession::extractEntries(std::vector<uint32_t> entries, const std::string &destDir,
+                                EventManager *eventManager, ExtractionManifest *manifest) {
+    IInArchive *archive = impl_->archive();
+
+    // Pick up where an interrupted pass over the same image stopped
+    ExtractionJournal journal;
+    if (impl_->haveIdentity && journal.open(destDir, impl_->identity, impl_->journalLabel)) {
+        const size_t resumed = ResumeFromJournal(archive, impl_->catalog, destDir, journal, entries, manifest);
+        if (resumed > 0 && eventManager) {
+            eventManager->notifyLogUpdate("Reanudando extracción: " + std::to_string(resumed) +
+                                          " archivos ya extraídos.\r\n");
+        }
+    }
+
+    std::vector<ItemHash> hashes;
+    PassOutput            output;
+    output.journal = journal.isOpen() ? &journal : nullptr;
+    if (manifest) {
+        hashes.resize(impl_->numItems);
+        output.hashes = &hashes;
+    }
+
+    const unsigned threads = effectiveThreads(entries.size());
+    const bool     ok      = threads > 1 ? extractParallel(entries, destDir, eventManager, threads, output)
+                                         : extractSequential(entries, destDir, eventManager, output);
+    if (!ok)
+        return false;
+
+    if (manifest) {
+        for (uint32_t entry : entries) {
+            const ISOCatalog::Entry &e = impl_->catalog.entry(entry);
+            if (!e.isDir && e.archiveIndex != ISOCatalog::kNone && hashes[e.archiveIndex].known)
+                manifest->add(impl_->catalog.fullPath(entry), hashes[e.archiveIndex].size, hashes[e.archiveIndex].hash);
+        }
+    }
+    journal.discard();
+    return true;
+}
+
+bool ISOSession::extractSequential(const std::vector<uint32_t> &entries, const std::string &destDir,
+                                   EventManager *eventManager, const PassOutput &output) {
+    IInArchive *archive = impl_->archive();
+
+    // Only the surviving items are handed to the handler, so excluded files are neither read nor part
+    // of the total it reports through SetTotal()
+    std::vector<UInt32> indices;
+    indices.reserve(entries.size());
+    for (uint32_t entry : entries) {
+        const ISOCatalog::Entry &e = impl_->catalog.entry(entry);
+        if (e.archiveIndex != ISOCatalog::kNone)
+            indices.push_back(e.archiveIndex);
+    }
+    if (indices.empty())
+        return true;
+    SortByPhysicalOffset(impl_->catalog, indices);
+
+    ExtractCallback *spec = new ExtractCallback(archive, Utf8ToWide(destDir), nullptr, nullptr, eventManager);
+    spec->setJournal(output.journal);
+    spec->setItemHashes(output.hashes);
+    return RunExtract(archive, indices.data(), (UInt32)indices.size(), spec, impl_->imageReport.get());
+}
+
+void ISOSession::setExtractionThreads(unsigned threads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    extractionThreads_ = threads;
+}
+
+void ISOSession::setContentHasher(std::shared_ptr<CoverageHasher> hasher) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_)
+        return;
+    impl_->contentHasher = std::move(hasher);
+    // An archive opened before this point (no cached catalog) is fed from here on; what it read while
+    // parsing is left for CoverageHasher::finish()
+    if (impl_->opened.tee)
+        impl_->opened.tee->setHasher(impl_->contentHasher.get());
+}
+
+void ISOSession::setImageReport(std::shared_ptr<PEImageReport> report) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (impl_)
+        impl_->imageReport = std::move(report);
+}
+
+void ISOSession::setJournalLabel(const std::string &label) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (impl_)
+        impl_->journalLabel = label;
+}
+
+unsigned ISOSession::effectiveThreads(size_t itemCount) const {
+    if (itemCount < kParallelMinFiles)
+        return 1;
+    unsigned threads = extractionThreads_;
+    if (threads == 0) {
+        threads = (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), kMaxExtractionThreads);
+    }
+    return threads;
+}
+
+// Each worker opens its own stream and handler instance (7-Zip archives are not re-entrant) and pulls
+// units from a shared counter. The calling thread aggregates byte progress for the EventManager.
+bool ISOSession::extractParallel(const std::vector<uint32_t> &entries, const std::string &destDir,
+                                 EventManager *eventManager, unsigned threads, const PassOutput &output) {
+    const ISOCatalog &catalog = impl_->catalog;
+
+    // Create the directory skeleton up front so workers never race on parent creation
+    const std::filesystem::path base       = std::filesystem::u8path(destDir);
+    UInt64                      totalBytes = 0;
+    size_t                      totalFiles = 0;
+    for (uint32_t entry : entries) {
+        const ISOCatalog::Entry &e = catalog.entry(entry);
+        std::error_code          ec;
+        if (e.isDir) {
+            std::filesystem::create_directories(base / Utf8ToWide(catalog.fullPath(entry)), ec);
+        } else {
+            totalBytes += e.size;
+            ++totalFiles;
+        }
+    }
+
+    const std::vector<ExtractUnit> units = PlanExtractUnits(catalog, entries);
+    threads                              = std::min<unsigned>(threads, static_cast<unsigned>(units.size()));
+    if (threads == 0)
+        return true;
+
+    std::atomic<size_t>              nextUnit{0};
+    std::atomic<UInt64>              finishedBytes{0};
+    std::atomic<size_t>              finishedFiles{0};
+    std::vector<std::atomic<UInt64>> inFlight(threads);
+    std::atomic<bool>                cancel{false};
+    std::atomic<bool>                failed{false};
+    std::atomic<unsigned>            running{threads};
+    std::mutex                       doneMutex;
+    std::condition_variable          doneCv;
+    const std::wstring               wBase = Utf8ToWide(destDir);
+
+    auto worker = [&](unsigned slot) {
+        OpenResult own   = OpenIsoArchive(impl_->isoPath, impl_->contentHasher.get());
+        UInt32     count = 0;
+        if (!own.ok || own.archive->GetNumberOfItems(&count) != S_OK || count != impl_->numItems) {
+            failed = true;
+            cancel = true;
+        }
+        while (!cancel.load()) {
+            const size_t unit = nextUnit.fetch_add(1);
+            if (unit >= units.size())
+                break;
+            inFlight[slot] = 0;
+            auto progress  = [&inFlight, slot](unsigned long long done, unsigned long long) { inFlight[slot] = done; };
+
+            ExtractCallback *spec = new ExtractCallback(own.archive, wBase, nullptr, progress);
+            spec->setAbortFlag(&cancel);
+            spec->setJournal(output.journal);
+            spec->setItemHashes(output.hashes);
+            const ExtractUnit &work = units[unit];
+            if (!RunExtract(own.archive, work.indices.data(), (UInt32)work.indices.size(), spec,
+                            impl_->imageReport.get())) {
+                failed = true;
+                cancel = true;
+            }
+            inFlight[slot] = 0;
+            finishedBytes += work.bytes;
+            finishedFiles += work.indices.size();
+        }
+        if (own.archive)
+            own.archive->Close();
+        {
+            std::lock_guard<std::mutex> statsLock(doneMutex);
+            AddReadStats(own, impl_->workerStats);
+        }
+        if (--running == 0) {
+            std::lock_guard<std::mutex> doneLock(doneMutex);
+            doneCv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        pool.emplace_back(worker, i);
+    }
+
+    {
+        std::unique_lock<std::mutex> doneLock(doneMutex);
+        while (running.load() > 0) {
+            doneCv.wait_for(doneLock, std::chrono::milliseconds(100));
+            if (eventManager && eventManager->isCancelRequested())
+                cancel = true;
+            if (eventManager) {
+                UInt64 done = finishedBytes.load();
+                for (const auto &bytes : inFlight)
+                    done += bytes.load();
+                eventManager->notifyDetailedProgress(static_cast<long long>(done), static_cast<long long>(totalBytes),
+                                                     "Extrayendo: " + std::to_string(finishedFiles.load()) + "/" +
+                                                         std::to_string(totalFiles) + " archivos");
+            }
+        }
+    }
+    for (auto &t : pool) {
+        t.join();
+    }
+    return !failed.load() && !cancel.load();
+}
+
+bool ISOSession::extractDirectory(const std::string &dirPathInISO, const std::string &destDir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
+        return false;
+
+    const ISOCatalog &catalog  = impl_->catalog;
+    const uint32_t    dirEntry = catalog.find(dirPathInISO);
+    if (dirEntry == ISOCatalog::kNone)
         return false;
-    std::string normDir = dirPathInISO;
-    NormalizeSlashes(normDir);
-    std::wstring dir = Utf8ToWide(Utils::toLower(normDir));
-    if (!dir.empty() && dir.back() != L'/' && dir.back() != L'\\')
-        dir.push_back(L'/');
 
     std::vector<UInt32>                      indices;
     std::unordered_map<UInt32, std::wstring> overrides;
     std::filesystem::path                    base = std::filesystem::u8path(destDir);
 
-    for (UInt32 i = 0; i < numItems; ++i) {
-        NWindows::NCOM::CPropVariant prop;
-        if (opened.archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
-            std::wstring ws(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            NormalizeSlashes(ws);
-            std::wstring low;
-            low.resize(ws.size());
-            std::transform(ws.begin(), ws.end(), low.begin(), ::towlower);
-            if (low.rfind(dir, 0) == 0) { // starts with dir
-                indices.push_back(i);
-                std::wstring rel = ws.substr(dir.size());
-                while (!rel.empty() && (rel.front() == L'/' || rel.front() == L'\\')) {
-                    rel.erase(rel.begin());
-                }
-                std::filesystem::path relPath(rel);
-                std::filesystem::path outPath = base;
-                if (!rel.empty()) {
-                    outPath /= relPath;
-                }
-                overrides.emplace(i, outPath.native());
-            }
-        }
-        NWindows::NCOM::PropVariant_Clear(&prop);
+    for (uint32_t entry : catalog.entriesUnder(dirPathInISO)) {
+        const ISOCatalog::Entry &e = catalog.entry(entry);
+        if (e.archiveIndex == ISOCatalog::kNone)
+            continue;
+        indices.push_back(e.archiveIndex);
+        std::filesystem::path outPath = base;
+        outPath /= Utf8ToWide(catalog.relativePath(entry, dirEntry));
+        overrides.emplace(e.archiveIndex, outPath.native());
     }
     if (indices.empty())
         return false;
 
     std::sort(indices.begin(), indices.end());
     indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    SortByPhysicalOffset(catalog, indices);
 
-    createDirectories(destDir);
-    CMyComPtr<IArchiveExtractCallback> cb =
-        new ExtractCallback(opened.archive, Utf8ToWide(destDir), overrides.empty() ? nullptr : &overrides);
-    HRESULT hr = opened.archive->Extract(indices.data(), (UInt32)indices.size(), 0, cb);
-    opened.archive->Close();
-    return hr == S_OK;
+    CreateDirs(destDir);
+    return RunExtract(archive, indices.data(), (UInt32)indices.size(),
+                      new ExtractCallback(archive, Utf8ToWide(destDir), overrides.empty() ? nullptr : &overrides),
+                      impl_->imageReport.get());
 }
 
-void ISOReader::createDirectories(const std::string &path) {
-    std::filesystem::path p(path);
-    std::error_code       ec;
-    std::filesystem::create_directories(p, ec);
+bool ISOSession::getFileSize(const std::string &filePathInISO, unsigned long long &sizeOut) {
+    sizeOut = 0ULL;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_)
+        return false;
+    const uint32_t entry = impl_->catalog.find(filePathInISO);
+    if (entry == ISOCatalog::kNone || impl_->catalog.entry(entry).archiveIndex == ISOCatalog::kNone)
+        return false;
+    sizeOut = impl_->catalog.entry(entry).size;
+    return true;
 }
 
-bool ISOReader::getFileSize(const std::string &isoPath, const std::string &filePathInISO, unsigned long long &sizeOut) {
-    sizeOut                   = 0ULL;
-    const std::wstring wIso   = Utf8ToWide(isoPath);
-    auto               opened = OpenIsoArchive(wIso);
-    if (!opened.ok)
+bool ISOSession::readFileToBuffer(const std::string &filePathInISO, void *buffer, size_t capacity,
+                                  size_t &bytesRead) {
+    bytesRead = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    IInArchive *archive = impl_ ? impl_->archive() : nullptr;
+    if (!archive)
         return false;
 
-    UInt32 numItems = 0;
-    if (opened.archive->GetNumberOfItems(&numItems) != S_OK)
+    const uint32_t entry = impl_->catalog.find(filePathInISO);
+    if (entry == ISOCatalog::kNone)
+        return false;
+    const ISOCatalog::Entry &e = impl_->catalog.entry(entry);
+    if (e.isDir || e.archiveIndex == ISOCatalog::kNone || e.size > capacity)
+        return false;
+    if (!ReadEntry(archive, e.archiveIndex, buffer, static_cast<size_t>(e.size)))
+        return false;
+    bytesRead = static_cast<size_t>(e.size);
+    return true;
+}
+
+bool ISOSession::readFileToBuffer(const std::string &filePathInISO, std::string &out, size_t maxSize) {
+    out.clear();
+    unsigned long long size = 0;
+    if (!getFileSize(filePathInISO, size) || size > maxSize)
+        return false;
+    out.resize(static_cast<size_t>(size));
+    size_t read = 0;
+    if (!readFileToBuffer(filePathInISO, &out[0], out.size(), read)) {
+        out.clear();
         return false;
-    std::wstring target = Utf8ToWide(filePathInISO);
-    NormalizeSlashes(target);
-    std::transform(target.begin(), target.end(), target.begin(), ::towlower);
-    Int32 found = -1;
-    for (UInt32 i = 0; i < numItems; ++i) {
-        NWindows::NCOM::CPropVariant prop;
-        if (opened.archive->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal) {
-            std::wstring ws(prop.bstrVal, prop.bstrVal + SysStringLen(prop.bstrVal));
-            NormalizeSlashes(ws);
-            std::transform(ws.begin(), ws.end(), ws.begin(), ::towlower);
-            if (ws == target) {
-                found = (Int32)i;
-                NWindows::NCOM::PropVariant_Clear(&prop);
-                break;
-            }
-        }
-        NWindows::NCOM::PropVariant_Clear(&prop);
     }
-    if (found < 0) {
-        opened.archive->Close();
+    return true;
+}
+
+std::unique_ptr<std::istream> ISOSession::openFileStream(const std::string &filePathInISO, size_t maxSize) {
+    std::string content;
+    if (!readFileToBuffer(filePathInISO, content, maxSize))
+        return nullptr;
+    return std::make_unique<std::istringstream>(content);
+}
+
+bool ISOSession::readStats(ISOReadStats &stats) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_ || !impl_->opened.prefetch)
         return false;
+    stats = impl_->workerStats;
+    AddReadStats(impl_->opened, stats);
+    return true;
+}
+
+bool ISOSession::getFileLba(const std::string &filePathInISO, unsigned long long &lbaOut) {
+    lbaOut = 0ULL;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!impl_)
+        return false;
+    const uint32_t entry = impl_->catalog.find(filePathInISO);
+    if (entry == ISOCatalog::kNone || impl_->catalog.entry(entry).offset == ISOCatalog::kNoOffset)
+        return false;
+    lbaOut = impl_->catalog.entry(entry).offset / kSectorSize;
+    return true;
+}
+
+ISOReader::ISOReader() {}
+
+ISOReader::~ISOReader() {}
+
+std::shared_ptr<ISOSession> ISOReader::openSession(const std::string &isoPath) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    if (session_ && session_->path() == isoPath && session_->isOpen())
+        return session_;
+    session_ = ISOSession::open(isoPath);
+    if (session_) {
+        session_->setExtractionThreads(extractionThreads_);
+        if (contentHasher_ && contentHasher_->path() == isoPath)
+            session_->setContentHasher(contentHasher_);
+        session_->setImageReport(imageReport_);
+        session_->setJournalLabel(journalLabel_);
     }
+    return session_;
+}
 
-    NWindows::NCOM::CPropVariant sizeProp;
-    if (opened.archive->GetProperty((UInt32)found, kpidSize, &sizeProp) == S_OK) {
-        if (sizeProp.vt == VT_UI8) {
-            sizeOut = static_cast<unsigned long long>(sizeProp.uhVal.QuadPart);
-        } else if (sizeProp.vt == VT_EMPTY) {
-            sizeOut = 0ULL;
-        }
+void ISOReader::setExtractionThreads(unsigned threads) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    extractionThreads_ = threads;
+    if (session_)
+        session_->setExtractionThreads(threads);
+}
+
+void ISOReader::setContentHasher(std::shared_ptr<CoverageHasher> hasher) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    contentHasher_ = std::move(hasher);
+    if (session_ && (!contentHasher_ || session_->path() == contentHasher_->path()))
+        session_->setContentHasher(contentHasher_);
+}
+
+void ISOReader::setImageReport(std::shared_ptr<PEImageReport> report) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    imageReport_ = std::move(report);
+    if (session_)
+        session_->setImageReport(imageReport_);
+}
+
+void ISOReader::setJournalLabel(const std::string &label) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    journalLabel_ = label;
+    if (session_)
+        session_->setJournalLabel(journalLabel_);
+}
+
+void ISOReader::closeSession() {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    if (session_) {
+        session_->close();
+        session_.reset();
     }
-    NWindows::NCOM::PropVariant_Clear(&sizeProp);
-    opened.archive->Close();
-    return (found >= 0);
+}
+
+std::vector<std::string> ISOReader::listFiles(const std::string &isoPath) {
+    auto session = openSession(isoPath);
+    return session ? session->listFiles() : std::vector<std::string>();
+}
+
+bool ISOReader::fileExists(const std::string &isoPath, const std::string &filePath) {
+    auto session = openSession(isoPath);
+    return session && session->fileExists(filePath);
+}
+
+bool ISOReader::extractFile(const std::string &isoPath, const std::string &filePathInISO, const std::string &destPath,
+                            std::function<void(unsigned long long, unsigned long long)> progressCallback) {
+    auto session = openSession(isoPath);
+    return session && session->extractFile(filePathInISO, destPath, progressCallback);
+}
+
+bool ISOReader::extractFiles(const std::string &isoPath, const std::vector<std::string> &filesInISO,
+                             const std::string &destDir) {
+    auto session = openSession(isoPath);
+    return session && session->extractFiles(filesInISO, destDir);
+}
+
+bool ISOReader::extractAll(const std::string &isoPath, const std::string &destDir,
+                           const std::vector<std::string> &excludePatterns, EventManager *eventManager) {
+    auto session = openSession(isoPath);
+    return session && session->extractAll(destDir, excludePatterns, eventManager);
+}
+
+bool ISOReader::extractDelta(const std::string &isoPath, const std::string &destDir, const std::string &manifestPath,
+                             bool incremental, const std::vector<std::string> &excludePatterns,
+                             EventManager *eventManager, ISODeltaStats *stats) {
+    auto session = openSession(isoPath);
+    return session && session->extractDelta(destDir, manifestPath, incremental, excludePatterns, eventManager, stats);
+}
+
+bool ISOReader::extractDirectory(const std::string &isoPath, const std::string &dirPathInISO,
+                                 const std::string &destDir) {
+    auto session = openSession(isoPath);
+    return session && session->extractDirectory(dirPathInISO, destDir);
+}
+
+bool ISOReader::getFileSize(const std::string &isoPath, const std::string &filePathInISO, unsigned long long &sizeOut) {
+    sizeOut      = 0ULL;
+    auto session = openSession(isoPath);
+    return session && session->getFileSize(filePathInISO, sizeOut);
+}
+
+bool ISOReader::readFileToBuffer(const std::string &isoPath, const std::string &filePathInISO, void *buffer,
+                                 size_t capacity, size_t &bytesRead) {
+    bytesRead    = 0;
+    auto session = openSession(isoPath);
+    return session && session->readFileToBuffer(filePathInISO, buffer, capacity, bytesRead);
+}
+
+bool ISOReader::readFileToBuffer(const std::string &isoPath, const std::string &filePathInISO, std::string &out,
+                                 size_t maxSize) {
+    out.clear();
+    auto session = openSession(isoPath);
+    return session && session->readFileToBuffer(filePathInISO, out, maxSize);
+}
+
+std::unique_ptr<std::istream> ISOReader::openFileStream(const std::string &isoPath, const std::string &filePathInISO,
+                                                        size_t maxSize) {
+    auto session = openSession(isoPath);
+    return session ? session->openFileStream(filePathInISO, maxSize) : nullptr;
+}
+
+bool ISOReader::readStats(const std::string &isoPath, ISOReadStats &stats) {
+    std::lock_guard<std::mutex> lock(sessionMutex_);
+    return session_ && session_->path() == isoPath && session_->readStats(stats);
+}
+
+bool ISOReader::getFileLba(const std::string &isoPath, const std::string &filePathInISO, unsigned long long &lbaOut) {
+    lbaOut       = 0ULL;
+    auto session = openSession(isoPath);
+    return session && session->getFileLba(filePathInISO, lbaOut);
 }
@@ -1,17 +1,144 @@
 #ifndef ISOREADER_H
 #define ISOREADER_H
 
+#include <cstdint>
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <mutex>
 
+class CoverageHasher;
 class EventManager;
+class ExtractionManifest;
+class PEImageReport;
+
+// Read-ahead counters for images opened through the prefetching stream (removable and network media)
+struct ISOReadStats {
+    unsigned long long hits            = 0;
+    unsigned long long misses          = 0;
+    unsigned long long bytesPrefetched = 0;
+    unsigned long long bytesDiscarded  = 0;
+};
+
+// Outcome of an extractDelta pass
+struct ISODeltaStats {
+    size_t             unchanged    = 0; // files left in place
+    size_t             written      = 0; // files added or rewritten
+    size_t             removed      = 0; // files deleted because the image no longer has them
+    unsigned long long bytesSkipped = 0;
+};
+
+// An opened ISO image. The underlying archive handler and input stream stay alive until close() (or
+// destruction), so repeated queries and extractions against the same image do not re-parse the
+// UDF/ISO directory tree. All methods are serialized internally; the archive itself is not re-entrant.
+class ISOSession {
+public:
+    // Largest entry the in-memory readers decode unless the caller asks for more
+    static constexpr size_t kMaxBufferedFile = 16u << 20;
+
+    ~ISOSession();
+    ISOSession(const ISOSession &)            = delete;
+    ISOSession &operator=(const ISOSession &) = delete;
+
+    // Opens isoPath; returns nullptr if no suitable handler (Udf/Iso/Ext) accepts the image
+    static std::shared_ptr<ISOSession> open(const std::string &isoPath);
+
+    const std::string &path() const;
+    bool               isOpen() const;
+    void               close();
+
+    std::vector<std::string> listFiles();
+    bool                     fileExists(const std::string &filePath);
+    bool extractFile(const std::string &filePathInISO, const std::string &destPath,
+                     std::function<void(unsigned long long, unsigned long long)> progressCallback = nullptr);
+    bool extractFiles(const std::vector<std::string> &filesInISO, const std::string &destDir);
+    // Resumable: progress is journaled in destDir\ISOJOURNAL (see ExtractionJournal), so a rerun against
+    // the same image skips the files an interrupted pass already wrote
+    bool extractAll(const std::string &destDir, const std::vector<std::string> &excludePatterns = {},
+                    EventManager *eventManager = nullptr);
+
+    // extractAll that also writes a manifest of the extracted files to manifestPath (see
+    // ExtractionManifest). With incremental set and a manifest of an earlier extraction into destDir in
+    // place, only new or changed files are written and files the image no longer has are deleted.
+    bool extractDelta(const std::string &destDir, const std::string &manifestPath, bool incremental,
+                      const std::vector<std::string> &excludePatterns = {}, EventManager *eventManager = nullptr,
+                      ISODeltaStats *stats = nullptr);
+    bool extractDirectory(const std::string &dirPathInISO, const std::string &destDir);
+    bool getFileSize(const std::string &filePathInISO, unsigned long long &sizeOut);
+
+    // Starting LBA (2048-byte sectors) of the item's first extent; false for directories or when the
+    // handler does not report a location
+    bool getFileLba(const std::string &filePathInISO, unsigned long long &lbaOut);
+
+    // Decode an entry straight into memory, without a temporary file. The first overload fills a caller
+    // buffer and fails if the entry does not fit; the others refuse entries larger than maxSize.
+    bool readFileToBuffer(const std::string &filePathInISO, void *buffer, size_t capacity, size_t &bytesRead);
+    bool readFileToBuffer(const std::string &filePathInISO, std::string &out, size_t maxSize = kMaxBufferedFile);
+    std::unique_ptr<std::istream> openFileStream(const std::string &filePathInISO, size_t maxSize = kMaxBufferedFile);
+
+    // Read-ahead counters accumulated so far (including extraction workers); false if the image is not
+    // read through the prefetching stream
+    bool readStats(ISOReadStats &stats) const;
+
+    // Worker threads used by extractAll: 0 = one per core (capped), 1 = single Extract call
+    void setExtractionThreads(unsigned threads);
+
+    // Every byte read from the image from now on, by this session and its extraction workers, is also
+    // handed to hasher (see CoverageHasher); nullptr detaches it
+    void setContentHasher(std::shared_ptr<CoverageHasher> hasher);
+
+    // Every .efi/.exe/.dll extracted from now on gets its PE headers checked from the data being written
+    // and recorded in report under its destination path (see PEHeaderValidator); nullptr detaches it
+    void setImageReport(std::shared_ptr<PEImageReport> report);
+
+    // Label of the extraction journal of the passes from now on (see ExtractionJournal::open): an
+    // interrupted pass is only resumed by one with the same label
+    void setJournalLabel(const std::string &label);
+
+private:
+    struct Impl;
+    struct PassOutput;
+    ISOSession(const std::string &isoPath, std::unique_ptr<Impl> impl);
+
+    unsigned effectiveThreads(size_t itemCount) const;
+    bool     extractEntries(std::vector<uint32_t> entries, const std::string &destDir, EventManager *eventManager,
+                            ExtractionManifest *manifest);
+    bool     extractSequential(const std::vector<uint32_t> &entries, const std::string &destDir,
+                               EventManager *eventManager, const PassOutput &output);
+    bool     extractParallel(const std::vector<uint32_t> &entries, const std::string &destDir,
+                             EventManager *eventManager, unsigned threads, const PassOutput &output);
+
+    std::string           path_;
+    std::unique_ptr<Impl> impl_;
+    unsigned              extractionThreads_ = 0;
+    mutable std::mutex    mutex_;
+};
 
 class ISOReader {
 public:
     ISOReader();
     ~ISOReader();
 
+    // Returns the session for isoPath, reusing the cached one when the path matches
+    std::shared_ptr<ISOSession> openSession(const std::string &isoPath);
+
+    // Releases the cached session (and the file handle on the ISO)
+    void closeSession();
+
+    // Forwarded to every session this reader opens (see ISOSession::setExtractionThreads)
+    void setExtractionThreads(unsigned threads);
+
+    // Attached to the session of hasher->path(), now or when it is opened (see ISOSession::setContentHasher)
+    void setContentHasher(std::shared_ptr<CoverageHasher> hasher);
+
+    // Forwarded to the cached session and every one opened later (see ISOSession::setImageReport)
+    void setImageReport(std::shared_ptr<PEImageReport> report);
+
+    // Forwarded to the cached session and every one opened later (see ISOSession::setJournalLabel)
+    void setJournalLabel(const std::string &label);
+
     // List all files in the ISO
     std::vector<std::string> listFiles(const std::string &isoPath);
 
@@ -31,15 +158,38 @@ public:
     bool extractAll(const std::string &isoPath, const std::string &destDir,
                     const std::vector<std::string> &excludePatterns = {}, EventManager *eventManager = nullptr);
 
+    // Extract all files and maintain a manifest, incrementally if requested (see ISOSession::extractDelta)
+    bool extractDelta(const std::string &isoPath, const std::string &destDir, const std::string &manifestPath,
+                      bool incremental, const std::vector<std::string> &excludePatterns = {},
+                      EventManager *eventManager = nullptr, ISODeltaStats *stats = nullptr);
+
     // Extract a directory from ISO to destination
     bool extractDirectory(const std::string &isoPath, const std::string &dirPathInISO, const std::string &destDir);
 
     // Get file size (bytes) for a specific entry inside the ISO
     bool getFileSize(const std::string &isoPath, const std::string &filePathInISO, unsigned long long &sizeOut);
 
+    // Read a (small) file from the ISO into memory (see ISOSession::readFileToBuffer)
+    bool readFileToBuffer(const std::string &isoPath, const std::string &filePathInISO, void *buffer, size_t capacity,
+                          size_t &bytesRead);
+    bool readFileToBuffer(const std::string &isoPath, const std::string &filePathInISO, std::string &out,
+                          size_t maxSize = ISOSession::kMaxBufferedFile);
+    std::unique_ptr<std::istream> openFileStream(const std::string &isoPath, const std::string &filePathInISO,
+                                                 size_t maxSize = ISOSession::kMaxBufferedFile);
+
+    // Read-ahead counters of the cached session for isoPath (see ISOSession::readStats)
+    bool readStats(const std::string &isoPath, ISOReadStats &stats);
+
+    // Get the starting LBA of a file inside the ISO (see ISOSession::getFileLba)
+    bool getFileLba(const std::string &isoPath, const std::string &filePathInISO, unsigned long long &lbaOut);
+
 private:
-    // Helper to create directories
-    void createDirectories(const std::string &path);
+    std::mutex                      sessionMutex_;
+    std::shared_ptr<ISOSession>     session_;
+    unsigned                        extractionThreads_ = 0;
+    std::shared_ptr<CoverageHasher> contentHasher_;
+    std::shared_ptr<PEImageReport>  imageReport_;
+    std::string                     journalLabel_;
 };
 
-#endif // ISOREADER_H
\ No newline at end of file
+#endif // ISOREADER_H
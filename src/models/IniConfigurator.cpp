@@ -12,7 +12,11 @@ bool IniConfigurator::configureIniFile(const std::string &filePath, const std::s
 
 bool IniConfigurator::processIniFile(const std::string &inputPath, const std::string &outputPath,
                                      const std::string &driveLetter) {
-    std::string content = readIniContent(inputPath);
+    return processIniContent(readIniContent(inputPath), outputPath, driveLetter);
+}
+
+bool IniConfigurator::processIniContent(const std::string &content, const std::string &outputPath,
+                                        const std::string &driveLetter) {
     if (content.empty()) {
         return false;
     }
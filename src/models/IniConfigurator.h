@@ -15,6 +15,9 @@ public:
     // Process a single .ini file from input to output
     bool processIniFile(const std::string &inputPath, const std::string &outputPath, const std::string &driveLetter);
 
+    // Same as processIniFile, for content already in memory (e.g. read straight from the ISO)
+    bool processIniContent(const std::string &content, const std::string &outputPath, const std::string &driveLetter);
+
     // Configure all .ini files in a directory
     void configureIniFilesInDirectory(const std::string &dirPath, std::ofstream &logFile, const char *timestampFunc(),
                                       const std::string &driveLetter);
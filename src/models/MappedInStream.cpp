@@ -0,0 +1,196 @@
+#include "MappedInStream.h"
+
+#include <cstddef>
+#include <cstring>
+#include <winioctl.h>
+
+namespace {
+#if defined(_WIN64)
+constexpr UInt64 kWindowSize = 0; // map the whole image
+#else
+constexpr UInt64 kWindowSize = 64ULL << 20; // keep address space use bounded on 32-bit builds
+#endif
+
+// Copies out of the view; an I/O error behind a mapped page surfaces as an SEH exception, not a return
+// code, so it is turned into a failed read here
+bool CopyFromView(void *dest, const Byte *src, size_t size) {
+#ifdef _MSC_VER
+    __try {
+        std::memcpy(dest, src, size);
+    } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+                                                               : EXCEPTION_CONTINUE_SEARCH) {
+        return false;
+    }
+#else
+    std::memcpy(dest, src, size);
+#endif
+    return true;
+}
+
+// Bus the disk behind volume (a volume root such as "E:\\") is attached to; BusTypeUnknown if it cannot be
+// queried
+STORAGE_BUS_TYPE VolumeBusType(const wchar_t *volume) {
+    wchar_t name[MAX_PATH] = {};
+    if (!GetVolumeNameForVolumeMountPointW(volume, name, MAX_PATH))
+        return BusTypeUnknown;
+    // "\\?\Volume{GUID}\" names the root directory; without the backslash it is the volume device
+    std::wstring device(name);
+    if (!device.empty() && device.back() == L'\\')
+        device.pop_back();
+    HANDLE handle = CreateFileW(device.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return BusTypeUnknown;
+
+    STORAGE_PROPERTY_QUERY    query{};
+    STORAGE_DEVICE_DESCRIPTOR descriptor{};
+    DWORD                     returned = 0;
+    query.PropertyId                   = StorageDeviceProperty;
+    query.QueryType                    = PropertyStandardQuery;
+    const BOOL ok = DeviceIoControl(handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), &descriptor,
+                                    sizeof(descriptor), &returned, nullptr);
+    CloseHandle(handle);
+    if (!ok || returned < offsetof(STORAGE_DEVICE_DESCRIPTOR, BusType) + sizeof(descriptor.BusType))
+        return BusTypeUnknown;
+    return descriptor.BusType;
+}
+} // namespace
+
+CMyComPtr<IInStream> MappedInStream::open(const std::wstring &path) {
+    CMyComPtr<IInStream> stream;
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return stream;
+
+    LARGE_INTEGER size{};
+    HANDLE        mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file); // the mapping keeps the file open
+    if (!mapping)
+        return stream;
+
+    MappedInStream *spec = new MappedInStream(mapping, static_cast<UInt64>(size.QuadPart));
+    stream.Attach(spec);
+    if (!spec->mapWindow(0))
+        stream.Release();
+    return stream;
+}
+
+bool MappedInStream::isInternalFixedDisk(const std::wstring &path) {
+    wchar_t volume[MAX_PATH] = {};
+    if (!GetVolumePathNameW(path.c_str(), volume, MAX_PATH))
+        return false;
+    if (GetDriveTypeW(volume) != DRIVE_FIXED)
+        return false;
+    // USB and FireWire hard disks and SD cards report DRIVE_FIXED too, and they are the slow media read-ahead
+    // is for. A bus that cannot be queried counts as internal.
+    switch (VolumeBusType(volume)) {
+    case BusTypeUsb:
+    case BusType1394:
+    case BusTypeSd:
+        return false;
+    default:
+        return true;
+    }
+}
+
+MappedInStream::MappedInStream(HANDLE mapping, UInt64 size) : _ref(1), _mapping(mapping), _size(size) {}
+
+MappedInStream::~MappedInStream() {
+    if (_view)
+        UnmapViewOfFile(_view);
+    CloseHandle(_mapping);
+}
+
+STDMETHODIMP MappedInStream::QueryInterface(REFIID riid, void **ppvObject) {
+    if (!ppvObject)
+        return E_POINTER;
+    *ppvObject = nullptr;
+    if (riid == IID_IUnknown || riid == IID_ISequentialInStream || riid == IID_IInStream) {
+        *ppvObject = static_cast<IInStream *>(this);
+        AddRef();
+        return S_OK;
+    }
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) MappedInStream::AddRef() {
+    return (ULONG)InterlockedIncrement(&_ref);
+}
+
+STDMETHODIMP_(ULONG) MappedInStream::Release() {
+    ULONG r = (ULONG)InterlockedDecrement(&_ref);
+    if (r == 0)
+        delete this;
+    return r;
+}
+
+STDMETHODIMP MappedInStream::Read(void *data, UInt32 size, UInt32 *processedSize) {
+    if (processedSize)
+        *processedSize = 0;
+    UInt32 done = 0;
+    while (done < size && _pos < _size) {
+        if (_pos < _viewOffset || _pos >= _viewOffset + _viewSize) {
+            if (!mapWindow(_pos))
+                return E_FAIL;
+        }
+        UInt64 available = _viewOffset + _viewSize - _pos;
+        UInt32 chunk     = (UInt32)(available < (UInt64)(size - done) ? available : (UInt64)(size - done));
+        if (!CopyFromView(static_cast<Byte *>(data) + done, _view + (_pos - _viewOffset), chunk))
+            return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        done += chunk;
+        _pos += chunk;
+        if (processedSize)
+            *processedSize = done;
+    }
+    return S_OK;
+}
+
+STDMETHODIMP MappedInStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) {
+    Int64 base = 0;
+    switch (seekOrigin) {
+    case STREAM_SEEK_SET:
+        base = 0;
+        break;
+    case STREAM_SEEK_CUR:
+        base = (Int64)_pos;
+        break;
+    case STREAM_SEEK_END:
+        base = (Int64)_size;
+        break;
+    default:
+        return STG_E_INVALIDFUNCTION;
+    }
+    if (offset < -base)
+        return HRESULT_WIN32_ERROR_NEGATIVE_SEEK;
+    _pos = (UInt64)(base + offset);
+    if (newPosition)
+        *newPosition = _pos;
+    return S_OK;
+}
+
+bool MappedInStream::mapWindow(UInt64 offset) {
+    if (_view) {
+        UnmapViewOfFile(_view);
+        _view     = nullptr;
+        _viewSize = 0;
+    }
+    UInt64 start = 0;
+    UInt64 size  = _size;
+    if (kWindowSize != 0) {
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        start = offset - offset % info.dwAllocationGranularity;
+        size  = _size - start < kWindowSize ? _size - start : kWindowSize;
+    }
+    _view = static_cast<const Byte *>(
+        MapViewOfFile(_mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, (SIZE_T)size));
+    if (!_view)
+        return false;
+    _viewOffset = start;
+    _viewSize   = size;
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPEDINSTREAM_H
+#define MAPPEDINSTREAM_H
+
+#include <string>
+#include <windows.h>
+
+#include "7zip/IStream.h"
+#include "Common/MyCom.h"
+
+// Read-only IInStream over a file mapping of the ISO. Reads are a memcpy out of the mapped view instead
+// of a ReadFile call, which matters for the many small reads the UDF/ISO parsers issue while building
+// the directory tree. 64-bit builds map the whole image once; 32-bit builds keep a sliding window that
+// is remapped when a read falls outside it. All sessions mapping the same image share the cache pages.
+class MappedInStream : public IInStream {
+public:
+    // Maps path; returns an empty pointer if the file cannot be opened or mapped
+    static CMyComPtr<IInStream> open(const std::wstring &path);
+
+    // True if path lives on an internal fixed disk, where mapping is preferable to buffered reads. Fixed
+    // disks on USB, FireWire or SD count as slow media.
+    static bool isInternalFixedDisk(const std::wstring &path);
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize) override;
+    STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) override;
+
+private:
+    MappedInStream(HANDLE mapping, UInt64 size);
+    ~MappedInStream();
+
+    bool mapWindow(UInt64 offset);
+
+    LONG        _ref;
+    HANDLE      _mapping;
+    UInt64      _size;
+    UInt64      _pos        = 0;
+    const Byte *_view       = nullptr;
+    UInt64      _viewOffset = 0;
+    UInt64      _viewSize   = 0;
+};
+
+#endif // MAPPEDINSTREAM_H
@@ -0,0 +1,130 @@
+#include "PEHeaderValidator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t kLfanewOffset = 0x3C;
+constexpr size_t kPEHeaderSize = 6; // "PE\0\0" and Machine
+
+// Lowercase, backslash-separated: how Windows compares the paths the report is keyed by
+std::string ReportKey(const std::string &path) {
+    std::string key = path;
+    for (char &c : key) {
+        if (c == '/')
+            c = '\\';
+        else if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    return key;
+}
+
+uint32_t ReadLE32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+template <typename String> bool HasImageExtension(const String &path) {
+    const size_t dot = path.find_last_of('.');
+    if (dot == String::npos || path.size() - dot != 4)
+        return false;
+    char ext[3];
+    for (size_t i = 0; i < 3; ++i) {
+        const auto c = path[dot + 1 + i];
+        if (c > 0x7F)
+            return false;
+        ext[i] = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    return std::memcmp(ext, "efi", 3) == 0 || std::memcmp(ext, "exe", 3) == 0 || std::memcmp(ext, "dll", 3) == 0;
+}
+} // namespace
+
+bool PEHeaderValidator::isImageName(const std::string &path) {
+    return HasImageExtension(path);
+}
+
+bool PEHeaderValidator::isImageName(const std::wstring &path) {
+    return HasImageExtension(path);
+}
+
+void PEHeaderValidator::reset() {
+    offset_   = 0;
+    peFilled_ = 0;
+    peOffset_ = 0;
+    done_     = false;
+    info_     = PEImageInfo();
+}
+
+void PEHeaderValidator::update(const void *data, size_t size) {
+    const auto    *bytes = static_cast<const uint8_t *>(data);
+    const uint64_t begin = offset_;
+    offset_ += size;
+    if (done_ || size == 0)
+        return;
+
+    if (begin < kDosHeaderSize) {
+        const size_t n = (std::min)(size, static_cast<size_t>(kDosHeaderSize - begin));
+        std::memcpy(dos_ + begin, bytes, n);
+        if (begin + n < kDosHeaderSize)
+            return;
+        if (dos_[0] != 'M' || dos_[1] != 'Z') {
+            done_ = true;
+            return;
+        }
+        info_.dosHeader = true;
+        peOffset_       = ReadLE32(dos_ + kLfanewOffset);
+        // Tiny images may put the PE header inside the DOS header
+        if (peOffset_ < kDosHeaderSize) {
+            peFilled_ = static_cast<size_t>((std::min<uint64_t>)(kPEHeaderSize, kDosHeaderSize - peOffset_));
+            std::memcpy(pe_, dos_ + peOffset_, peFilled_);
+        }
+    }
+
+    const uint64_t want = peOffset_ + peFilled_;
+    if (peFilled_ < kPEHeaderSize && want >= begin && want < offset_) {
+        const size_t n = static_cast<size_t>((std::min<uint64_t>)(kPEHeaderSize - peFilled_, offset_ - want));
+        std::memcpy(pe_ + peFilled_, bytes + (want - begin), n);
+        peFilled_ += n;
+    }
+    if (peFilled_ == kPEHeaderSize)
+        parsePEHeader();
+}
+
+void PEHeaderValidator::parsePEHeader() {
+    done_          = true;
+    info_.peHeader = pe_[0] == 'P' && pe_[1] == 'E' && pe_[2] == 0 && pe_[3] == 0;
+    if (info_.peHeader)
+        info_.machine = static_cast<uint16_t>(pe_[4] | pe_[5] << 8);
+}
+
+bool PEHeaderValidator::complete() const {
+    return done_;
+}
+
+const PEImageInfo &PEHeaderValidator::info() const {
+    return info_;
+}
+
+void PEImageReport::record(const std::string &path, const PEImageInfo &info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    images_[ReportKey(path)] = info;
+}
+
+bool PEImageReport::find(const std::string &path, PEImageInfo &info) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        it = images_.find(ReportKey(path));
+    if (it == images_.end())
+        return false;
+    info = it->second;
+    return true;
+}
+
+size_t PEImageReport::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return images_.size();
+}
+
+void PEImageReport::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    images_.clear();
+}
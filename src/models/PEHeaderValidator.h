@@ -0,0 +1,63 @@
+#ifndef PEHEADERVALIDATOR_H
+#define PEHEADERVALIDATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// What the headers of a PE image say, as far as they were seen
+struct PEImageInfo {
+    bool     dosHeader = false; // starts with "MZ"; all a copy requires of .efi/.exe/.dll files
+    bool     peHeader  = false; // e_lfanew points at "PE\0\0"
+    uint16_t machine   = 0;     // COFF Machine (IMAGE_FILE_MACHINE_*), 0 unless peHeader
+};
+
+// Checks a PE image from its bytes as they stream past, in order, while the file is copied or extracted:
+// the DOS header magic, e_lfanew, the PE signature and the Machine field. Only the bytes up to
+// e_lfanew + 6 are looked at and only the 64-byte DOS header is kept, so it costs no I/O of its own.
+class PEHeaderValidator {
+public:
+    static constexpr size_t kDosHeaderSize = 64;
+
+    // True for the names that are checked: .efi, .exe and .dll (any case)
+    static bool isImageName(const std::string &path);
+    static bool isImageName(const std::wstring &path);
+
+    void reset();
+    void update(const void *data, size_t size);
+
+    // True once update() has seen everything it needs; later bytes are ignored
+    bool complete() const;
+
+    // Result so far; a stream that ended inside the headers reports what was seen
+    const PEImageInfo &info() const;
+
+private:
+    void parsePEHeader();
+
+    uint64_t    offset_ = 0; // stream bytes seen
+    uint8_t     dos_[kDosHeaderSize];
+    uint8_t     pe_[6]; // signature and Machine
+    size_t      peFilled_ = 0;
+    uint64_t    peOffset_ = 0; // e_lfanew, once the DOS header is in
+    bool        done_     = false;
+    PEImageInfo info_;
+};
+
+// PE images checked while they were written, by destination path (case and separators do not matter).
+// Safe to fill from several copy or extraction threads.
+class PEImageReport {
+public:
+    void record(const std::string &path, const PEImageInfo &info);
+    bool find(const std::string &path, PEImageInfo &info) const;
+    size_t size() const;
+    void   clear();
+
+private:
+    mutable std::mutex                           mutex_;
+    std::unordered_map<std::string, PEImageInfo> images_;
+};
+
+#endif // PEHEADERVALIDATOR_H
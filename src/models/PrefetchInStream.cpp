@@ -0,0 +1,224 @@
+#include "PrefetchInStream.h"
+
+#include <cstring>
+
+CMyComPtr<IInStream> PrefetchInStream::open(const std::wstring &path, size_t bufferSize, size_t bufferCount,
+                                            PrefetchInStream **spec) {
+    CMyComPtr<IInStream> stream;
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return stream;
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return stream;
+    }
+    if (bufferSize == 0)
+        bufferSize = kDefaultBufferSize;
+    if (bufferCount < 2)
+        bufferCount = 2;
+
+    PrefetchInStream *object = new PrefetchInStream(file, static_cast<UInt64>(size.QuadPart), bufferSize, bufferCount);
+    stream.Attach(object);
+    if (spec)
+        *spec = object;
+    return stream;
+}
+
+size_t PrefetchInStream::defaultBufferCount(const std::wstring &path) {
+    wchar_t volume[MAX_PATH] = {};
+    if (GetVolumePathNameW(path.c_str(), volume, MAX_PATH) && GetDriveTypeW(volume) == DRIVE_REMOTE)
+        return 2 * kDefaultBufferCount;
+    return kDefaultBufferCount;
+}
+
+PrefetchInStream::PrefetchInStream(HANDLE file, UInt64 size, size_t bufferSize, size_t bufferCount)
+    : _ref(1), _file(file), _size(size), _bufferSize(bufferSize), _slots(bufferCount) {
+    for (auto &slot : _slots) {
+        slot.data.resize(_bufferSize);
+    }
+    _worker = std::thread(&PrefetchInStream::run, this);
+}
+
+PrefetchInStream::~PrefetchInStream() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _fetchCv.notify_all();
+    if (_worker.joinable())
+        _worker.join();
+    CloseHandle(_file);
+}
+
+PrefetchInStream::Stats PrefetchInStream::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+STDMETHODIMP PrefetchInStream::QueryInterface(REFIID riid, void **ppvObject) {
+    if (!ppvObject)
+        return E_POINTER;
+    *ppvObject = nullptr;
+    if (riid == IID_IUnknown || riid == IID_ISequentialInStream || riid == IID_IInStream) {
+        *ppvObject = static_cast<IInStream *>(this);
+        AddRef();
+        return S_OK;
+    }
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) PrefetchInStream::AddRef() {
+    return (ULONG)InterlockedIncrement(&_ref);
+}
+
+STDMETHODIMP_(ULONG) PrefetchInStream::Release() {
+    ULONG r = (ULONG)InterlockedDecrement(&_ref);
+    if (r == 0)
+        delete this;
+    return r;
+}
+
+STDMETHODIMP PrefetchInStream::Read(void *data, UInt32 size, UInt32 *processedSize) {
+    if (processedSize)
+        *processedSize = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    UInt32                       done    = 0;
+    bool                         counted = false;
+    while (done < size && _pos < _size) {
+        Slot *slot = findSlot(_pos);
+        if (!counted) {
+            ++(slot ? _stats.hits : _stats.misses);
+            counted = true;
+        }
+        if (!slot) {
+            // Outside the window: restart read-ahead here. Anything still loading for the old window
+            // becomes reusable once it lands, since it no longer overlaps the window.
+            _nextFetch = _pos - _pos % _bufferSize;
+            _fetchCv.notify_one();
+        }
+        _readyCv.wait(lock, [&] {
+            slot = findSlot(_pos);
+            return slot && slot->state != SlotState::Loading;
+        });
+        if (slot->state == SlotState::Failed) {
+            slot->state = SlotState::Empty;
+            return E_FAIL;
+        }
+
+        const UInt64 available = slot->offset + slot->length - _pos;
+        const UInt32 chunk     = (UInt32)(available < (UInt64)(size - done) ? available : (UInt64)(size - done));
+        std::memcpy(static_cast<Byte *>(data) + done, slot->data.data() + (_pos - slot->offset), chunk);
+        slot->consumed = true;
+        _pos += chunk;
+        done += chunk;
+        if (processedSize)
+            *processedSize = done;
+        _fetchCv.notify_one();
+    }
+    return S_OK;
+}
+
+STDMETHODIMP PrefetchInStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Int64                       base = 0;
+    switch (seekOrigin) {
+    case STREAM_SEEK_SET:
+        base = 0;
+        break;
+    case STREAM_SEEK_CUR:
+        base = (Int64)_pos;
+        break;
+    case STREAM_SEEK_END:
+        base = (Int64)_size;
+        break;
+    default:
+        return STG_E_INVALIDFUNCTION;
+    }
+    if (offset < -base)
+        return HRESULT_WIN32_ERROR_NEGATIVE_SEEK;
+    // Seeking is free; the window only moves when a read actually misses
+    _pos = (UInt64)(base + offset);
+    if (newPosition)
+        *newPosition = _pos;
+    return S_OK;
+}
+
+PrefetchInStream::Slot *PrefetchInStream::findSlot(UInt64 pos) {
+    for (auto &slot : _slots) {
+        if ((slot.state == SlotState::Ready || slot.state == SlotState::Loading || slot.state == SlotState::Failed) &&
+            pos >= slot.offset && pos < slot.offset + slot.length)
+            return &slot;
+    }
+    return nullptr;
+}
+
+UInt64 PrefetchInStream::windowEnd() const {
+    return _pos - _pos % _bufferSize + _bufferSize * _slots.size();
+}
+
+PrefetchInStream::Slot *PrefetchInStream::reusableSlot() {
+    // Blocks in [block(_pos), windowEnd()) are kept; everything behind the reader or beyond the window is
+    // fair game. The window spans exactly as many blocks as there are slots, so the block under the reader
+    // can always be loaded.
+    const UInt64 start = _pos - _pos % _bufferSize;
+    const UInt64 end   = windowEnd();
+    for (auto &slot : _slots) {
+        if (slot.state == SlotState::Loading)
+            continue;
+        if (slot.state == SlotState::Empty || slot.offset + slot.length <= start || slot.offset >= end)
+            return &slot;
+    }
+    return nullptr;
+}
+
+void PrefetchInStream::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        Slot *slot = nullptr;
+        _fetchCv.wait(lock, [&] {
+            if (_stopping)
+                return true;
+            if (_nextFetch < _pos - _pos % _bufferSize)
+                _nextFetch = _pos - _pos % _bufferSize; // the reader skipped ahead
+            while (_nextFetch < _size && _nextFetch < windowEnd() && findSlot(_nextFetch)) {
+                _nextFetch += _bufferSize;
+            }
+            if (_nextFetch >= _size || _nextFetch >= windowEnd())
+                return false;
+            slot = reusableSlot();
+            return slot != nullptr;
+        });
+        if (_stopping)
+            return;
+
+        if (slot->state == SlotState::Ready && !slot->consumed)
+            _stats.bytesDiscarded += slot->length;
+        slot->state    = SlotState::Loading;
+        slot->offset   = _nextFetch;
+        slot->length   = (size_t)(_size - _nextFetch < _bufferSize ? _size - _nextFetch : _bufferSize);
+        slot->consumed = false;
+        _nextFetch += _bufferSize;
+
+        const UInt64 offset = slot->offset;
+        const size_t length = slot->length;
+        lock.unlock();
+        size_t total = 0;
+        bool   ok    = true;
+        while (ok && total < length) {
+            OVERLAPPED overlapped{};
+            overlapped.Offset     = (DWORD)(offset + total);
+            overlapped.OffsetHigh = (DWORD)((offset + total) >> 32);
+            DWORD read            = 0;
+            ok = ReadFile(_file, slot->data.data() + total, (DWORD)(length - total), &read, &overlapped) && read > 0;
+            total += read;
+        }
+        lock.lock();
+
+        slot->state = ok ? SlotState::Ready : SlotState::Failed;
+        if (ok)
+            _stats.bytesPrefetched += length;
+        _readyCv.notify_all();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef PREFETCHINSTREAM_H
+#define PREFETCHINSTREAM_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <windows.h>
+
+#include "7zip/IStream.h"
+#include "Common/MyCom.h"
+
+// IInStream for images on slow media (USB disks, network shares). A background thread keeps a ring of
+// large buffers filled ahead of the last read position, so sequential (extent-ordered) extraction finds
+// its data already in memory. A read outside the buffered window counts as a miss: the window restarts
+// there and speculative reads still in flight are discarded when they complete.
+class PrefetchInStream : public IInStream {
+public:
+    static constexpr size_t kDefaultBufferSize  = 1u << 20;
+    static constexpr size_t kDefaultBufferCount = 8;
+
+    struct Stats {
+        uint64_t hits            = 0; // Read() calls served from a filled or in-flight buffer
+        uint64_t misses          = 0; // Read() calls that had to restart the window
+        uint64_t bytesPrefetched = 0;
+        uint64_t bytesDiscarded  = 0; // prefetched but dropped before being read
+    };
+
+    // Opens path for prefetched reading; returns an empty pointer if it cannot be opened. spec, when
+    // given, receives the concrete object (owned by the returned pointer) for stats().
+    static CMyComPtr<IInStream> open(const std::wstring &path, size_t bufferSize, size_t bufferCount,
+                                     PrefetchInStream **spec = nullptr);
+
+    Stats stats() const;
+
+    // Ring depth suited to the volume holding path: deeper on network shares to cover round trips
+    static size_t defaultBufferCount(const std::wstring &path);
+
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObject) override;
+    STDMETHOD_(ULONG, AddRef)() override;
+    STDMETHOD_(ULONG, Release)() override;
+
+    STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize) override;
+    STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition) override;
+
+private:
+    enum class SlotState { Empty, Loading, Ready, Failed };
+    struct Slot {
+        std::vector<Byte> data;
+        UInt64            offset   = 0;
+        size_t            length   = 0;
+        SlotState         state    = SlotState::Empty;
+        bool              consumed = false;
+    };
+
+    PrefetchInStream(HANDLE file, UInt64 size, size_t bufferSize, size_t bufferCount);
+    ~PrefetchInStream();
+
+    Slot  *findSlot(UInt64 pos);
+    Slot  *reusableSlot();
+    UInt64 windowEnd() const;
+    void   run();
+
+    LONG                    _ref;
+    HANDLE                  _file;
+    UInt64                  _size;
+    UInt64                  _pos = 0;
+    size_t                  _bufferSize;
+    std::vector<Slot>       _slots;
+    UInt64                  _nextFetch = 0;
+    bool                    _stopping  = false;
+    Stats                   _stats;
+    mutable std::mutex      _mutex;
+    std::condition_variable _fetchCv;
+    std::condition_variable _readyCv;
+    std::thread             _worker;
+};
+
+#endif // PREFETCHINSTREAM_H
@@ -0,0 +1,67 @@
+#include "ThroughputModel.h"
+
+#include <cmath>
+#include <cstdio>
+
+ThroughputModel::ThroughputModel(double halfLifeSeconds) : halfLife_(halfLifeSeconds > 0 ? halfLifeSeconds : 1) {}
+
+void ThroughputModel::reset() {
+    started_   = false;
+    firstTime_ = 0;
+    lastTime_  = 0;
+    lastBytes_ = 0;
+    rate_      = 0;
+}
+
+void ThroughputModel::sample(double seconds, unsigned long long bytesDone) {
+    if (!started_) {
+        // The first sample only sets the origin; with nothing timed yet there is no rate to take
+        started_   = true;
+        firstTime_ = seconds;
+        lastTime_  = seconds;
+        lastBytes_ = bytesDone;
+        return;
+    }
+    const double elapsed = seconds - lastTime_;
+    if (elapsed <= 0)
+        return;
+    const unsigned long long moved = bytesDone > lastBytes_ ? bytesDone - lastBytes_ : 0;
+    const double             rate  = static_cast<double>(moved) / elapsed;
+    if (lastTime_ == firstTime_) {
+        rate_ = rate;
+    } else {
+        const double weight = 1 - std::exp2(-elapsed / halfLife_);
+        rate_ += weight * (rate - rate_);
+    }
+    lastTime_  = seconds;
+    lastBytes_ = bytesDone;
+}
+
+bool ThroughputModel::ready() const {
+    return started_ && lastTime_ - firstTime_ >= kWarmUpSeconds && rate_ > 0;
+}
+
+double ThroughputModel::bytesPerSecond() const {
+    return rate_;
+}
+
+double ThroughputModel::secondsLeft(unsigned long long remainingBytes) const {
+    if (!ready())
+        return -1;
+    return static_cast<double>(remainingBytes) / rate_;
+}
+
+std::string ThroughputModel::formatRemaining(double seconds) {
+    if (seconds < 0)
+        return std::string();
+    const long long total = std::llround(seconds);
+    char            text[64];
+    if (total >= 3600) {
+        std::snprintf(text, sizeof(text), "quedan %lld h %02lld min", total / 3600, total % 3600 / 60);
+    } else if (total >= 60) {
+        std::snprintf(text, sizeof(text), "quedan %lld min %02lld s", total / 60, total % 60);
+    } else {
+        std::snprintf(text, sizeof(text), "quedan %lld s", total);
+    }
+    return text;
+}
@@ -0,0 +1,40 @@
+#ifndef THROUGHPUTMODEL_H
+#define THROUGHPUTMODEL_H
+
+#include <string>
+
+// Copy rate smoothed with an exponentially weighted moving average, and the time left at that rate. The
+// weight of a sample decays with the time it covers rather than with the number of samples, so uneven
+// reporting intervals do not skew it; halfLifeSeconds is how long it takes an old rate to count half.
+class ThroughputModel {
+public:
+    static constexpr double kDefaultHalfLife = 5.0;
+    static constexpr double kWarmUpSeconds   = 2.0; // no estimate before this much has been timed
+
+    explicit ThroughputModel(double halfLifeSeconds = kDefaultHalfLife);
+
+    void reset();
+
+    // Cumulative: bytesDone after seconds since the copy started. Samples that do not move time forward
+    // are ignored.
+    void sample(double seconds, unsigned long long bytesDone);
+
+    bool   ready() const;
+    double bytesPerSecond() const;
+
+    // Seconds until remainingBytes are copied at the smoothed rate; negative while not ready()
+    double secondsLeft(unsigned long long remainingBytes) const;
+
+    // "quedan 1 h 05 min", "quedan 3 min 20 s", "quedan 12 s"; empty for a negative value
+    static std::string formatRemaining(double seconds);
+
+private:
+    double             halfLife_;
+    bool               started_   = false;
+    double             firstTime_ = 0;
+    double             lastTime_  = 0;
+    unsigned long long lastBytes_ = 0;
+    double             rate_      = 0;
+};
+
+#endif // THROUGHPUTMODEL_H
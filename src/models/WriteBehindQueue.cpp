@@ -0,0 +1,192 @@
+#include "WriteBehindQueue.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstring>
+
+struct WriteBehindQueue::Buffer {
+    explicit Buffer(size_t size)
+        : data(static_cast<char *>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE))) {
+        if (!data) {
+            data = new char[size];
+            heap = true;
+        }
+    }
+    ~Buffer() {
+        if (heap)
+            delete[] data;
+        else
+            VirtualFree(data, 0, MEM_RELEASE);
+    }
+    char *data;         // page aligned unless VirtualAlloc failed
+    bool  heap = false;
+};
+
+struct WriteBehindQueue::File : std::enable_shared_from_this<WriteBehindQueue::File> {
+    HANDLE            handle  = INVALID_HANDLE_VALUE;
+    Buffer           *current = nullptr;
+    size_t            used    = 0;
+    std::atomic<bool> failed{false};
+
+    // Producer side only
+    bool                         closed = false;
+    std::function<void(bool ok)> onClose;
+
+    ~File() {
+        if (handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+    }
+};
+
+WriteBehindQueue::WriteBehindQueue(size_t bufferSize, size_t bufferCount) : bufferSize_(bufferSize) {
+    for (size_t i = 0; i < bufferCount || buffers_.empty(); ++i) {
+        buffers_.push_back(std::make_unique<Buffer>(bufferSize_));
+        freeBuffers_.push_back(buffers_.back().get());
+    }
+    worker_ = std::thread(&WriteBehindQueue::run, this);
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    finish();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queueCv_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+std::shared_ptr<WriteBehindQueue::File> WriteBehindQueue::open(const std::wstring &path, uint64_t sizeHint) {
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    if (sizeHint > 0) {
+        // Reserve the clusters without moving end-of-file: the volume can hand out one contiguous run, and a
+        // failed extraction does not leave a full-size file of zeros behind
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(sizeHint);
+        SetFileInformationByHandle(handle, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+
+    auto file    = std::make_shared<File>();
+    file->handle = handle;
+    return file;
+}
+
+bool WriteBehindQueue::write(File &file, const void *data, size_t size) {
+    const char *src = static_cast<const char *>(data);
+    while (size > 0 && !file.failed.load()) {
+        if (!file.current) {
+            file.current = acquireBuffer();
+            file.used    = 0;
+        }
+        const size_t chunk = size < bufferSize_ - file.used ? size : bufferSize_ - file.used;
+        std::memcpy(file.current->data + file.used, src, chunk);
+        file.used += chunk;
+        src += chunk;
+        size -= chunk;
+        if (file.used == bufferSize_)
+            submit(file, false);
+    }
+    return !file.failed.load();
+}
+
+void WriteBehindQueue::close(File &file) {
+    file.closed = true;
+    submit(file, true, std::move(file.onClose));
+}
+
+void WriteBehindQueue::after(File &file, std::function<void(bool ok)> action) {
+    submit(file, false, std::move(action));
+}
+
+void WriteBehindQueue::afterClose(File &file, std::function<void(bool ok)> action) {
+    if (!file.closed) {
+        file.onClose = std::move(action);
+        return;
+    }
+    // The close is already queued: an op with no data runs after it
+    submit(file, false, std::move(action));
+}
+
+bool WriteBehindQueue::finish() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    freeCv_.wait(lock, [this] { return pending_ == 0; });
+    return !failed_;
+}
+
+WriteBehindQueue::Buffer *WriteBehindQueue::acquireBuffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    freeCv_.wait(lock, [this] { return !freeBuffers_.empty(); });
+    Buffer *buffer = freeBuffers_.back();
+    freeBuffers_.pop_back();
+    return buffer;
+}
+
+void WriteBehindQueue::releaseBuffer(Buffer *buffer) {
+    if (!buffer)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        freeBuffers_.push_back(buffer);
+    }
+    freeCv_.notify_all();
+}
+
+void WriteBehindQueue::submit(File &file, bool closeAfter, std::function<void(bool ok)> done) {
+    Op op{file.shared_from_this(), file.used > 0 ? file.current : nullptr, file.used, closeAfter, std::move(done)};
+    if (file.current && file.used == 0)
+        releaseBuffer(file.current);
+    file.current = nullptr;
+    file.used    = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(op));
+        ++pending_;
+    }
+    queueCv_.notify_one();
+}
+
+void WriteBehindQueue::run() {
+    for (;;) {
+        Op op;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queueCv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+            op = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        File &file = *op.file;
+        for (size_t pos = 0; op.buffer && pos < op.length && !file.failed.load();) {
+            DWORD written = 0;
+            if (!WriteFile(file.handle, op.buffer->data + pos, static_cast<DWORD>(op.length - pos), &written,
+                           nullptr) ||
+                written == 0) {
+                file.failed = true;
+            }
+            pos += written;
+        }
+        if (op.closeAfter && file.handle != INVALID_HANDLE_VALUE) {
+            if (!CloseHandle(file.handle))
+                file.failed = true;
+            file.handle = INVALID_HANDLE_VALUE;
+        }
+        if (op.done)
+            op.done(!file.failed.load());
+
+        releaseBuffer(op.buffer);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            failed_ = failed_ || file.failed.load();
+            --pending_;
+        }
+        freeCv_.notify_all();
+    }
+}
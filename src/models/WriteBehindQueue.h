@@ -0,0 +1,79 @@
+#ifndef WRITEBEHINDQUEUE_H
+#define WRITEBEHINDQUEUE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Output side of an extraction pass. Files are created on the caller's thread (so open errors surface
+// immediately) with their final size reserved up front; data is staged in large page-aligned buffers
+// that a single background thread writes out, and handles are closed on that thread as well, so the
+// decoder never waits on WriteFile/CloseHandle latency. The number of buffers is bounded: producers
+// block when all of them are queued.
+class WriteBehindQueue {
+public:
+    static constexpr size_t kDefaultBufferSize  = 1u << 20;
+    static constexpr size_t kDefaultBufferCount = 16;
+
+    struct File;
+
+    explicit WriteBehindQueue(size_t bufferSize = kDefaultBufferSize, size_t bufferCount = kDefaultBufferCount);
+    ~WriteBehindQueue();
+    WriteBehindQueue(const WriteBehindQueue &)            = delete;
+    WriteBehindQueue &operator=(const WriteBehindQueue &) = delete;
+
+    // Creates (truncating) path and reserves sizeHint bytes of allocation; nullptr on failure
+    std::shared_ptr<File> open(const std::wstring &path, uint64_t sizeHint);
+
+    // Appends data to the file; false once a write to this file has failed
+    bool write(File &file, const void *data, size_t size);
+
+    // Queues the remaining data and the handle close; the File must not be written afterwards
+    void close(File &file);
+
+    // Runs action(ok) on the writer thread once the data written to file so far has been handed to the OS,
+    // ok being false if a write to it failed. Not after close().
+    void after(File &file, std::function<void(bool ok)> action);
+
+    // Runs action(ok) on the writer thread once the file's handle is closed, ok being false if a write or
+    // the close failed; for a file not closed yet, as part of its close()
+    void afterClose(File &file, std::function<void(bool ok)> action);
+
+    // Waits until every queued write and close has completed; true if all of them succeeded
+    bool finish();
+
+private:
+    struct Buffer;
+    struct Op {
+        std::shared_ptr<File>        file;
+        Buffer                      *buffer;
+        size_t                       length;
+        bool                         closeAfter;
+        std::function<void(bool ok)> done; // run after the write and close, if any
+    };
+
+    Buffer *acquireBuffer();
+    void    releaseBuffer(Buffer *buffer);
+    void    submit(File &file, bool closeAfter, std::function<void(bool ok)> done = nullptr);
+    void    run();
+
+    size_t                               bufferSize_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    std::vector<Buffer *>                freeBuffers_;
+    std::deque<Op>                       queue_;
+    std::mutex                           mutex_;
+    std::condition_variable              queueCv_;
+    std::condition_variable              freeCv_;
+    size_t                               pending_  = 0;
+    bool                                 stopping_ = false;
+    bool                                 failed_   = false;
+    std::thread                          worker_;
+};
+
+#endif // WRITEBEHINDQUEUE_H
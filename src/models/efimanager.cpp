@@ -13,6 +13,7 @@
 #include "../utils/LocalizationHelpers.h"
 #include "filecopymanager.h"
 #include "ISOReader.h"
+#include "PEHeaderValidator.h"
 
 EFIManager::EFIManager(EventManager &eventManager, FileCopyManager &fileCopyManager)
     : eventManager(eventManager), fileCopyManager(fileCopyManager), isoReader_(std::make_unique<ISOReader>()) {}
@@ -35,18 +36,24 @@ bool EFIManager::extractEFI(const std::string &sourcePath, const std::string &es
         return false;
     }
 
-    // Extract EFI directory from the ISO using ISOReader
-    if (!isoReader_->extractDirectory(sourcePath, "efi", efiDestPath)) {
+    // Extract EFI directory from the ISO using ISOReader; the PE headers of the boot files are checked
+    // from the extracted data, so validating them below needs no second read
+    auto images = std::make_shared<PEImageReport>();
+    isoReader_->setImageReport(images);
+    bool extracted = isoReader_->extractDirectory(sourcePath, "efi", efiDestPath);
+    if (!extracted) {
         // Try uppercase path as some ISOs may list it differently
-        if (!isoReader_->extractDirectory(sourcePath, "EFI", efiDestPath)) {
-            logFile << getTimestamp() << "Failed to extract EFI directory from ISO" << std::endl;
-            logFile.close();
-            return false;
-        }
+        extracted = isoReader_->extractDirectory(sourcePath, "EFI", efiDestPath);
+    }
+    isoReader_->setImageReport(nullptr);
+    if (!extracted) {
+        logFile << getTimestamp() << "Failed to extract EFI directory from ISO" << std::endl;
+        logFile.close();
+        return false;
     }
 
     // Validate and fix EFI files after copying
-    validateAndFixEFIFiles(efiDestPath, logFile);
+    validateAndFixEFIFiles(efiDestPath, *images, logFile);
 
     // Create marker file to identify this as BootThatISO temporary partition
     createPartitionMarkerFile(espPath);
@@ -226,19 +233,11 @@ bool EFIManager::extractBootFilesFromWIM(const std::string &sourcePath, const st
             ensureDirectoryRecursive(dstDir);
         }
 
-        if (copyFileUtf8(src, dst)) {
-            bool     valid   = true;
-            uint16_t machine = 0;
-            size_t   pos     = dst.find_last_of('.');
-            if (pos != std::string::npos) {
-                std::string ext = dst.substr(pos);
-                for (auto &c : ext)
-                    c = (char)tolower((unsigned char)c);
-                if (ext == ".efi" || ext == ".exe") {
-                    valid   = isValidPE(dst);
-                    machine = getPEMachine(dst);
-                }
-            }
+        PEImageInfo image;
+        if (fileCopyManager.copyFileChecked(src, dst, image)) {
+            const bool     checked = PEHeaderValidator::isImageName(dst);
+            const bool     valid   = !checked || image.dosHeader;
+            const uint16_t machine = checked ? image.machine : 0;
             if (!valid) {
                 logFile << getTimestamp() << "Copied file appears invalid: " << dst << std::endl;
                 overallSuccess = false;
@@ -310,7 +309,8 @@ bool EFIManager::copyBootmgrForNonWindows(const std::string &sourcePath, const s
     return bootmgrCopied;
 }
 
-bool EFIManager::validateAndFixEFIFiles(const std::string &efiDestPath, std::ofstream &logFile) {
+bool EFIManager::validateAndFixEFIFiles(const std::string &efiDestPath, const PEImageReport &images,
+                                        std::ofstream &logFile) {
     // Check common EFI boot files
     std::vector<std::string> efiFiles = {efiDestPath + "\\boot\\bootx64.efi", efiDestPath + "\\boot\\bootia32.efi",
                                          efiDestPath + "\\BOOT\\BOOTX64.EFI", efiDestPath + "\\BOOT\\BOOTIA32.EFI"};
@@ -318,7 +318,13 @@ bool EFIManager::validateAndFixEFIFiles(const std::string &efiDestPath, std::ofs
     for (const auto &efiFile : efiFiles) {
         DWORD attrs = GetFileAttributesA(efiFile.c_str());
         if (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
-            if (!isValidPE(efiFile)) {
+            // Checked while it was extracted; read from disk only if the extraction did not see it
+            PEImageInfo image;
+            if (!images.find(efiFile, image)) {
+                image.dosHeader = isValidPE(efiFile);
+                image.machine   = image.dosHeader ? getPEMachine(efiFile) : 0;
+            }
+            if (!image.dosHeader) {
                 logFile << getTimestamp() << "EFI file is invalid (not PE): " << efiFile << std::endl;
                 // Try to replace with system EFI file
                 std::string systemEFI = "C:\\Windows\\Boot\\EFI\\bootmgfw.efi";
@@ -333,10 +339,10 @@ bool EFIManager::validateAndFixEFIFiles(const std::string &efiDestPath, std::ofs
                     // Remove invalid file
                     DeleteFileA(efiFile.c_str());
                     // Copy system file
-                    if (copyFileUtf8(systemEFI, efiFile)) {
-                        uint16_t machine = getPEMachine(efiFile);
+                    PEImageInfo replacement;
+                    if (fileCopyManager.copyFileChecked(systemEFI, efiFile, replacement)) {
                         logFile << getTimestamp() << "Replaced invalid EFI file with system bootmgfw.efi: " << efiFile
-                                << " (machine=0x" << std::hex << machine << std::dec << ")" << std::endl;
+                                << " (machine=0x" << std::hex << replacement.machine << std::dec << ")" << std::endl;
                     } else {
                         logFile << getTimestamp() << "Failed to replace invalid EFI file: " << efiFile << std::endl;
                     }
@@ -345,9 +351,8 @@ bool EFIManager::validateAndFixEFIFiles(const std::string &efiDestPath, std::ofs
                             << std::endl;
                 }
             } else {
-                uint16_t machine = getPEMachine(efiFile);
-                logFile << getTimestamp() << "EFI file is valid: " << efiFile << " (machine=0x" << std::hex << machine
-                        << std::dec << ")" << std::endl;
+                logFile << getTimestamp() << "EFI file is valid: " << efiFile << " (machine=0x" << std::hex
+                        << image.machine << std::dec << ")" << std::endl;
             }
         }
     }
@@ -612,10 +617,10 @@ bool EFIManager::ensureSecureBootCompatibleBootloader(const std::string &espPath
                 << std::endl;
 
         // Copy system bootmgfw.efi to ESP
-        if (copyFileUtf8(systemBootmgfw, destBootmgfw)) {
-            uint16_t machine = getPEMachine(destBootmgfw);
+        PEImageInfo image;
+        if (fileCopyManager.copyFileChecked(systemBootmgfw, destBootmgfw, image)) {
             logFile << getTimestamp() << "Copied Secure Boot compatible bootmgfw.efi to ESP (machine=0x" << std::hex
-                    << machine << std::dec << ")" << std::endl;
+                    << image.machine << std::dec << ")" << std::endl;
             return true;
         } else {
             logFile << getTimestamp() << "Failed to copy system bootmgfw.efi to ESP, error: " << GetLastError()
@@ -6,6 +6,7 @@
 
 class FileCopyManager;
 class ISOReader;
+class PEImageReport;
 
 class EFIManager {
 public:
@@ -26,7 +27,7 @@ private:
     bool extractEFIDirectory(const std::string &sourcePath, const std::string &espPath, long long &copiedSoFar,
                              long long isoSize);
     bool copyBootmgrForNonWindows(const std::string &sourcePath, const std::string &espPath);
-    bool validateAndFixEFIFiles(const std::string &efiDestPath, std::ofstream &logFile);
+    bool validateAndFixEFIFiles(const std::string &efiDestPath, const PEImageReport &images, std::ofstream &logFile);
     bool ensureBootFileExists(const std::string &espPath);
     bool ensureSecureBootCompatibleBootloader(const std::string &espPath);
     void createPartitionMarkerFile(const std::string &espPath);
@@ -1,211 +1,787 @@
 #include "filecopymanager.h"
 #include <windows.h>
-#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../utils/Logger.h"
 #include "../utils/Utils.h"
+#include "ThroughputModel.h"
+
+namespace {
+constexpr size_t   kParallelMinFiles = 16;
+constexpr unsigned kMaxCopyThreads   = 8;
+constexpr size_t   kNoFailure        = static_cast<size_t>(-1);
+
+// Files below kSmallFileSize skip CopyFileExW and are copied in runs of up to kSmallBatchFiles files /
+// kSmallBatchBytes bytes through one buffer per worker (see copySmallBatch)
+constexpr unsigned long long kSmallFileSize   = 64 * 1024;
+constexpr size_t             kSmallBatchFiles = 128;
+constexpr size_t             kSmallBatchBytes = 4u << 20;
+
+// Buffer of the streamed copy PE images take so their headers are checked from the bytes being copied
+constexpr size_t kStreamChunkSize = 1u << 20;
+
+// Attributes that make an existing destination refuse to be overwritten
+constexpr DWORD kBlockingAttributes = FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM;
+
+// What a worker takes at once: one large file, or a run of neighbouring small ones
+struct CopyUnit {
+    size_t first = 0;
+    size_t count = 0;
+    bool   small = false;
+};
+
+enum class CopyFailure { None, Copy, NotPE };
+
+// Written only by the worker that ran the job, read by the calling thread after the pool has stopped
+struct CopyOutcome {
+    CopyFailure failure      = CopyFailure::None;
+    DWORD       error        = ERROR_SUCCESS;
+    bool        imageChecked = false; // image holds the headers seen while the file was written
+    PEImageInfo image;
+};
+
+// Contiguous slice of the unit list owned by one worker. The owner takes jobs from the front and idle
+// workers steal the back half, so files of the same directory mostly stay on one thread.
+struct JobRange {
+    std::mutex mutex;
+    size_t     next = 0;
+    size_t     end  = 0;
+};
+
+uint64_t FileTimeTicks(const FILETIME &ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+FILETIME TicksFileTime(uint64_t ticks) {
+    FILETIME ft;
+    ft.dwLowDateTime  = static_cast<DWORD>(ticks);
+    ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+    return ft;
+}
 
 struct CopyProgressContext {
-    EventManager *eventManager;
-    long long     totalSize;
-    long long    &copiedSoFar;
-    std::string   operation;
-    std::string   currentFile;
+    std::atomic<long long>  *inFlight;
+    const std::atomic<bool> *cancel;
 };
 
-static DWORD CALLBACK CopyFileProgressRoutine(LARGE_INTEGER TotalFileSize, LARGE_INTEGER TotalBytesTransferred,
-                                              LARGE_INTEGER StreamSize, LARGE_INTEGER StreamBytesTransferred,
-                                              DWORD dwStreamNumber, DWORD dwCallbackReason, HANDLE hSourceFile,
-                                              HANDLE hDestinationFile, LPVOID lpData) {
+DWORD CALLBACK CopyFileProgressRoutine(LARGE_INTEGER TotalFileSize, LARGE_INTEGER TotalBytesTransferred,
+                                       LARGE_INTEGER StreamSize, LARGE_INTEGER StreamBytesTransferred,
+                                       DWORD dwStreamNumber, DWORD dwCallbackReason, HANDLE hSourceFile,
+                                       HANDLE hDestinationFile, LPVOID lpData) {
     CopyProgressContext *ctx = static_cast<CopyProgressContext *>(lpData);
-    if (ctx && ctx->eventManager && TotalFileSize.QuadPart > 0) {
-        long long current = ctx->copiedSoFar + TotalBytesTransferred.QuadPart;
-
-        // Create detailed message with file name and progress
-        std::string detailedMsg = ctx->operation;
-        if (!ctx->currentFile.empty()) {
-            // Extract just the filename from the path for display
-            size_t      lastSlash = ctx->currentFile.find_last_of("\\/");
-            std::string fileName =
-                (lastSlash != std::string::npos) ? ctx->currentFile.substr(lastSlash + 1) : ctx->currentFile;
-
-            // Add file progress percentage
-            int filePercent = 0;
-            if (TotalFileSize.QuadPart > 0) {
-                filePercent = static_cast<int>((TotalBytesTransferred.QuadPart * 100) / TotalFileSize.QuadPart);
-            }
+    if (!ctx)
+        return PROGRESS_CONTINUE;
+    *ctx->inFlight = TotalBytesTransferred.QuadPart;
+    return ctx->cancel->load() ? PROGRESS_CANCEL : PROGRESS_CONTINUE;
+}
 
-            detailedMsg += " - " + fileName + " (" + std::to_string(filePercent) + "%)";
-        }
+// current and total are bytes of the plan; secondsLeft is the copy's ETA, negative while there is none yet
+void ReportProgress(EventManager &eventManager, const std::string &operation, long long current, long long total,
+                    size_t filesDone, size_t filesTotal, double secondsLeft) {
+    std::string message =
+        operation + " - " + std::to_string(filesDone) + "/" + std::to_string(filesTotal) + " archivos";
+    if (secondsLeft >= 0)
+        message += " - " + ThroughputModel::formatRemaining(secondsLeft);
+    eventManager.notifyDetailedProgress(current > total ? total : current, total, message);
+}
 
-        ctx->eventManager->notifyDetailedProgress(current, ctx->totalSize, detailedMsg);
+// Files a copy into a directory has finished, kept there as ISOCOPYJOURNAL until the copy completes: one
+// line per file, written once its destination is closed, with the size and source write time it was
+// copied with. A copy that finds the journal of an interrupted copy of the same source resumes it; a file
+// is only skipped if that earlier run listed it.
+class CopyJournal {
+public:
+    static constexpr size_t kFlushBytes = 64 * 1024;
 
-        if (ctx->totalSize > 0) {
-            long long bounded = current;
-            if (bounded > ctx->totalSize) {
-                bounded = ctx->totalSize;
-            }
-            long long span = ctx->totalSize;
-            if (span > 0) {
-                int normalized = static_cast<int>(30 + (bounded * 40) / span);
-                if (normalized < 70) {
-                    ctx->eventManager->notifyProgressUpdate(normalized);
-                }
-            }
+    // Loads the journal an interrupted copy of source into dest left behind, or starts a new one
+    void open(const std::string &source, const std::string &dest) {
+        path_   = std::filesystem::u8path(dest) / "ISOCOPYJOURNAL";
+        header_ = std::string(kHeader) + "\t" + source;
+        std::ifstream in(path_, std::ios::binary);
+        std::string   line;
+        resumed_ = in.is_open() && std::getline(in, line) && line == header_;
+        // size \t writeTime \t dest
+        while (resumed_ && std::getline(in, line)) {
+            const size_t tab1 = line.find('\t');
+            const size_t tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+            if (tab2 == std::string::npos)
+                break; // torn tail
+            Entry entry;
+            entry.size      = std::strtoull(line.c_str(), nullptr, 10);
+            entry.writeTime = std::strtoull(line.c_str() + tab1 + 1, nullptr, 10);
+            finished_[line.substr(tab2 + 1)] = entry;
         }
+        in.close();
+        out_.open(path_, resumed_ ? std::ios::binary | std::ios::app : std::ios::binary | std::ios::trunc);
+        if (!resumed_)
+            out_ << header_ << "\n" << std::flush;
+    }
+
+    // True if this copy picks up an interrupted one
+    bool resumed() const {
+        return resumed_;
+    }
+
+    // True if the interrupted copy finished file as it is planned now
+    bool finished(const PlannedFile &file) const {
+        auto it = finished_.find(file.dest);
+        return it != finished_.end() && it->second.size == file.size && it->second.writeTime == file.writeTime;
     }
-    return PROGRESS_CONTINUE;
+
+    // Called from any worker once file.dest is written and closed
+    void record(const PlannedFile &file) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ += std::to_string(file.size) + "\t" + std::to_string(file.writeTime) + "\t" + file.dest + "\n";
+        if (pending_.size() >= kFlushBytes)
+            writePending();
+    }
+
+    // Writes out what is pending and keeps the journal for the next run
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writePending();
+        out_.close();
+    }
+
+    // The copy completed: the journal goes
+    void discard() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        out_.close();
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+
+private:
+    static constexpr const char *kHeader = "BTCOPYJOURNAL 1";
+
+    struct Entry {
+        unsigned long long size      = 0;
+        uint64_t           writeTime = 0;
+    };
+
+    void writePending() {
+        if (pending_.empty() || !out_.is_open())
+            return;
+        out_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+        out_.flush();
+        pending_.clear();
+    }
+
+    std::filesystem::path                  path_;
+    std::string                            header_;
+    bool                                   resumed_ = false;
+    std::unordered_map<std::string, Entry> finished_;
+    std::mutex                             mutex_;
+    std::string                            pending_;
+    std::ofstream                          out_;
+};
+
+// True if file.dest holds a complete copy of file.source from an interrupted run: journal lists it as
+// finished and the file still has the size and write time it was left with (copies get the source's
+// last-write time only once the data is in place; FAT32 keeps write times at 2 s resolution).
+// destAttributes gets the attributes of file.dest, INVALID_FILE_ATTRIBUTES if it does not exist.
+bool IsAlreadyCopied(const PlannedFile &file, const CopyJournal &journal, DWORD &destAttributes) {
+    destAttributes = INVALID_FILE_ATTRIBUTES;
+    WIN32_FILE_ATTRIBUTE_DATA dest{};
+    if (!GetFileAttributesExW(Utils::utf8_to_wstring(file.dest).c_str(), GetFileExInfoStandard, &dest))
+        return false;
+    destAttributes = dest.dwFileAttributes;
+    if (!journal.finished(file))
+        return false;
+    if (((static_cast<unsigned long long>(dest.nFileSizeHigh) << 32) | dest.nFileSizeLow) != file.size)
+        return false;
+    const long long delta = static_cast<long long>(FileTimeTicks(dest.ftLastWriteTime) - file.writeTime);
+    return delta >= -20000000LL && delta <= 20000000LL;
 }
 
-FileCopyManager::FileCopyManager(EventManager &eventManager) : eventManager(eventManager) {}
+// Cluster size of the volume dest is on; the default for format on a volume that size if the volume
+// cannot be asked (not mounted yet, or a path without a drive letter)
+unsigned long long VolumeClusterSize(const std::string &dest, const std::string &format) {
+    if (dest.size() < 2 || dest[1] != ':')
+        return CopyPlan::defaultClusterSize(format, 0);
+    const std::string root = dest.substr(0, 2) + "\\";
+    DWORD             sectorsPerCluster, bytesPerSector, freeClusters, totalClusters;
+    if (GetDiskFreeSpaceA(root.c_str(), &sectorsPerCluster, &bytesPerSector, &freeClusters, &totalClusters))
+        return static_cast<unsigned long long>(sectorsPerCluster) * bytesPerSector;
+    ULARGE_INTEGER available, total, free;
+    if (GetDiskFreeSpaceExA(root.c_str(), &available, &total, &free))
+        return CopyPlan::defaultClusterSize(format, total.QuadPart);
+    return CopyPlan::defaultClusterSize(format, 0);
+}
 
-FileCopyManager::~FileCopyManager() {}
+// Opens dest for writing, replacing it. A read-only, hidden or system file left by an earlier run refuses
+// CREATE_ALWAYS, so its attributes are cleared and the open retried.
+HANDLE CreateDestination(const std::wstring &dest) {
+    HANDLE out = CreateFileW(dest.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (out == INVALID_HANDLE_VALUE && GetLastError() == ERROR_ACCESS_DENIED) {
+        SetFileAttributesW(dest.c_str(), FILE_ATTRIBUTE_NORMAL);
+        out = CreateFileW(dest.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    return out;
+}
 
-bool FileCopyManager::copyDirectoryWithProgress(const std::string &source, const std::string &dest, long long totalSize,
-                                                long long &copiedSoFar, const std::set<std::string> &excludeDirs,
-                                                const std::string &operation) {
-    std::string logDir = Utils::getExeDirectory() + "logs";
-    CreateDirectoryA(logDir.c_str(), NULL);
-    // Skip creating directory if it's a drive root (e.g., "Z:\")
-    bool isDriveRoot = (dest.length() == 3 && dest[1] == ':' && dest[2] == '\\');
-    if (!isDriveRoot) {
-        BOOL result = CreateDirectoryA(dest.c_str(), NULL);
-        if (!result) {
-            DWORD error = GetLastError();
-            if (error != ERROR_ALREADY_EXISTS) {
-                std::ofstream errorLog(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-                errorLog << getTimestamp() << "Failed to create directory: " << dest << " Error code: " << error
-                         << "\n";
-                errorLog.close();
-                eventManager.notifyLogUpdate("Error: Failed to create directory " + dest + " (Error " +
-                                             std::to_string(error) + ")\r\n");
-                return false;
-            } else {
-                std::ofstream errorLog(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-                errorLog << getTimestamp() << "Directory already exists: " << dest << "\n";
-                errorLog.close();
-            }
-        } else {
-            std::ofstream errorLog(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-            errorLog << getTimestamp() << "Created directory: " << dest << "\n";
-            errorLog.close();
+// Copies source to dest through buffer, feeding validator with every chunk read, so a PE image is checked
+// without being opened again. dest gets the source's last-write time, as CopyFileExW does, and is deleted
+// if the copy fails. inFlight follows the bytes copied; cancel stops the copy with ERROR_REQUEST_ABORTED.
+DWORD StreamCopy(const std::wstring &source, const std::wstring &dest, std::vector<char> &buffer,
+                 PEHeaderValidator &validator, std::atomic<long long> *inFlight = nullptr,
+                 const std::atomic<bool> *cancel = nullptr) {
+    validator.reset();
+    HANDLE in = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (in == INVALID_HANDLE_VALUE)
+        return GetLastError();
+    HANDLE out = CreateDestination(dest);
+    if (out == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        CloseHandle(in);
+        return error;
+    }
+
+    buffer.resize((std::max)(buffer.size(), kStreamChunkSize));
+    DWORD     error  = ERROR_SUCCESS;
+    long long copied = 0;
+    while (true) {
+        if (cancel && cancel->load()) {
+            error = ERROR_REQUEST_ABORTED;
+            break;
+        }
+        DWORD read = 0;
+        if (!ReadFile(in, buffer.data(), static_cast<DWORD>(kStreamChunkSize), &read, NULL)) {
+            error = GetLastError();
+            break;
         }
+        if (read == 0)
+            break;
+        validator.update(buffer.data(), read);
+        DWORD written = 0;
+        if (!WriteFile(out, buffer.data(), read, &written, NULL) || written != read) {
+            error = GetLastError();
+            if (error == ERROR_SUCCESS)
+                error = ERROR_WRITE_FAULT;
+            break;
+        }
+        copied += read;
+        if (inFlight)
+            *inFlight = copied;
     }
+    FILETIME writeTime;
+    if (error == ERROR_SUCCESS &&
+        !(GetFileTime(in, NULL, NULL, &writeTime) && SetFileTime(out, NULL, NULL, &writeTime)))
+        error = GetLastError();
+    CloseHandle(in);
+    CloseHandle(out);
+    if (error != ERROR_SUCCESS)
+        DeleteFileW(dest.c_str());
+    return error;
+}
+
+// Walks source depth-first into plan: every destination directory before any of its children, then the
+// files; excluded names are skipped at any depth. destDir is the index of dest in plan.dirs(). False only
+// if cancelled.
+bool EnumerateTree(EventManager &eventManager, const std::string &source, const std::string &dest, size_t destDir,
+                   const std::set<std::string> &excludeDirs, CopyPlan &plan) {
+    if (eventManager.isCancelRequested())
+        return false;
     WIN32_FIND_DATAA findData;
     HANDLE           hFind = FindFirstFileA((source + "\\*").c_str(), &findData);
     if (hFind == INVALID_HANDLE_VALUE)
         return true;
+    std::vector<std::string> subdirs;
     do {
         std::string name = findData.cFileName;
-        if (eventManager.isCancelRequested()) {
-            FindClose(hFind);
+        if (name == "." || name == ".." || excludeDirs.find(name) != excludeDirs.end())
+            continue;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            subdirs.push_back(name);
+        } else {
+            const unsigned long long size =
+                (static_cast<unsigned long long>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+            plan.addFile(source + "\\" + name, dest + "\\" + name, destDir, size, findData.dwFileAttributes,
+                         FileTimeTicks(findData.ftLastWriteTime));
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+
+    for (const std::string &name : subdirs) {
+        const size_t dir = plan.addDirectory(dest + "\\" + name);
+        if (!EnumerateTree(eventManager, source + "\\" + name, dest + "\\" + name, dir, excludeDirs, plan))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+FileCopyManager::FileCopyManager(EventManager &eventManager) : eventManager(eventManager) {}
+
+FileCopyManager::~FileCopyManager() {}
+
+void FileCopyManager::setCopyThreads(unsigned threads) {
+    copyThreads = threads;
+}
+
+bool FileCopyManager::planCopy(const std::string &source, const std::string &dest,
+                               const std::set<std::string> &excludeDirs, CopyPlan &plan, const std::string &format) {
+    plan = CopyPlan(source, dest, VolumeClusterSize(dest, format));
+    // Skip creating directory if it's a drive root (e.g., "Z:\")
+    bool         isDriveRoot = (dest.length() == 3 && dest[1] == ':' && dest[2] == '\\');
+    const size_t destDir     = isDriveRoot ? CopyPlan::kNoDir : plan.addDirectory(dest);
+    return EnumerateTree(eventManager, source, dest, destDir, excludeDirs, plan);
+}
+
+bool FileCopyManager::hasRoomFor(const CopyPlan &plan, unsigned long long &freeBytes) {
+    freeBytes               = 0;
+    const std::string &dest = plan.dest();
+    if (dest.size() < 2 || dest[1] != ':')
+        return true;
+    ULARGE_INTEGER available, total, free;
+    if (!GetDiskFreeSpaceExA((dest.substr(0, 2) + "\\").c_str(), &available, &total, &free))
+        return true;
+    freeBytes = available.QuadPart;
+    return plan.allocatedBytes() <= freeBytes;
+}
+
+bool FileCopyManager::copyDirectoryWithProgress(const std::string &source, const std::string &dest,
+                                                long long &copiedSoFar, const std::set<std::string> &excludeDirs,
+                                                const std::string &operation) {
+    CopyPlan plan(source, dest, CopyPlan::kDefaultClusterSize);
+    if (!planCopy(source, dest, excludeDirs, plan))
+        return false;
+    return copyDirectoryWithProgress(plan, copiedSoFar, operation);
+}
+
+bool FileCopyManager::copyDirectoryWithProgress(const CopyPlan &plan, long long &copiedSoFar,
+                                                const std::string &operation) {
+    const auto startTime = std::chrono::steady_clock::now();
+    lastStats            = FileCopyStats();
+    imageReport.clear();
+
+    // The directories are created (in order, parents first) before any file is written, so the workers
+    // never race on a missing parent
+    const std::vector<std::string> &dirs = plan.dirs();
+    const std::vector<PlannedFile> &jobs = plan.files();
+
+    // Files in a directory this call created cannot hold an earlier copy, so they skip the resume check
+    std::vector<bool> freshDirs(dirs.size(), false);
+    {
+        std::ostringstream errorLog;
+        for (size_t i = 0; i < dirs.size(); ++i) {
+            const std::string &dir = dirs[i];
+            if (CreateDirectoryA(dir.c_str(), NULL)) {
+                freshDirs[i] = true;
+                errorLog << getTimestamp() << "Created directory: " << dir << "\n";
+                continue;
+            }
+            DWORD error = GetLastError();
+            if (error == ERROR_ALREADY_EXISTS) {
+                errorLog << getTimestamp() << "Directory already exists: " << dir << "\n";
+                continue;
+            }
+            errorLog << getTimestamp() << "Failed to create directory: " << dir << " Error code: " << error << "\n";
+            Logger::instance().append(COPY_ERROR_LOG_FILE, errorLog.str());
+            eventManager.notifyLogUpdate("Error: Failed to create directory " + dir + " (Error " +
+                                         std::to_string(error) + ")\r\n");
             return false;
         }
+        Logger::instance().append(COPY_ERROR_LOG_FILE, errorLog.str());
+    }
+    auto mayExist = [&](const PlannedFile &job) { return job.dir == CopyPlan::kNoDir || !freshDirs[job.dir]; };
 
-        if (name != "." && name != ".." && excludeDirs.find(name) == excludeDirs.end()) {
-            std::string srcItem  = source + "\\" + name;
-            std::string destItem = dest + "\\" + name;
-            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                if (!copyDirectoryWithProgress(srcItem, destItem, totalSize, copiedSoFar, excludeDirs, operation)) {
-                    if (eventManager.isCancelRequested()) {
-                        FindClose(hFind);
-                        return false;
-                    }
-                    std::ofstream errorLog(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-                    errorLog << getTimestamp() << "Failed to copy directory: " << srcItem << " to " << destItem << "\n";
-                    errorLog.close();
-                    eventManager.notifyLogUpdate("Error: Failed to copy directory " + srcItem + " to " + destItem +
-                                                 "\r\n");
-                    FindClose(hFind);
-                    return false;
-                }
-            } else {
-                // Log source file info before copying only on error
-                long long fileSize = ((long long)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+    // Only a run that resumes an interrupted copy of the same source skips files, and only those the
+    // interrupted run recorded as finished
+    CopyJournal journal;
+    journal.open(plan.source(), plan.dest());
 
-                // Attempt to normalize source file attributes to avoid copy issues
-                SetFileAttributesA(srcItem.c_str(), FILE_ATTRIBUTE_NORMAL);
+    // Neighbouring small files (same directory, mostly) are grouped into batches
+    std::vector<CopyUnit> units;
+    for (size_t i = 0; i < jobs.size();) {
+        CopyUnit unit;
+        unit.first = i;
+        unit.count = 1;
+        unit.small = jobs[i].size < kSmallFileSize;
+        if (unit.small) {
+            size_t bytes = static_cast<size_t>(jobs[i].size);
+            while (i + unit.count < jobs.size() && unit.count < kSmallBatchFiles) {
+                const unsigned long long next = jobs[i + unit.count].size;
+                if (next >= kSmallFileSize || bytes + static_cast<size_t>(next) > kSmallBatchBytes)
+                    break;
+                bytes += static_cast<size_t>(next);
+                ++unit.count;
+            }
+        }
+        units.push_back(unit);
+        i += unit.count;
+    }
 
-                // Also normalize destination file attributes if it exists
-                DWORD destAttrs = GetFileAttributesA(destItem.c_str());
-                if (destAttrs != INVALID_FILE_ATTRIBUTES) {
-                    SetFileAttributesA(destItem.c_str(), FILE_ATTRIBUTE_NORMAL);
-                }
+    unsigned threads = 1;
+    if (jobs.size() >= kParallelMinFiles) {
+        threads = copyThreads;
+        if (threads == 0) {
+            threads = (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), kMaxCopyThreads);
+        }
+        threads = (std::max)((std::min)(threads, static_cast<unsigned>(units.size())), 1u);
+    }
 
-                if (eventManager.isCancelRequested()) {
-                    FindClose(hFind);
-                    return false;
-                }
+    std::vector<JobRange> ranges(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        ranges[i].next = units.size() * i / threads;
+        ranges[i].end  = units.size() * (i + 1) / threads;
+    }
 
-                CopyProgressContext ctx = {&eventManager, totalSize, copiedSoFar, operation, srcItem};
-                BOOL                copyResult =
-                    CopyFileExW(Utils::utf8_to_wstring(srcItem).c_str(), Utils::utf8_to_wstring(destItem).c_str(),
-                                CopyFileProgressRoutine, &ctx, NULL, 0);
-                if (!copyResult) {
-                    DWORD         error = GetLastError();
-                    std::ofstream errorLog2(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-                    errorLog2 << getTimestamp() << "Failed to copy file: " << srcItem << " to " << destItem
-                              << " Error code: " << error << "\n";
-                    // Additional error details
-                    errorLog2 << getTimestamp() << "Error description: ";
-                    switch (error) {
-                    case ERROR_ACCESS_DENIED:
-                        errorLog2 << "Access denied. Check permissions.\n";
-                        break;
-                    case ERROR_FILE_NOT_FOUND:
-                        errorLog2 << "Source file not found.\n";
-                        break;
-                    case ERROR_PATH_NOT_FOUND:
-                        errorLog2 << "Path not found.\n";
-                        break;
-                    case ERROR_INVALID_DRIVE:
-                        errorLog2 << "Invalid drive.\n";
-                        break;
-                    case ERROR_SHARING_VIOLATION:
-                        errorLog2 << "Sharing violation.\n";
-                        break;
-                    default:
-                        errorLog2 << "Unknown error.\n";
-                        break;
-                    }
-                    // Check destination attributes
-                    DWORD destAttrs = GetFileAttributesA(destItem.c_str());
-                    errorLog2 << getTimestamp() << "Destination attributes after failure: " << destAttrs << "\n";
-                    errorLog2.close();
-                    eventManager.notifyLogUpdate("Error: Failed to copy file " + srcItem + " to " + destItem +
-                                                 " (Error " + std::to_string(error) + ")\r\n");
-                    FindClose(hFind);
-                    return false;
+    // Takes the next unit of slot's range, or steals the back half of the fullest other range
+    auto takeUnit = [&](unsigned slot, size_t &index) {
+        {
+            std::lock_guard<std::mutex> lock(ranges[slot].mutex);
+            if (ranges[slot].next < ranges[slot].end) {
+                index = ranges[slot].next++;
+                return true;
+            }
+        }
+        while (true) {
+            unsigned victim = threads;
+            size_t   most   = 0;
+            for (unsigned i = 0; i < threads; ++i) {
+                std::lock_guard<std::mutex> lock(ranges[i].mutex);
+                if (i != slot && ranges[i].end - ranges[i].next > most) {
+                    most   = ranges[i].end - ranges[i].next;
+                    victim = i;
                 }
-                // If this is an EFI/PE file, do a quick validation to ensure it's a valid PE image
-                auto isEfiFile = [](const std::string &p) -> bool {
-                    size_t pos = p.find_last_of('.');
-                    if (pos == std::string::npos)
-                        return false;
-                    std::string ext = p.substr(pos);
-                    for (auto &c : ext)
-                        c = (char)tolower((unsigned char)c);
-                    return ext == ".efi" || ext == ".exe" || ext == ".dll";
-                };
-                if (isEfiFile(destItem)) {
-                    if (!isValidPE(destItem)) {
-                        std::ofstream errorLog2(logDir + "\\" + COPY_ERROR_LOG_FILE, std::ios::app);
-                        errorLog2 << getTimestamp() << "Copied file appears invalid (not PE): " << destItem << "\n";
-                        errorLog2.close();
-                        eventManager.notifyLogUpdate("Error: Copied file appears invalid (not PE): " + destItem +
-                                                     "\r\n");
-                        FindClose(hFind);
-                        return false;
-                    }
+            }
+            if (victim == threads)
+                return false;
+            size_t begin = 0;
+            size_t end   = 0;
+            {
+                std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+                const size_t                left = ranges[victim].end - ranges[victim].next;
+                if (left == 0)
+                    continue; // drained meanwhile; look again
+                end                = ranges[victim].end;
+                begin              = end - (left + 1) / 2;
+                ranges[victim].end = begin;
+            }
+            std::lock_guard<std::mutex> lock(ranges[slot].mutex);
+            ranges[slot].next = begin + 1;
+            ranges[slot].end  = end;
+            index             = begin;
+            return true;
+        }
+    };
+
+    std::vector<CopyOutcome>            outcomes(jobs.size());
+    std::vector<std::atomic<long long>> inFlight(threads);
+    std::atomic<long long>              finishedBytes{0};
+    std::atomic<size_t>                 finishedFiles{0};
+    std::atomic<size_t>                 copiedFiles{0};
+    std::atomic<size_t>                 copiedSmallFiles{0};
+    std::atomic<long long>              skippedBytes{0};
+    std::atomic<size_t>                 firstFailure{kNoFailure};
+    std::atomic<bool>                   cancel{false};
+    std::atomic<unsigned>               running{threads};
+    std::mutex                          doneMutex;
+    std::condition_variable             doneCv;
+
+    // A failure stops the jobs after it in enumeration order but lets the ones before it finish, so the
+    // error reported is the first one a serial copy would have hit, whatever the thread timing
+    auto recordFailure = [&](size_t index, CopyFailure failure, DWORD error) {
+        outcomes[index].failure = failure;
+        outcomes[index].error   = error;
+        size_t current          = firstFailure.load();
+        while (index < current && !firstFailure.compare_exchange_weak(current, index)) {
+        }
+    };
+    auto finishJob = [&](const PlannedFile &job, bool copied, bool small) {
+        finishedBytes += static_cast<long long>(job.size);
+        ++finishedFiles;
+        if (copied) {
+            journal.record(job);
+            ++copiedFiles;
+            if (small)
+                ++copiedSmallFiles;
+        } else {
+            skippedBytes += static_cast<long long>(job.size);
+        }
+    };
+
+    auto copyLarge = [&](unsigned slot, size_t index, std::vector<char> &buffer) {
+        const PlannedFile &job = jobs[index];
+
+        // Resume an interrupted copy: files that were already copied in full are not copied again
+        DWORD destAttributes = INVALID_FILE_ATTRIBUTES;
+        if (mayExist(job) && IsAlreadyCopied(job, journal, destAttributes)) {
+            finishJob(job, false, false);
+            return;
+        }
+        // A destination left read-only, hidden or system would refuse to be replaced. The source is never
+        // touched: it may be the user's own files.
+        const std::wstring wsource = Utils::utf8_to_wstring(job.source);
+        const std::wstring wdest   = Utils::utf8_to_wstring(job.dest);
+        if (destAttributes != INVALID_FILE_ATTRIBUTES && (destAttributes & kBlockingAttributes)) {
+            SetFileAttributesW(wdest.c_str(), FILE_ATTRIBUTE_NORMAL);
+        }
+
+        // PE images are streamed through the worker's buffer so their headers are checked on the way;
+        // everything else is left to CopyFileExW
+        if (PEHeaderValidator::isImageName(job.dest)) {
+            PEHeaderValidator validator;
+            DWORD             error = StreamCopy(wsource, wdest, buffer, validator, &inFlight[slot], &cancel);
+            inFlight[slot]          = 0;
+            if (error != ERROR_SUCCESS) {
+                if (!cancel.load())
+                    recordFailure(index, CopyFailure::Copy, error);
+                return;
+            }
+            outcomes[index].imageChecked = true;
+            outcomes[index].image        = validator.info();
+            if (!validator.info().dosHeader) {
+                recordFailure(index, CopyFailure::NotPE, ERROR_SUCCESS);
+                return;
+            }
+            finishJob(job, true, false);
+            return;
+        }
+
+        CopyProgressContext ctx = {&inFlight[slot], &cancel};
+        BOOL                copyResult =
+            CopyFileExW(wsource.c_str(), wdest.c_str(), CopyFileProgressRoutine, &ctx, NULL, 0);
+        inFlight[slot] = 0;
+        if (!copyResult) {
+            DWORD error = GetLastError();
+            if (!cancel.load())
+                recordFailure(index, CopyFailure::Copy, error);
+            return;
+        }
+        // CopyFileExW gives the copy the source's attributes; the blocking ones are dropped so the target
+        // stays replaceable, as the streamed and batched copies are
+        if (job.attributes & kBlockingAttributes) {
+            const DWORD kept = job.attributes & ~kBlockingAttributes;
+            SetFileAttributesW(wdest.c_str(), kept != 0 ? kept : FILE_ATTRIBUTE_NORMAL);
+        }
+        finishJob(job, true, false);
+    };
+
+    // Reads a run of small files into arena, then writes them all out. Per file that is one open/read/close
+    // of the source and one create/write/set-time/close of the destination: no CopyFileExW setup and no
+    // attribute calls unless the destination refuses to be replaced. The write time is set so the resume
+    // check recognizes the copy, as it does for CopyFileExW.
+    auto copySmallBatch = [&](const CopyUnit &unit, std::vector<char> &arena) {
+        std::vector<size_t> offsets(unit.count, kNoFailure); // kNoFailure: already copied, nothing to write
+        size_t              used = 0;
+        for (size_t k = 0; k < unit.count; ++k) {
+            const size_t       index = unit.first + k;
+            const PlannedFile &job   = jobs[index];
+            const DWORD        size  = static_cast<DWORD>(job.size);
+            DWORD              destAttributes;
+            if (index > firstFailure.load() || cancel.load())
+                break;
+            if (mayExist(job) && IsAlreadyCopied(job, journal, destAttributes)) {
+                finishJob(job, false, true);
+                continue;
+            }
+            offsets[k] = used;
+            if (size == 0)
+                continue;
+            arena.resize((std::max)(arena.size(), used + size));
+            HANDLE in    = CreateFileW(Utils::utf8_to_wstring(job.source).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                       NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            DWORD  read  = 0;
+            BOOL   ok    = in != INVALID_HANDLE_VALUE && ReadFile(in, arena.data() + used, size, &read, NULL);
+            DWORD  error = ok ? (read == size ? ERROR_SUCCESS : ERROR_HANDLE_EOF) : GetLastError();
+            if (in != INVALID_HANDLE_VALUE)
+                CloseHandle(in);
+            if (error != ERROR_SUCCESS) {
+                // The files read before this one are still written, as a serial copy would have
+                recordFailure(index, CopyFailure::Copy, error);
+                break;
+            }
+            used += size;
+        }
+
+        for (size_t k = 0; k < unit.count; ++k) {
+            if (offsets[k] == kNoFailure)
+                continue;
+            const size_t       index = unit.first + k;
+            const PlannedFile &job   = jobs[index];
+            const DWORD        size  = static_cast<DWORD>(job.size);
+            const char        *data  = arena.data() + offsets[k];
+            const std::wstring wdest = Utils::utf8_to_wstring(job.dest);
+            if (index > firstFailure.load() || cancel.load())
+                return;
+            if (PEHeaderValidator::isImageName(job.dest)) {
+                // The whole file is in the arena already
+                PEHeaderValidator validator;
+                validator.update(data, size);
+                outcomes[index].imageChecked = true;
+                outcomes[index].image        = validator.info();
+                if (!validator.info().dosHeader) {
+                    recordFailure(index, CopyFailure::NotPE, ERROR_SUCCESS);
+                    return;
                 }
+            }
+            HANDLE out     = CreateDestination(wdest);
+            DWORD  written = 0;
+            BOOL  ok      = out != INVALID_HANDLE_VALUE;
+            if (ok && size != 0)
+                ok = WriteFile(out, data, size, &written, NULL) && written == size;
+            const FILETIME writeTime = TicksFileTime(job.writeTime);
+            if (ok)
+                ok = SetFileTime(out, NULL, NULL, &writeTime);
+            DWORD error = ok ? ERROR_SUCCESS : GetLastError();
+            if (out != INVALID_HANDLE_VALUE)
+                CloseHandle(out);
+            if (!ok) {
+                recordFailure(index, CopyFailure::Copy, error != ERROR_SUCCESS ? error : ERROR_WRITE_FAULT);
+                return;
+            }
+            finishJob(job, true, true);
+        }
+    };
 
-                copiedSoFar += fileSize;
+    auto worker = [&](unsigned slot) {
+        std::vector<char> arena;
+        size_t            index = 0;
+        while (!cancel.load() && takeUnit(slot, index)) {
+            const CopyUnit &unit = units[index];
+            if (unit.first > firstFailure.load())
+                continue;
+            if (unit.small) {
+                copySmallBatch(unit, arena);
+            } else {
+                copyLarge(slot, unit.first, arena);
             }
         }
-    } while (FindNextFileA(hFind, &findData));
-    FindClose(hFind);
-    return true;
+        if (--running == 0) {
+            std::lock_guard<std::mutex> doneLock(doneMutex);
+            doneCv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        pool.emplace_back(worker, i);
+    }
+
+    // The calling thread watches for cancellation and aggregates byte progress for the EventManager. The
+    // ETA comes from the rate of the bytes actually written: files skipped as already copied finish at
+    // once and would make the copy look faster than it is.
+    {
+        const long long              planned = static_cast<long long>(plan.totalBytes());
+        ThroughputModel              throughput;
+        std::unique_lock<std::mutex> doneLock(doneMutex);
+        while (running.load() > 0) {
+            doneCv.wait_for(doneLock, std::chrono::milliseconds(100));
+            if (eventManager.isCancelRequested())
+                cancel = true;
+            long long done = finishedBytes.load();
+            for (const auto &bytes : inFlight)
+                done += bytes.load();
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            throughput.sample(elapsed, static_cast<unsigned long long>(done - skippedBytes.load()));
+            const double secondsLeft =
+                throughput.secondsLeft(static_cast<unsigned long long>(planned > done ? planned - done : 0));
+            ReportProgress(eventManager, operation, done, planned, finishedFiles.load(), jobs.size(), secondsLeft);
+        }
+    }
+    for (auto &t : pool) {
+        t.join();
+    }
+    copiedSoFar += finishedBytes.load();
+
+    lastStats.files      = copiedFiles.load();
+    lastStats.smallFiles = copiedSmallFiles.load();
+    lastStats.skipped    = finishedFiles.load() - lastStats.files;
+    lastStats.bytes      = finishedBytes.load();
+    lastStats.seconds    = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (outcomes[i].imageChecked) {
+            imageReport.record(jobs[i].dest, outcomes[i].image);
+            ++lastStats.images;
+        }
+    }
+
+    std::ostringstream errorLog;
+    errorLog << getTimestamp() << "Copied " << plan.source() << ": " << lastStats.files << " files ("
+             << lastStats.smallFiles << " batched), " << lastStats.skipped << " already present, " << lastStats.images
+             << " PE images checked, " << (lastStats.bytes >> 20) << " MB in " << std::fixed << std::setprecision(2)
+             << lastStats.seconds << " s (" << std::setprecision(0) << lastStats.filesPerSecond() << " files/s, "
+             << std::setprecision(1) << lastStats.megabytesPerSecond() << " MB/s)\n";
+    Logger::instance().append(COPY_ERROR_LOG_FILE, errorLog.str());
+    errorLog.str(std::string());
+
+    const bool   cancelled = cancel.load() || eventManager.isCancelRequested();
+    const size_t failed    = firstFailure.load();
+    if (cancelled || failed != kNoFailure) {
+        journal.close();
+    } else {
+        journal.discard();
+    }
+    if (cancelled)
+        return false;
+    if (failed == kNoFailure)
+        return true;
+
+    const PlannedFile &job     = jobs[failed];
+    const CopyOutcome &outcome = outcomes[failed];
+    if (outcome.failure == CopyFailure::NotPE) {
+        errorLog << getTimestamp() << "Copied file appears invalid (not PE): " << job.dest << "\n";
+        Logger::instance().append(COPY_ERROR_LOG_FILE, errorLog.str());
+        eventManager.notifyLogUpdate("Error: Copied file appears invalid (not PE): " + job.dest + "\r\n");
+        return false;
+    }
+    DWORD error = outcome.error;
+    errorLog << getTimestamp() << "Failed to copy file: " << job.source << " to " << job.dest
+             << " Error code: " << error << "\n";
+    // Additional error details
+    errorLog << getTimestamp() << "Error description: ";
+    switch (error) {
+    case ERROR_ACCESS_DENIED:
+        errorLog << "Access denied. Check permissions.\n";
+        break;
+    case ERROR_FILE_NOT_FOUND:
+        errorLog << "Source file not found.\n";
+        break;
+    case ERROR_PATH_NOT_FOUND:
+        errorLog << "Path not found.\n";
+        break;
+    case ERROR_INVALID_DRIVE:
+        errorLog << "Invalid drive.\n";
+        break;
+    case ERROR_SHARING_VIOLATION:
+        errorLog << "Sharing violation.\n";
+        break;
+    default:
+        errorLog << "Unknown error.\n";
+        break;
+    }
+    // Check destination attributes
+    DWORD destAttrs = GetFileAttributesA(job.dest.c_str());
+    errorLog << getTimestamp() << "Destination attributes after failure: " << destAttrs << "\n";
+    Logger::instance().append(COPY_ERROR_LOG_FILE, errorLog.str());
+    eventManager.notifyLogUpdate("Error: Failed to copy file " + job.source + " to " + job.dest + " (Error " +
+                                 std::to_string(error) + ")\r\n");
+    return false;
+}
+
+const FileCopyStats &FileCopyManager::lastCopyStats() const {
+    return lastStats;
+}
+
+const PEImageReport &FileCopyManager::images() const {
+    return imageReport;
 }
 
 const char *FileCopyManager::getTimestamp() {
@@ -223,6 +799,18 @@ bool FileCopyManager::copyFileUtf8(const std::string &src, const std::string &ds
     return CopyFileW(wsrc.c_str(), wdst.c_str(), FALSE);
 }
 
+bool FileCopyManager::copyFileChecked(const std::string &src, const std::string &dst, PEImageInfo &image) {
+    std::vector<char> buffer;
+    PEHeaderValidator validator;
+    DWORD error = StreamCopy(Utils::utf8_to_wstring(src), Utils::utf8_to_wstring(dst), buffer, validator);
+    image       = validator.info();
+    if (error != ERROR_SUCCESS) {
+        SetLastError(error);
+        return false;
+    }
+    return true;
+}
+
 bool FileCopyManager::isValidPE(const std::string &path) {
     std::wstring wpath = Utils::utf8_to_wstring(path);
     HANDLE       h =
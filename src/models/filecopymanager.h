@@ -2,23 +2,75 @@
 
 #include <string>
 #include <set>
+#include "CopyPlan.h"
 #include "EventManager.h"
+#include "PEHeaderValidator.h"
+
+// Outcome of one copyDirectoryWithProgress call. Files/s and MB/s are kept apart: small files are bound by
+// per-file open/create/close work, large ones by bandwidth.
+struct FileCopyStats {
+    size_t    files      = 0; // written by this call
+    size_t    smallFiles = 0; // of those, through the batched small-file path
+    size_t    skipped    = 0; // already complete from an earlier, interrupted run
+    size_t    images     = 0; // .efi/.exe/.dll files whose headers were checked as they were copied
+    long long bytes      = 0; // of written and skipped files
+    double    seconds    = 0;
+
+    double filesPerSecond() const { return seconds > 0 ? static_cast<double>(files) / seconds : 0; }
+    double megabytesPerSecond() const {
+        return seconds > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0;
+    }
+};
 
 class FileCopyManager {
 public:
     explicit FileCopyManager(EventManager &eventManager);
     ~FileCopyManager();
 
-    bool copyDirectoryWithProgress(const std::string &source, const std::string &dest, long long totalSize,
-                                   long long &copiedSoFar, const std::set<std::string> &excludeDirs,
-                                   const std::string &operation);
+    // Enumerates source once into plan: the directories and files to copy to dest, with their sizes
+    // rounded to the clusters of dest's volume (the default cluster size of format if the volume cannot be
+    // asked). False only if cancelled.
+    bool planCopy(const std::string &source, const std::string &dest, const std::set<std::string> &excludeDirs,
+                  CopyPlan &plan, const std::string &format = "");
+
+    // Creates the directory tree of plan, then copies the files on a work-stealing pool, files under
+    // 64 KiB in batches through one buffer. The detailed progress runs over plan.totalBytes() and carries
+    // an ETA once the copy rate has settled; the overall bar is left to the caller. copiedSoFar grows by
+    // the bytes copied or found already copied. On failure the error
+    // reported is the first one in enumeration order, as with a serial copy. A copy that does not complete
+    // leaves ISOCOPYJOURNAL in plan.dest(), listing the files it finished; the next copy of the same source
+    // skips those and removes the journal once it completes.
+    bool copyDirectoryWithProgress(const CopyPlan &plan, long long &copiedSoFar, const std::string &operation);
+
+    // True if the volume of plan.dest() has plan.allocatedBytes() free, or if that cannot be asked.
+    // freeBytes gets the free space, 0 if unknown. Files an earlier run already copied are counted again.
+    bool hasRoomFor(const CopyPlan &plan, unsigned long long &freeBytes);
+
+    // planCopy and copyDirectoryWithProgress in one go
+    bool copyDirectoryWithProgress(const std::string &source, const std::string &dest, long long &copiedSoFar,
+                                   const std::set<std::string> &excludeDirs, const std::string &operation);
+
+    // Files copied at once by copyDirectoryWithProgress: 0 = one per core (capped), 1 = serial
+    void setCopyThreads(unsigned threads);
+
+    const FileCopyStats &lastCopyStats() const;
+
+    // PE headers of the images written by the last copyDirectoryWithProgress, read from the copy's own
+    // buffers. Files skipped as already copied are not in it.
+    const PEImageReport &images() const;
 
     // Utility functions
     const char *getTimestamp();
     bool        copyFileUtf8(const std::string &src, const std::string &dst);
+    // Like copyFileUtf8, and image gets the PE headers seen on the way (no second open); GetLastError()
+    // tells why it failed
+    bool        copyFileChecked(const std::string &src, const std::string &dst, PEImageInfo &image);
     bool        isValidPE(const std::string &path);
     uint16_t    getPEMachine(const std::string &path);
 
 private:
     EventManager &eventManager;
+    unsigned      copyThreads = 0;
+    FileCopyStats lastStats;
+    PEImageReport imageReport;
 };
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <filesystem>
+#include <future>
 #include "../utils/Utils.h"
 #include "../utils/LocalizationManager.h"
 #include "../utils/LocalizationHelpers.h"
@@ -27,6 +28,7 @@
 #include "../boot/BootWimProcessor.h"
 #include "../models/ContentExtractor.h"
 #include "../models/HashVerifier.h"
+#include "../models/CoverageHasher.h"
 #include "../models/ISOReader.h"
 static bool     isValidPE(const std::string &path);
 static uint16_t getPEMachine(const std::string &path);
@@ -267,15 +269,27 @@ bool ISOCopyManager::extractISOContents(EventManager &eventManager, const std::s
     eventManager.notifyDetailedProgress(25, 100, LocalizedOrUtf8("log.iso.typeDetected", "Tipo de ISO detectado"));
     isWindowsISODetected = isWindowsISO;
 
-    // Calculate MD5 of the ISO
+    // Compare the ISO against ISOBOOTHASH: by fingerprint, or by full hash for records written before it existed
     std::string hashFilePath = destPath + "\\ISOBOOTHASH";
     bool        skipCopy     = hashVerifier->shouldSkipCopy(isoPath, hashFilePath, mode, format, injectDrivers);
+
+    std::future<std::string>        fullHash;
+    std::shared_ptr<CoverageHasher> contentHash;
     if (skipCopy) {
         logFile << getTimestamp()
                 << "ISO hash, version, mode, format and drivers flag match existing, skipping content copy"
                 << std::endl;
         eventManager.notifyLogUpdate(
             "Hash, version, modo, formato y drivers del ISO coinciden, omitiendo copia de contenido.\r\n");
+    } else {
+        // The content hash recorded in ISOBOOTHASH comes from the extraction's own reads of the image when
+        // it can, from a hashing pass running alongside otherwise
+        if (extractContent)
+            contentHash = hashVerifier->beginContentHash(isoPath);
+        if (contentHash)
+            isoReader->setContentHasher(contentHash);
+        else
+            fullHash = hashVerifier->calculateHashAsync(isoPath);
     }
 
     if (extractContent && !skipCopy) {
@@ -283,7 +297,37 @@ bool ISOCopyManager::extractISOContents(EventManager &eventManager, const std::s
         eventManager.notifyLogUpdate(LocalizedOrUtf8("log.iso.extractingContent", "Extrayendo contenido del ISO...") +
                                      "\r\n");
         std::vector<std::string> excludePatterns;
-        if (!isoReader->extractAll(isoPath, destPath, excludePatterns, &eventManager)) {
+        if (copyInstallWim && isWindowsISO) {
+            // install.wim/esd is extracted (and validated) on its own below; don't write it twice
+            excludePatterns = {"sources/install.wim", "sources/install.esd"};
+        }
+        // Against a partition that holds an earlier build, ISOMANIFEST limits the pass to what changed. The
+        // journal carries the boot mode, so ProcessService keeps an interrupted pass only for the same one.
+        // ISOBOOTHASH stops matching any image until the run completes: an interrupted pass leaves the
+        // target somewhere between the old build and the new one.
+        HashVerifier::invalidate(hashFilePath);
+        ISODeltaStats delta;
+        isoReader->setJournalLabel(mode);
+        const bool extractedAll = isoReader->extractDelta(isoPath, destPath, destPath + "\\ISOMANIFEST", true,
+                                                          excludePatterns, &eventManager, &delta);
+        isoReader->setJournalLabel({});
+        if (extractedAll) {
+            logFile << getTimestamp() << "ISO content: " << delta.written << " files written, " << delta.unchanged
+                    << " unchanged (" << (delta.bytesSkipped >> 20) << " MB), " << delta.removed << " removed"
+                    << std::endl;
+            if (delta.unchanged > 0) {
+                eventManager.notifyLogUpdate("Actualización incremental: " + std::to_string(delta.written) +
+                                             " archivos nuevos o modificados, " + std::to_string(delta.unchanged) +
+                                             " sin cambios, " + std::to_string(delta.removed) + " eliminados.\r\n");
+            }
+        }
+        ISOReadStats readStats;
+        if (isoReader->readStats(isoPath, readStats)) {
+            logFile << getTimestamp() << "ISO read-ahead: hits=" << readStats.hits << ", misses=" << readStats.misses
+                    << ", prefetched=" << (readStats.bytesPrefetched >> 20)
+                    << " MB, discarded=" << (readStats.bytesDiscarded >> 20) << " MB" << std::endl;
+        }
+        if (!extractedAll) {
             // If extraction fails for non-Windows ISOs, try copying the ISO file as fallback
             if (!isWindowsISO) {
                 logFile << getTimestamp() << "ISO extraction failed, trying fallback: copy ISO file" << std::endl;
@@ -300,6 +344,7 @@ bool ISOCopyManager::extractISOContents(EventManager &eventManager, const std::s
                     eventManager.notifyLogUpdate("La partición de destino no es accesible para escritura (error: " +
                                                  std::to_string(testError) + ")\r\n");
                     logFile.close();
+                    releaseIsoSessions();
                     return false;
                 }
                 CloseHandle(hTest);
@@ -317,10 +362,12 @@ bool ISOCopyManager::extractISOContents(EventManager &eventManager, const std::s
                     eventManager.notifyLogUpdate("Error al copiar archivo ISO (error: " + std::to_string(copyError) +
                                                  ")\r\n");
                     logFile.close();
+                    releaseIsoSessions();
                     return false;
                 }
             } else {
                 logFile.close();
+                releaseIsoSessions();
                 return false;
             }
         } else {
@@ -560,18 +607,44 @@ bool ISOCopyManager::extractISOContents(EventManager &eventManager, const std::s
     if (extractContent) {
         logFile << getTimestamp() << "Content extraction completed." << std::endl;
     }
+    if (contentHash) {
+        logFile << getTimestamp() << "ISO content hash: " << (contentHash->coveredBytes() >> 20) << " of "
+                << (contentHash->fileSize() >> 20) << " MB taken from extraction reads" << std::endl;
+    }
     logFile.close();
+    releaseIsoSessions();
 
     bool overallSuccess = efiSuccess && bootWimSuccess;
     if (overallSuccess) {
-        // Write the current ISO hash, mode, format and drivers flag to the file
-        hashVerifier->saveHashInfo(hashFilePath, Utils::calculateMD5(isoPath), mode, format, injectDrivers);
+        // Write the current ISO hash, fingerprint, mode, format and drivers flag to the file. A skipped copy
+        // keeps the content hash already recorded for this image, in the algorithm it was recorded with.
+        std::string   hash;
+        HashAlgorithm hashAlgorithm = hashVerifier->algorithm();
+        if (contentHash) {
+            hash = hashVerifier->finishContentHash(*contentHash);
+        } else if (fullHash.valid()) {
+            hash = fullHash.get();
+        } else {
+            HashInfo existing = HashVerifier::readHashInfo(hashFilePath);
+            if (HashVerifier::recordedAlgorithm(existing, hashAlgorithm))
+                hash = existing.hash;
+        }
+        hashVerifier->saveHashInfo(hashFilePath, hash, hashAlgorithm, hashVerifier->calculateFingerprint(isoPath),
+                                   mode, format, injectDrivers);
     }
 
     eventManager.notifyDetailedProgress(100, 100, "");
     return overallSuccess;
 }
 
+void ISOCopyManager::releaseIsoSessions() {
+    // Each reader keeps its ISO session open across calls; drop them so the image is not held between runs
+    bootWimProcessor.reset();
+    efiManager.reset();
+    isoReader->setContentHasher(nullptr);
+    isoReader->closeSession();
+}
+
 bool ISOCopyManager::copyISOFile(EventManager &eventManager, const std::string &isoPath, const std::string &destPath) {
     std::string logDir = Utils::getExeDirectory() + "logs";
     CreateDirectoryA(logDir.c_str(), NULL);
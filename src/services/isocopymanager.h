@@ -49,6 +49,7 @@ private:
     bool                              isWindowsISODetected;
 
     std::string exec(const char *cmd, EventManager *eventManager = nullptr);
+    void        releaseIsoSessions();
     long long   getDirectorySize(const std::string &path);
     void        listDirectoryRecursive(std::ofstream &log, const std::string &path, int depth, int maxDepth,
                                        EventManager &eventManager, long long &fileCount);
@@ -1,10 +1,10 @@
-﻿#include <mutex>
-#include <string>
+﻿#include <string>
 #include <fstream>
 #include <windows.h>
 #include "partitionmanager.h"
 #include "../utils/constants.h"
 #include "../utils/Utils.h"
+#include "../utils/Logger.h"
 #include "../utils/LocalizationManager.h"
 #include "../utils/LocalizationHelpers.h"
 
@@ -128,17 +128,9 @@ bool formatVolumeWithPowerShell(const std::string &volumeLabel, const std::strin
     return ran;
 }
 } // namespace
-// Helper to append and flush to general_log.log
+// Helper to append to general_log.log, in order with the Logger lines that share the file
 void logToGeneral(const std::string &msg) {
-    static std::mutex           logMutex;
-    std::lock_guard<std::mutex> lock(logMutex);
-    std::string                 logDir = Utils::getExeDirectory() + "logs";
-    CreateDirectoryA(logDir.c_str(), NULL);
-    std::ofstream logFile((logDir + "\\" + GENERAL_LOG_FILE).c_str(), std::ios::app);
-    if (logFile) {
-        logFile << msg << std::flush;
-        logFile.close();
-    }
+    Logger::instance().append(GENERAL_LOG_FILE, msg);
 }
 
 #include <sstream>
@@ -0,0 +1,251 @@
+#include "AsyncLogWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+size_t RingCapacity(size_t requested) {
+    size_t capacity = 2;
+    while (capacity < requested)
+        capacity <<= 1;
+    return capacity;
+}
+} // namespace
+
+AsyncLogWriter::AsyncLogWriter(const std::string &directory, size_t capacity, std::chrono::milliseconds flushInterval)
+    : capacity_(RingCapacity(capacity)), mask_(capacity_ - 1), slots_(new Slot[capacity_]), directory_(directory),
+      flushInterval_(flushInterval) {
+    for (size_t i = 0; i < capacity_; ++i)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    thread_ = std::thread(&AsyncLogWriter::run, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_one();
+    thread_.join();
+    flush();
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    closeFiles();
+}
+
+void AsyncLogWriter::append(const std::string &fileName, const std::string &message) {
+    append(fileName, message.data(), message.size());
+}
+
+void AsyncLogWriter::append(const std::string &fileName, const char *data, size_t size) {
+    if (size == 0)
+        return;
+    const size_t file = fileId(fileName);
+    if (file < kMaxFiles) {
+        enqueue(file, SlotKind::Data, data, size);
+        return;
+    }
+    // More distinct files than ids: written in place, after what is queued
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    drain();
+    writeBatches();
+    std::ofstream stream(std::filesystem::u8path(directory_) / fileName, std::ios::app | std::ios::binary);
+    stream.write(data, static_cast<std::streamsize>(size));
+}
+
+void AsyncLogWriter::truncate(const std::string &fileName) {
+    const size_t file = fileId(fileName);
+    if (file < kMaxFiles) {
+        enqueue(file, SlotKind::Truncate, nullptr, 0);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    drain();
+    writeBatches();
+    std::ofstream stream(std::filesystem::u8path(directory_) / fileName, std::ios::trunc | std::ios::binary);
+}
+
+void AsyncLogWriter::flush() {
+    const size_t target = tail_.load(std::memory_order_acquire);
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            drain();
+            writeBatches();
+            if (head_.load(std::memory_order_relaxed) - target < (static_cast<size_t>(-1) >> 1))
+                return;
+        }
+        // A producer claimed slots before target and has not filled them yet
+        std::this_thread::yield();
+    }
+}
+
+void AsyncLogWriter::flushNow() {
+    std::unique_lock<std::mutex> lock(drainMutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    drain();
+    writeBatches();
+}
+
+void AsyncLogWriter::setDirectory(const std::string &directory) {
+    flush();
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    closeFiles();
+    directory_        = directory;
+    directoryCreated_ = false;
+}
+
+std::string AsyncLogWriter::directory() const {
+    std::lock_guard<std::mutex> lock(drainMutex_);
+    return directory_;
+}
+
+size_t AsyncLogWriter::fileId(const std::string &fileName) {
+    size_t count = fileCount_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (*names_[i] == fileName)
+            return i;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    count = fileCount_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (*names_[i] == fileName)
+            return i;
+    }
+    if (count == kMaxFiles)
+        return kMaxFiles;
+    names_[count] = std::make_unique<std::string>(fileName);
+    fileCount_.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void AsyncLogWriter::enqueue(size_t file, SlotKind kind, const char *data, size_t size) {
+    const size_t maxClaim = capacity_ / 2;
+    do {
+        const size_t part  = (std::min)(size, maxClaim * kSlotPayload);
+        const size_t count = (std::max)(static_cast<size_t>(1), (part + kSlotPayload - 1) / kSlotPayload);
+
+        // Claim count consecutive slots. Slots are released by the writer thread in order, so the last
+        // one being free means all of them are.
+        size_t position = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            const size_t last  = position + count - 1;
+            const size_t seq   = slots_[last & mask_].sequence.load(std::memory_order_acquire);
+            const auto   delta = static_cast<std::ptrdiff_t>(seq - last);
+            if (delta == 0) {
+                if (tail_.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+                    break;
+            } else if (delta < 0) {
+                // Full: the writer thread has to catch up
+                wake();
+                std::this_thread::yield();
+                position = tail_.load(std::memory_order_relaxed);
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            Slot        &slot   = slots_[(position + i) & mask_];
+            const size_t offset = i * kSlotPayload;
+            const size_t length = (std::min)(kSlotPayload, part - (std::min)(part, offset));
+            slot.file           = static_cast<uint16_t>(file);
+            slot.kind           = kind;
+            slot.length         = static_cast<uint16_t>(length);
+            if (length != 0)
+                std::memcpy(slot.payload, data + offset, length);
+            slot.sequence.store(position + i + 1, std::memory_order_release);
+        }
+
+        if (position + count - head_.load(std::memory_order_relaxed) > capacity_ / 2)
+            wake();
+        data += part;
+        size -= part;
+    } while (size != 0);
+}
+
+void AsyncLogWriter::wake() {
+    if (wakeRequested_.exchange(true, std::memory_order_acq_rel))
+        return;
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    wakeCondition_.notify_one();
+}
+
+void AsyncLogWriter::run() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (!stopping_) {
+        wakeCondition_.wait_for(lock, flushInterval_,
+                                [this] { return stopping_ || wakeRequested_.load(std::memory_order_acquire); });
+        wakeRequested_.store(false, std::memory_order_release);
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> drainLock(drainMutex_);
+            drain();
+            writeBatches();
+        }
+        lock.lock();
+    }
+}
+
+void AsyncLogWriter::drain() {
+    for (size_t position = head_.load(std::memory_order_relaxed);; ++position) {
+        Slot &slot = slots_[position & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+            break;
+        OpenFile &open = files_[slot.file];
+        if (slot.kind == SlotKind::Truncate) {
+            // What was batched for the file would have been truncated away anyway
+            open.batch.clear();
+            openFile(slot.file, true);
+        } else {
+            if (open.batch.empty())
+                dirty_.push_back(slot.file);
+            open.batch.append(slot.payload, slot.length);
+        }
+        slot.sequence.store(position + capacity_, std::memory_order_release);
+        head_.store(position + 1, std::memory_order_release);
+    }
+}
+
+void AsyncLogWriter::writeBatches() {
+    for (size_t file : dirty_) {
+        OpenFile &open = files_[file];
+        if (open.batch.empty())
+            continue;
+        if (open.opened || openFile(file, false)) {
+            open.stream.write(open.batch.data(), static_cast<std::streamsize>(open.batch.size()));
+            open.stream.flush();
+        }
+        open.batch.clear();
+    }
+    dirty_.clear();
+}
+
+void AsyncLogWriter::closeFiles() {
+    for (OpenFile &open : files_) {
+        if (open.opened)
+            open.stream.close();
+        open.opened = false;
+    }
+}
+
+bool AsyncLogWriter::openFile(size_t file, bool truncate) {
+    if (!directoryCreated_) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::u8path(directory_), ec);
+        directoryCreated_ = true;
+    }
+    OpenFile                   &open = files_[file];
+    const std::filesystem::path path = std::filesystem::u8path(directory_) / *names_[file];
+    if (open.opened)
+        open.stream.close();
+    if (truncate)
+        std::ofstream(path, std::ios::trunc | std::ios::binary);
+    // Opened to append so every write lands at the end of the file, whatever its size when opened
+    open.stream.clear();
+    open.stream.open(path, std::ios::app | std::ios::binary);
+    open.opened = open.stream.is_open();
+    return open.opened;
+}
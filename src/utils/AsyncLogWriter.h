@@ -0,0 +1,109 @@
+#ifndef ASYNCLOGWRITER_H
+#define ASYNCLOGWRITER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Appends to log files from any number of threads without taking a lock or touching the file on the
+// caller's thread: a message is copied into a bounded ring of fixed-size slots and a background thread
+// writes what has queued up, one batch per file, through handles kept open for the writer's lifetime.
+// The batch goes out every flushInterval, as soon as the ring is half full, and on flush() or destruction.
+// A message that fits in capacity / 2 slots reaches its file in one piece; longer ones are queued in parts
+// and may interleave with messages to the same file from other threads.
+class AsyncLogWriter {
+public:
+    static constexpr size_t                    kDefaultCapacity = 4096; // slots, a power of two
+    static constexpr size_t                    kSlotSize        = 256;
+    static constexpr size_t                    kMaxFiles        = 64;
+    static constexpr std::chrono::milliseconds kDefaultFlushInterval{200};
+
+    // capacity is rounded up to a power of two, at least 2. directory is created on the first write.
+    explicit AsyncLogWriter(const std::string &directory, size_t capacity = kDefaultCapacity,
+                            std::chrono::milliseconds flushInterval = kDefaultFlushInterval);
+    ~AsyncLogWriter();
+    AsyncLogWriter(const AsyncLogWriter &)            = delete;
+    AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+    void append(const std::string &fileName, const std::string &message);
+    void append(const std::string &fileName, const char *data, size_t size);
+
+    // Empties fileName, after whatever was appended to it before
+    void truncate(const std::string &fileName);
+
+    // Returns once everything queued before the call is written and flushed to disk
+    void flush();
+
+    // Writes what is queued from the calling thread, without waiting for anything: for a crash handler,
+    // where the writer thread or a half-published message may never make progress again. Does nothing
+    // if a write is already under way.
+    void flushNow();
+
+    // Finishes what is queued in the current directory, then writes to files in directory
+    void        setDirectory(const std::string &directory);
+    std::string directory() const;
+
+private:
+    enum class SlotKind : uint8_t { Data, Truncate };
+
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence;
+        uint16_t            file;
+        uint16_t            length;
+        SlotKind            kind;
+        char                payload[kSlotSize - sizeof(std::atomic<size_t>) - 8];
+    };
+    static constexpr size_t kSlotPayload = sizeof(Slot::payload);
+
+    struct OpenFile {
+        std::ofstream stream;
+        std::string   batch;
+        bool          opened = false;
+    };
+
+    size_t fileId(const std::string &fileName);
+    void   enqueue(size_t file, SlotKind kind, const char *data, size_t size);
+    void   wake();
+    void   run();
+
+    // Consumer side: called with drainMutex_ held
+    void drain();
+    void writeBatches();
+    void closeFiles();
+    bool openFile(size_t file, bool truncate);
+
+    const size_t                    capacity_;
+    const size_t                    mask_;
+    std::unique_ptr<Slot[]>         slots_;
+    alignas(64) std::atomic<size_t> tail_{0}; // next slot producers claim
+    alignas(64) std::atomic<size_t> head_{0}; // next slot the consumer reads
+
+    // File names by id; entries below fileCount_ never change once published
+    std::array<std::unique_ptr<std::string>, kMaxFiles> names_;
+    std::atomic<size_t>                                 fileCount_{0};
+    std::mutex                                          registryMutex_;
+
+    mutable std::mutex              drainMutex_;
+    std::string                     directory_;
+    bool                            directoryCreated_ = false;
+    std::array<OpenFile, kMaxFiles> files_;
+    std::vector<size_t>             dirty_; // files with a batch to write
+
+    const std::chrono::milliseconds flushInterval_;
+    std::mutex                      wakeMutex_;
+    std::condition_variable         wakeCondition_;
+    std::atomic<bool>               wakeRequested_{false};
+    bool                            stopping_ = false;
+    std::thread                     thread_;
+};
+
+#endif // ASYNCLOGWRITER_H
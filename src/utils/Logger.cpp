@@ -4,8 +4,6 @@
 #include "constants.h"
 
 #include <filesystem>
-#include <fstream>
-#include <iostream>
 
 namespace {
 std::vector<std::string> defaultProcessLogs() {
@@ -22,35 +20,42 @@ Logger &Logger::instance() {
     return logger;
 }
 
+Logger::Logger() : writer(Utils::getExeDirectory() + "logs") {}
+
 void Logger::setBaseDirectory(const std::string &directory) {
     std::lock_guard<std::mutex> guard(directoryMutex);
-    baseDirectory    = directory;
-    directoryCreated = false;
+    baseDirectory = directory;
+    directoryCreated.store(false, std::memory_order_release);
 }
 
 void Logger::append(const std::string &fileName, const std::string &message) {
-    ensureDirectory();
-    std::lock_guard<std::mutex> guard(writeMutex);
-    const std::filesystem::path path = std::filesystem::u8path(baseDirectory) / fileName;
-    std::ofstream               logFile(path, std::ios::app | std::ios::binary);
-    if (logFile) {
-        logFile << message;
+    // Only the first call after a directory change takes the lock; the rest is a copy into the ring
+    if (!directoryCreated.load(std::memory_order_acquire)) {
+        ensureDirectory();
     }
+    writer.append(fileName, message);
 }
 
 void Logger::resetLogs(const std::vector<std::string> &fileNames) {
     ensureDirectory();
-    std::lock_guard<std::mutex> guard(writeMutex);
     for (const auto &file : fileNames) {
-        const std::filesystem::path path = std::filesystem::u8path(baseDirectory) / file;
-        std::ofstream               ofs(path, std::ios::trunc | std::ios::binary);
+        writer.truncate(file);
     }
+    writer.flush();
 }
 
 void Logger::resetProcessLogs() {
     resetLogs(defaultProcessLogs());
 }
 
+void Logger::flush() {
+    writer.flush();
+}
+
+void Logger::flushOnCrash() {
+    writer.flushNow();
+}
+
 std::string Logger::logDirectory() const {
     std::lock_guard<std::mutex> guard(directoryMutex);
     if (baseDirectory.empty()) {
@@ -64,8 +69,11 @@ void Logger::ensureDirectory() {
     if (baseDirectory.empty()) {
         baseDirectory = Utils::getExeDirectory() + "logs";
     }
-    if (!directoryCreated) {
+    if (!directoryCreated.load(std::memory_order_relaxed)) {
         std::filesystem::create_directories(std::filesystem::u8path(baseDirectory));
-        directoryCreated = true;
+        if (writer.directory() != baseDirectory) {
+            writer.setDirectory(baseDirectory);
+        }
+        directoryCreated.store(true, std::memory_order_release);
     }
 }
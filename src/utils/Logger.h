@@ -1,6 +1,9 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include "AsyncLogWriter.h"
+
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -9,14 +12,25 @@ class Logger {
 public:
     static Logger &instance();
 
-    void        setBaseDirectory(const std::string &directory);
-    void        append(const std::string &fileName, const std::string &message);
-    void        resetLogs(const std::vector<std::string> &fileNames);
-    void        resetProcessLogs();
+    void setBaseDirectory(const std::string &directory);
+
+    // Queues message for fileName; it reaches the file within AsyncLogWriter::kDefaultFlushInterval
+    void append(const std::string &fileName, const std::string &message);
+
+    // The files are empty when these return
+    void resetLogs(const std::vector<std::string> &fileNames);
+    void resetProcessLogs();
+
+    // Writes everything appended so far
+    void flush();
+
+    // What can still be written from a crash handler; see AsyncLogWriter::flushNow
+    void flushOnCrash();
+
     std::string logDirectory() const;
 
 private:
-    Logger()                          = default;
+    Logger();
     ~Logger()                         = default;
     Logger(const Logger &)            = delete;
     Logger &operator=(const Logger &) = delete;
@@ -24,9 +38,9 @@ private:
     void ensureDirectory();
 
     mutable std::mutex directoryMutex;
-    std::mutex         writeMutex;
     std::string        baseDirectory;
-    bool               directoryCreated{false};
+    std::atomic<bool>  directoryCreated{false};
+    AsyncLogWriter     writer;
 };
 
 #endif // LOGGER_H
@@ -0,0 +1,95 @@
+#include "PatternMatcher.h"
+
+#include <algorithm>
+
+namespace {
+constexpr uint32_t kNoNode = 0xFFFFFFFFu;
+}
+
+PatternMatcher::PatternMatcher(const std::vector<std::string> &patterns) {
+    for (const auto &pattern : patterns) {
+        add(pattern);
+    }
+}
+
+void PatternMatcher::add(const std::string &pattern) {
+    const size_t wildcard = pattern.find_first_of("*?");
+    const size_t literal  = wildcard == std::string::npos ? pattern.size() : wildcard;
+
+    uint32_t node = 0;
+    for (size_t i = 0; i < literal; ++i) {
+        const char c    = pattern[i];
+        uint32_t   next = child(node, c);
+        if (next == kNoNode) {
+            next = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+            auto &children = nodes_[node].children;
+            auto  pos      = std::lower_bound(children.begin(), children.end(), c,
+                                              [](const std::pair<char, uint32_t> &a, char b) { return a.first < b; });
+            children.insert(pos, {c, next});
+        }
+        node = next;
+    }
+
+    if (wildcard == std::string::npos) {
+        nodes_[node].terminal = true;
+    } else {
+        nodes_[node].tails.push_back(static_cast<uint32_t>(tails_.size()));
+        tails_.push_back(pattern.substr(wildcard));
+    }
+}
+
+bool PatternMatcher::empty() const {
+    return nodes_.size() == 1 && !nodes_[0].terminal && nodes_[0].tails.empty();
+}
+
+bool PatternMatcher::matches(const std::string &text) const {
+    uint32_t node = 0;
+    for (size_t pos = 0;; ++pos) {
+        const Node &current = nodes_[node];
+        for (uint32_t tail : current.tails) {
+            if (matchTail(text.data() + pos, text.size() - pos, tails_[tail]))
+                return true;
+        }
+        if (pos == text.size())
+            return current.terminal;
+        node = child(node, text[pos]);
+        if (node == kNoNode)
+            return false;
+    }
+}
+
+uint32_t PatternMatcher::child(uint32_t node, char c) const {
+    const auto &children = nodes_[node].children;
+    auto        pos      = std::lower_bound(children.begin(), children.end(), c,
+                                            [](const std::pair<char, uint32_t> &a, char b) { return a.first < b; });
+    return pos != children.end() && pos->first == c ? pos->second : kNoNode;
+}
+
+bool PatternMatcher::matchTail(const char *text, size_t length, const std::string &tail) {
+    // Same backtracking scan as Utils::matchesPattern, over a suffix of the text
+    size_t textPos = 0, tailPos = 0;
+    size_t tailLen = tail.length();
+    size_t starPos = std::string::npos, textStarPos = std::string::npos;
+
+    while (textPos < length) {
+        if (tailPos < tailLen && (tail[tailPos] == text[textPos] || tail[tailPos] == '?')) {
+            ++textPos;
+            ++tailPos;
+        } else if (tailPos < tailLen && tail[tailPos] == '*') {
+            starPos     = tailPos++;
+            textStarPos = textPos;
+        } else if (starPos != std::string::npos) {
+            tailPos = starPos + 1;
+            textPos = ++textStarPos;
+        } else {
+            return false;
+        }
+    }
+
+    while (tailPos < tailLen && tail[tailPos] == '*') {
+        ++tailPos;
+    }
+
+    return tailPos == tailLen;
+}
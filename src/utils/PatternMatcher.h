@@ -0,0 +1,37 @@
+#ifndef PATTERNMATCHER_H
+#define PATTERNMATCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A set of wildcard patterns compiled for repeated evaluation. Semantics are those of
+// Utils::matchesPattern ('*' matches any sequence, '?' any single character, everything else literally,
+// whole-string match). The literal prefix of every pattern goes into a shared trie, so a lookup walks the
+// text once and only runs the wildcard tail of the patterns whose prefix actually matched.
+class PatternMatcher {
+public:
+    PatternMatcher() = default;
+    explicit PatternMatcher(const std::vector<std::string> &patterns);
+
+    void add(const std::string &pattern);
+    bool empty() const;
+
+    // True if text matches any of the patterns
+    bool matches(const std::string &text) const;
+
+private:
+    struct Node {
+        std::vector<std::pair<char, uint32_t>> children; // sorted by character
+        std::vector<uint32_t>                  tails;    // indices into tails_ of patterns whose prefix ends here
+        bool                                   terminal = false; // a fully literal pattern ends here
+    };
+
+    uint32_t    child(uint32_t node, char c) const;
+    static bool matchTail(const char *text, size_t length, const std::string &tail);
+
+    std::vector<Node>        nodes_ = std::vector<Node>(1);
+    std::vector<std::string> tails_;
+};
+
+#endif // PATTERNMATCHER_H
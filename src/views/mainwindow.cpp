@@ -755,13 +755,7 @@ void MainWindow::UpdateDiskSpaceInfo() {
                            " GB, ISOBOOT exists: " + (partitionExists ? "yes" : "no") +
                            ", ISOEFI exists: " + (efiPartitionExists ? "yes" : "no");
 
-    std::string logDir = Utils::getExeDirectory() + "logs";
-    CreateDirectoryA(logDir.c_str(), NULL);
-    std::ofstream logFile((logDir + "\\" + GENERAL_LOG_FILE).c_str(), std::ios::app);
-    if (logFile) {
-        logFile << debugMsg << std::endl;
-        logFile.close();
-    }
+    Logger::instance().append(GENERAL_LOG_FILE, debugMsg + "\r\n");
 
     std::wstring        yesText      = LocalizedOrW("common.yes", L"Si");
     std::wstring        noText       = LocalizedOrW("common.no", L"No");
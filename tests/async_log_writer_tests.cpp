@@ -0,0 +1,120 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/AsyncLogWriter.h"
+
+namespace {
+std::string ReadAll(const std::filesystem::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::vector<std::string> Lines(const std::string &text) {
+    std::vector<std::string> lines;
+    std::istringstream       in(text);
+    for (std::string line; std::getline(in, line);)
+        lines.push_back(line);
+    return lines;
+}
+
+std::string Line(int producer, int index) {
+    // Lengths vary so lines straddle slot boundaries
+    return "p" + std::to_string(producer) + " n" + std::to_string(index) + " " +
+           std::string(static_cast<size_t>(index % 300), 'x');
+}
+} // namespace
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "async_log_writer_tests";
+    std::filesystem::remove_all(dir);
+
+    // Several producers on a small ring, so it wraps and fills many times over: every line arrives whole,
+    // and each producer's lines in the order it wrote them
+    {
+        constexpr int kProducers = 4;
+        constexpr int kLines     = 2000;
+        {
+            AsyncLogWriter           writer(dir.string(), 16, std::chrono::milliseconds(5));
+            std::vector<std::thread> producers;
+            for (int p = 0; p < kProducers; ++p) {
+                producers.emplace_back([&writer, p]() {
+                    for (int i = 0; i < kLines; ++i)
+                        writer.append("shared.log", Line(p, i) + "\n");
+                });
+            }
+            for (auto &producer : producers)
+                producer.join();
+        } // the destructor writes what is left
+
+        const std::vector<std::string> lines = Lines(ReadAll(dir / "shared.log"));
+        assert(lines.size() == static_cast<size_t>(kProducers * kLines));
+        std::vector<int> next(kProducers, 0);
+        for (const auto &line : lines) {
+            const int producer = line[1] - '0';
+            assert(producer >= 0 && producer < kProducers);
+            assert(line == Line(producer, next[producer]));
+            ++next[producer];
+        }
+    }
+
+    // flush() puts everything on disk; truncate() empties the file in order with the appends around it
+    {
+        AsyncLogWriter writer(dir.string(), 64, std::chrono::hours(1));
+        writer.append("a.log", "first\n");
+        writer.append("b.log", "other\n");
+        writer.flush();
+        assert(ReadAll(dir / "a.log") == "first\n");
+        assert(ReadAll(dir / "b.log") == "other\n");
+
+        writer.append("a.log", "dropped\n");
+        writer.truncate("a.log");
+        writer.append("a.log", "second\n");
+        writer.flush();
+        assert(ReadAll(dir / "a.log") == "second\n");
+        assert(ReadAll(dir / "b.log") == "other\n");
+
+        // Other handles appending to the same file are not overwritten
+        {
+            std::ofstream other(dir / "a.log", std::ios::app | std::ios::binary);
+            other << "outside\n";
+        }
+        writer.append("a.log", "third\n");
+        writer.flush();
+        assert(ReadAll(dir / "a.log") == "second\noutside\nthird\n");
+    }
+
+    // A message longer than the whole ring is queued in parts and still arrives complete
+    {
+        std::string big;
+        for (int i = 0; big.size() < 20000; ++i)
+            big += std::to_string(i) + ",";
+        AsyncLogWriter writer(dir.string(), 8, std::chrono::milliseconds(5));
+        writer.append("big.log", big);
+        writer.flush();
+        assert(ReadAll(dir / "big.log") == big);
+    }
+
+    // A new directory is created on the first write, and earlier lines stay in the old one
+    {
+        const std::filesystem::path moved = dir / "moved";
+        AsyncLogWriter              writer(dir.string(), 64, std::chrono::hours(1));
+        writer.truncate("c.log");
+        writer.append("c.log", "before\n");
+        writer.setDirectory(moved.string());
+        writer.append("c.log", "after\n");
+        writer.flush();
+        assert(ReadAll(dir / "c.log") == "before\n");
+        assert(ReadAll(moved / "c.log") == "after\n");
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
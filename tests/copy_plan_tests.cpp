@@ -0,0 +1,61 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <string>
+
+#include "../src/models/CopyPlan.h"
+
+namespace {
+constexpr unsigned long long kMB = 1024ull * 1024;
+constexpr unsigned long long kGB = 1024 * kMB;
+} // namespace
+
+int main() {
+    // format.com defaults, including the ~10 GB ISOBOOT partition
+    assert(CopyPlan::defaultClusterSize("FAT32", 10000 * kMB) == 8192);
+    assert(CopyPlan::defaultClusterSize("fat32", 4 * kGB) == 4096);
+    assert(CopyPlan::defaultClusterSize("FAT32", 500 * kMB) == 4096);
+    assert(CopyPlan::defaultClusterSize("FAT32", 100 * kMB) == 1024);
+    assert(CopyPlan::defaultClusterSize("FAT32", 64 * kGB) == 32768);
+    assert(CopyPlan::defaultClusterSize("EXFAT", 10000 * kMB) == 32768);
+    assert(CopyPlan::defaultClusterSize("exFAT", 200 * kMB) == 4096);
+    assert(CopyPlan::defaultClusterSize("exfat", 1024 * kGB) == 131072);
+    assert(CopyPlan::defaultClusterSize("NTFS", 10000 * kMB) == 4096);
+    assert(CopyPlan::defaultClusterSize("ntfs", 20 * 1024 * kGB) == 8192);
+    assert(CopyPlan::defaultClusterSize("NTFS", 0) == CopyPlan::kDefaultClusterSize);
+    assert(CopyPlan::defaultClusterSize("FAT", 10000 * kMB) == CopyPlan::kDefaultClusterSize);
+    assert(CopyPlan::defaultClusterSize("FAT32X", 10000 * kMB) == CopyPlan::kDefaultClusterSize);
+
+    assert(CopyPlan::allocatedSize(0, 4096) == 0);
+    assert(CopyPlan::allocatedSize(1, 4096) == 4096);
+    assert(CopyPlan::allocatedSize(4096, 4096) == 4096);
+    assert(CopyPlan::allocatedSize(4097, 32768) == 32768);
+    assert(CopyPlan::allocatedSize(100, 0) == 100);
+
+    // Small files cost far more on a large-cluster volume than their data suggests
+    CopyPlan plan("X:", "Z:\\", 32768);
+    assert(plan.clusterSize() == 32768);
+    plan.addFile("X:\\bootmgr", "Z:\\bootmgr", CopyPlan::kNoDir, 400 * 1024, 0x21, 1234);
+    const size_t boot  = plan.addDirectory("Z:\\boot");
+    const size_t fonts = plan.addDirectory("Z:\\boot\\fonts");
+    assert(boot == 0 && fonts == 1);
+    for (int i = 0; i < 10; ++i) {
+        const std::string name = "\\boot\\fonts\\f" + std::to_string(i);
+        plan.addFile("X:" + name, "Z:" + name, fonts, 100, 0, 0);
+    }
+    plan.addFile("X:\\boot\\empty", "Z:\\boot\\empty", boot, 0, 0, 0);
+
+    assert(plan.source() == "X:" && plan.dest() == "Z:\\");
+    assert(plan.dirs().size() == 2 && plan.dirs()[1] == "Z:\\boot\\fonts");
+    assert(plan.files().size() == 12);
+    assert(plan.files()[0].dir == CopyPlan::kNoDir && plan.files()[0].attributes == 0x21);
+    assert(plan.files()[0].writeTime == 1234 && plan.files()[0].allocated == 13 * 32768);
+    assert(plan.totalBytes() == 400 * 1024 + 10 * 100);
+    assert(plan.allocatedBytes() == 13 * 32768 + 10 * 32768 + 2 * 32768);
+
+    // No cluster size: the default
+    CopyPlan fallback("a", "b", 0);
+    assert(fallback.clusterSize() == CopyPlan::kDefaultClusterSize);
+    assert(fallback.totalBytes() == 0 && fallback.allocatedBytes() == 0);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../src/models/CoverageHasher.h"
+
+namespace {
+constexpr size_t kChunk = StreamHasher::kTreeChunkSize;
+
+// Pieces of [begin, end) in shuffled order, each a few KB to a bit over a chunk long
+std::vector<std::pair<size_t, size_t>> ShuffledPieces(size_t begin, size_t end, unsigned seed) {
+    std::mt19937                           random(seed);
+    std::vector<std::pair<size_t, size_t>> pieces;
+    for (size_t offset = begin; offset < end;) {
+        const size_t length = (std::min)(end - offset, static_cast<size_t>(random() % (kChunk + kChunk / 4)) + 1);
+        pieces.emplace_back(offset, length);
+        offset += length;
+    }
+    std::shuffle(pieces.begin(), pieces.end(), random);
+    return pieces;
+}
+
+void Feed(CoverageHasher &hasher, const std::string &data, const std::vector<std::pair<size_t, size_t>> &pieces) {
+    for (const auto &piece : pieces)
+        hasher.add(piece.first, data.data() + piece.first, piece.second);
+}
+} // namespace
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "coverage_hasher_tests";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string path = (dir / "image.bin").string();
+
+    // Not a whole number of chunks, so the last leaf is short
+    std::string data(9 * kChunk + 12345, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 31 + i / 7919);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    const std::string expected = FileHasher::hashFile(path, HashAlgorithm::BLAKE2SP_TREE);
+    assert(expected.size() == 64);
+
+    // Everything read, out of order, from two threads, with overlapping re-reads
+    {
+        CoverageHasher hasher(path);
+        assert(hasher.fileSize() == data.size());
+        const auto  first  = ShuffledPieces(0, data.size(), 1);
+        const auto  second = ShuffledPieces(kChunk / 3, data.size() / 2, 2);
+        std::thread other([&]() { Feed(hasher, data, second); });
+        Feed(hasher, data, first);
+        other.join();
+        assert(hasher.coveredBytes() == data.size());
+        assert(hasher.finish() == expected);
+    }
+
+    // Gaps (unread ranges, whole chunks never touched) are read by finish()
+    {
+        CoverageHasher hasher(path);
+        auto           pieces = ShuffledPieces(0, data.size(), 3);
+        pieces.erase(std::remove_if(pieces.begin(), pieces.end(),
+                                    [](const std::pair<size_t, size_t> &piece) {
+                                        return piece.first / kChunk == 4 || piece.first % 3 == 0;
+                                    }),
+                     pieces.end());
+        Feed(hasher, data, pieces);
+        assert(hasher.coveredBytes() < data.size());
+        assert(hasher.finish() == expected);
+    }
+
+    // Partly read chunks evicted past the pending limit are reread whole
+    {
+        CoverageHasher hasher(path, 2);
+        auto           pieces = ShuffledPieces(0, data.size(), 4);
+        Feed(hasher, data, pieces);
+        assert(hasher.finish() == expected);
+    }
+
+    // Nothing read at all, and reads past the end are ignored
+    {
+        CoverageHasher hasher(path);
+        hasher.add(data.size(), data.data(), 16);
+        assert(hasher.coveredBytes() == 0);
+        assert(hasher.finish() == expected);
+    }
+
+    assert(CoverageHasher((dir / "missing.bin").string()).finish().empty());
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
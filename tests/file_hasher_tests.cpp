@@ -0,0 +1,123 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/models/FileHasher.h"
+#include "Blake2.h"
+
+namespace {
+std::string HashString(HashAlgorithm algorithm, const std::string &text) {
+    StreamHasher hasher(algorithm);
+    hasher.update(text.data(), text.size());
+    return hasher.finish();
+}
+} // namespace
+
+int main() {
+    // Reference vectors (RFC 1321, FIPS 180-2)
+    assert(HashString(HashAlgorithm::MD5, "") == "d41d8cd98f00b204e9800998ecf8427e");
+    assert(HashString(HashAlgorithm::MD5, "abc") == "900150983cd24fb0d6963f7d28e17f72");
+    assert(HashString(HashAlgorithm::MD5, "12345678901234567890123456789012345678901234567890123456789012345678901234"
+                                          "567890") == "57edf4a22be3c955ac49da2e2107b67a");
+    assert(HashString(HashAlgorithm::SHA1, "abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    assert(HashString(HashAlgorithm::SHA256, "abc") ==
+           "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    assert(HashString(HashAlgorithm::SHA256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // Feeding the data in uneven pieces gives the same digest as one update
+    std::string data(1000000, 'a');
+    for (HashAlgorithm algorithm :
+         {HashAlgorithm::MD5, HashAlgorithm::SHA1, HashAlgorithm::SHA256, HashAlgorithm::BLAKE2SP_TREE}) {
+        StreamHasher hasher(algorithm);
+        for (size_t offset = 0, piece = 1; offset < data.size(); offset += piece, piece = piece * 3 % 1021 + 1)
+            hasher.update(data.data() + offset, std::min(piece, data.size() - offset));
+        assert(hasher.finish() == HashString(algorithm, data));
+    }
+    assert(HashString(HashAlgorithm::MD5, data) == "7707d6ae4e027c70eea2a935c2296f21");
+    assert(HashString(HashAlgorithm::SHA256, data) ==
+           "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    HashAlgorithm parsed = HashAlgorithm::MD5;
+    assert(StreamHasher::parse("sha256", parsed) && parsed == HashAlgorithm::SHA256);
+    assert(StreamHasher::parse("blake2sp-tree", parsed) && parsed == HashAlgorithm::BLAKE2SP_TREE);
+    assert(!StreamHasher::parse("crc32", parsed));
+
+    // Files larger than the read buffer go through the reader thread; the result must not depend on it
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "file_hasher_tests.bin";
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 7 + i / 4096);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    unsigned long long lastProgress = 0;
+    const std::string  threaded      = FileHasher::hashFile(path.string(), HashAlgorithm::SHA256,
+                                                            [&](unsigned long long done, unsigned long long total) {
+                                                          assert(done > lastProgress && total == data.size());
+                                                          lastProgress = done;
+                                                      },
+                                                            64 * 1024 + 3);
+    assert(threaded == HashString(HashAlgorithm::SHA256, data));
+    assert(lastProgress == data.size());
+    assert(FileHasher::hashFile(path.string(), HashAlgorithm::MD5) == HashString(HashAlgorithm::MD5, data));
+
+    // BLAKE2SP_TREE, rebuilt from its definition: BLAKE2sp per chunk, then BLAKE2sp over the leaves and length
+    const size_t chunk = StreamHasher::kTreeChunkSize;
+    std::string  tree(chunk * 5 / 2, '\0');
+    for (size_t i = 0; i < tree.size(); ++i)
+        tree[i] = static_cast<char>(i * 13 + i / 1000);
+    CBlake2sp root;
+    Blake2sp_Init(&root);
+    for (size_t offset = 0; offset < tree.size(); offset += chunk) {
+        CBlake2sp leaf;
+        Byte      digest[BLAKE2S_DIGEST_SIZE];
+        Blake2sp_Init(&leaf);
+        Blake2sp_Update(&leaf, reinterpret_cast<const Byte *>(tree.data()) + offset,
+                        std::min(chunk, tree.size() - offset));
+        Blake2sp_Final(&leaf, digest);
+        Blake2sp_Update(&root, digest, sizeof(digest));
+    }
+    Byte length[8];
+    for (int i = 0; i < 8; ++i)
+        length[i] = static_cast<Byte>(static_cast<unsigned long long>(tree.size()) >> (8 * i));
+    Blake2sp_Update(&root, length, sizeof(length));
+    Byte rootDigest[BLAKE2S_DIGEST_SIZE];
+    Blake2sp_Final(&root, rootDigest);
+    std::string expected;
+    for (Byte b : rootDigest) {
+        expected += "0123456789abcdef"[b >> 4];
+        expected += "0123456789abcdef"[b & 0xf];
+    }
+    assert(HashString(HashAlgorithm::BLAKE2SP_TREE, tree) == expected);
+
+    // The parallel file path gives the streaming digest at and around chunk boundaries
+    const size_t sizes[] = {0, 1, chunk, chunk + 1, tree.size()};
+    for (size_t size : sizes) {
+        const std::string prefix = tree.substr(0, size);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+        }
+        unsigned long long reported = 0;
+        const std::string  digest   = FileHasher::hashFile(path.string(), HashAlgorithm::BLAKE2SP_TREE,
+                                                           [&](unsigned long long done, unsigned long long total) {
+                                                            assert(done >= reported && done <= total && total == size);
+                                                            reported = done;
+                                                        });
+        assert(digest == HashString(HashAlgorithm::BLAKE2SP_TREE, prefix));
+        assert(reported == size);
+    }
+    assert(HashString(HashAlgorithm::BLAKE2SP_TREE, "") !=
+           HashString(HashAlgorithm::BLAKE2SP_TREE, std::string(1, '\0')));
+    std::filesystem::remove(path);
+
+    assert(FileHasher::hashFile(path.string(), HashAlgorithm::MD5).empty());
+    assert(FileHasher::hashFile(path.string(), HashAlgorithm::BLAKE2SP_TREE).empty());
+    return 0;
+}
@@ -0,0 +1,95 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../src/models/HashMemo.h"
+
+namespace {
+void WriteFile(const std::filesystem::path &path, const std::string &contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+} // namespace
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "hash_memo_tests";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string imagePath = (dir / "image.iso").string();
+    const std::string storePath = (dir / "store" / "hash_memo.txt").string();
+
+    WriteFile(imagePath, "first build");
+    FileIdentity identity;
+    assert(HashMemo::identify(imagePath, identity));
+    assert(identity.fileSize == 11);
+
+    const std::string digest = FileHasher::hashFile(imagePath, HashAlgorithm::MD5);
+    {
+        HashMemo memo(storePath);
+        assert(memo.lookup(identity, HashAlgorithm::MD5).empty());
+        assert(memo.hashFile(imagePath, HashAlgorithm::MD5) == digest);
+        assert(memo.lookup(identity, HashAlgorithm::MD5) == digest);
+        // Keyed by algorithm too: an MD5 never answers for SHA-256
+        assert(memo.lookup(identity, HashAlgorithm::SHA256).empty());
+    }
+
+    // A new instance (the next run) finds the digest in the persisted store
+    {
+        HashMemo memo(storePath);
+        assert(memo.lookup(identity, HashAlgorithm::MD5) == digest);
+
+        // Every identity field is part of the key
+        FileIdentity other = identity;
+        other.lastWriteTime += 1;
+        assert(memo.lookup(other, HashAlgorithm::MD5).empty());
+        other = identity;
+        other.fileSize += 1;
+        assert(memo.lookup(other, HashAlgorithm::MD5).empty());
+        other = identity;
+        other.fileIdLow += 1;
+        assert(memo.lookup(other, HashAlgorithm::MD5).empty());
+        other = identity;
+        other.volumeSerial += 1;
+        assert(memo.lookup(other, HashAlgorithm::MD5).empty());
+
+        // The cached digest is returned as is: proof the file was not read again
+        memo.remember(identity, HashAlgorithm::SHA1, "0123abcd");
+        assert(memo.hashFile(imagePath, HashAlgorithm::SHA1) == "0123abcd");
+    }
+
+    // Rewriting the file changes its identity, so the old digest is not used and gets replaced
+    WriteFile(imagePath, "second build, longer");
+    FileIdentity rewritten;
+    assert(HashMemo::identify(imagePath, rewritten));
+    assert(rewritten != identity);
+    {
+        HashMemo          memo(storePath);
+        const std::string fresh = memo.hashFile(imagePath, HashAlgorithm::MD5);
+        assert(fresh == FileHasher::hashFile(imagePath, HashAlgorithm::MD5) && fresh != digest);
+        assert(memo.lookup(identity, HashAlgorithm::MD5).empty());
+        assert(memo.lookup(rewritten, HashAlgorithm::MD5) == fresh);
+    }
+
+    // A damaged store is ignored, not trusted
+    WriteFile(storePath, "BTHASHMEMO 1\nmd5 1 2 3 4 5 not-hex\nsha9 1 2 3 4 5 abcd\n");
+    {
+        HashMemo memo(storePath);
+        assert(memo.lookup(rewritten, HashAlgorithm::MD5).empty());
+        FileIdentity junk;
+        junk.volumeSerial  = 1;
+        junk.fileIdHigh    = 2;
+        junk.fileIdLow     = 3;
+        junk.fileSize      = 4;
+        junk.lastWriteTime = 5;
+        assert(memo.lookup(junk, HashAlgorithm::MD5).empty());
+    }
+
+    FileIdentity missing;
+    assert(!HashMemo::identify((dir / "missing.iso").string(), missing));
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,74 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "../src/models/ISOCatalog.h"
+
+int main() {
+    ISOCatalog catalog;
+    catalog.add("sources\\boot.wim", 500, false, 3);
+    catalog.add("efi", 0, true, 0);
+    catalog.add("EFI\\Boot\\bootx64.efi", 1024, false, 1);
+    catalog.add("efi\\boot", 0, true, 2);
+    catalog.add("setup.exe", 77, false, 4);
+
+    // Case-insensitive lookup with either separator
+    const uint32_t wim = catalog.find("SOURCES/Boot.WIM");
+    assert(wim != ISOCatalog::kNone);
+    assert(catalog.entry(wim).size == 500);
+    assert(catalog.entry(wim).archiveIndex == 3);
+    assert(catalog.find("sources\\boot.wim") == wim);
+    assert(catalog.find("sources/boot.wi") == ISOCatalog::kNone);
+    assert(catalog.find("boot.wim") == ISOCatalog::kNone);
+
+    // "sources" was implied by its child and has no archive item
+    const uint32_t sources = catalog.find("sources");
+    assert(sources != ISOCatalog::kNone);
+    assert(catalog.entry(sources).isDir);
+    assert(catalog.entry(sources).archiveIndex == ISOCatalog::kNone);
+
+    // A later directory item binds to the implied entry instead of duplicating it
+    const uint32_t bootDir = catalog.find("efi/boot");
+    assert(catalog.entry(bootDir).archiveIndex == 2);
+    assert(catalog.byArchiveIndex(2) == bootDir);
+
+    // Paths are rebuilt with the separator the archive uses, keeping the original case
+    assert(catalog.fullPath(catalog.find("efi/boot/BOOTX64.EFI")) == "efi\\Boot\\bootx64.efi");
+    assert(catalog.relativePath(catalog.find("efi/boot/bootx64.efi"), catalog.find("efi")) == "Boot\\bootx64.efi");
+
+    // Directory queries return every descendant in archive order
+    const std::vector<uint32_t> under = catalog.entriesUnder("EFI");
+    assert(under.size() == 2);
+    assert(catalog.entry(under[0]).archiveIndex == 1);
+    assert(catalog.entry(under[1]).archiveIndex == 2);
+    assert(catalog.entriesUnder("setup.exe").empty());
+    assert(catalog.entriesUnder("").size() == catalog.size());
+
+    assert(ISOCatalog::foldCase("Boot/EFI") == "boot/efi");
+
+    // Serialized catalogs restore lookups, child links and separators without re-interning
+    std::string blob;
+    catalog.serialize(blob);
+    ISOCatalog restored;
+    assert(restored.deserialize(blob.data(), blob.size()));
+    assert(restored.size() == catalog.size());
+    assert(restored.find("sources/BOOT.wim") == wim);
+    assert(restored.fullPath(restored.find("efi/boot/bootx64.efi")) == "efi\\Boot\\bootx64.efi");
+    assert(restored.entriesUnder("efi").size() == 2);
+    assert(restored.byArchiveIndex(4) == catalog.byArchiveIndex(4));
+    assert(!restored.deserialize(blob.data(), blob.size() - 1));
+
+    // Enough entries to force several index rehashes
+    ISOCatalog big;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        big.add("dir" + std::to_string(i % 37) + "/file" + std::to_string(i) + ".bin", i, false, i);
+    }
+    for (uint32_t i = 0; i < 5000; i += 97) {
+        const uint32_t idx = big.find("DIR" + std::to_string(i % 37) + "/FILE" + std::to_string(i) + ".BIN");
+        assert(idx != ISOCatalog::kNone);
+        assert(big.entry(idx).archiveIndex == i);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../src/models/ISOFingerprint.h"
+#include "../tools/ISOImageWriter.h"
+
+namespace {
+constexpr uint64_t kSectorSize = 2048;
+
+void FlipByte(const std::string &path, uint64_t offset) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    const int value = file.get();
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.put(static_cast<char>(value ^ 0x5A));
+}
+} // namespace
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "iso_fingerprint_tests";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string imagePath = (dir / "image.iso").string();
+
+    // Large enough that the samples leave most of the image unread
+    ISOImageWriter writer;
+    writer.addFile("efi/boot/bootx64.efi", 96 * 1024, 1, ISOImageWriter::Content::PE);
+    writer.addFile("sources/boot.wim", 48ull << 20, 2, ISOImageWriter::Content::Zero);
+    writer.addFile("setup.exe", 200 * 1024, 3, ISOImageWriter::Content::PE);
+    ISOImageWriter::Options options;
+    options.sparse = true;
+    assert(writer.write(imagePath, options));
+
+    const std::string original = ISOFingerprint::compute(imagePath);
+    assert(original.size() == 64);
+    assert(ISOFingerprint::compute(imagePath) == original);
+
+    // The same layout written again is byte-identical, so it fingerprints the same
+    assert(writer.write(imagePath, options));
+    assert(ISOFingerprint::compute(imagePath) == original);
+
+    // Volume descriptor set (primary volume descriptor)
+    FlipByte(imagePath, 16 * kSectorSize + 100);
+    assert(ISOFingerprint::compute(imagePath) != original);
+    assert(writer.write(imagePath, options));
+
+    // UDF logical volume integrity descriptor, past the VDS and outside the first sample
+    FlipByte(imagePath, 64 * kSectorSize + 80);
+    assert(ISOFingerprint::compute(imagePath) != original);
+    assert(writer.write(imagePath, options));
+
+    // Last sampled block
+    const uint64_t size = std::filesystem::file_size(imagePath);
+    FlipByte(imagePath, size - 1);
+    assert(ISOFingerprint::compute(imagePath) != original);
+    assert(writer.write(imagePath, options));
+
+    // Size alone
+    std::filesystem::resize_file(imagePath, size + kSectorSize);
+    assert(ISOFingerprint::compute(imagePath) != original);
+
+    // Plain ISO9660 has no integrity descriptor; still fingerprinted from the rest
+    options.udf = false;
+    assert(writer.write(imagePath, options));
+    const std::string noUdf = ISOFingerprint::compute(imagePath);
+    assert(noUdf.size() == 64 && noUdf != original);
+
+    assert(ISOFingerprint::compute((dir / "missing.iso").string()).empty());
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
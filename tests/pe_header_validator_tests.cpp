@@ -0,0 +1,82 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../src/models/PEHeaderValidator.h"
+
+namespace {
+// DOS header with e_lfanew = peOffset, then "PE\0\0" and Machine there, padded to size
+std::vector<uint8_t> MakeImage(uint32_t peOffset, uint16_t machine, size_t size) {
+    std::vector<uint8_t> image(size, 0xCC);
+    image[0] = 'M';
+    image[1] = 'Z';
+    for (int i = 0; i < 4; ++i)
+        image[0x3C + i] = static_cast<uint8_t>(peOffset >> (8 * i));
+    const uint8_t header[6] = {'P', 'E', 0, 0, static_cast<uint8_t>(machine), static_cast<uint8_t>(machine >> 8)};
+    for (size_t i = 0; i < 6; ++i)
+        image[peOffset + i] = header[i];
+    return image;
+}
+
+PEImageInfo Validate(const std::vector<uint8_t> &data, size_t piece) {
+    PEHeaderValidator validator;
+    for (size_t offset = 0; offset < data.size(); offset += piece)
+        validator.update(data.data() + offset, std::min(piece, data.size() - offset));
+    return validator.info();
+}
+} // namespace
+
+int main() {
+    // Same result however the stream is cut, including pieces that split e_lfanew and the signature
+    const std::vector<uint8_t> amd64 = MakeImage(0xF8, 0x8664, 4096);
+    for (size_t piece : {1, 2, 5, 63, 64, 65, 250, 4096}) {
+        const PEImageInfo info = Validate(amd64, piece);
+        assert(info.dosHeader && info.peHeader && info.machine == 0x8664);
+    }
+
+    // PE header inside the DOS header, as in tiny images
+    const PEImageInfo tiny = Validate(MakeImage(4, 0xAA64, 512), 7);
+    assert(tiny.dosHeader && tiny.peHeader && tiny.machine == 0xAA64);
+
+    // Plain DOS executable: still accepted as an image, no machine
+    std::vector<uint8_t> dos = MakeImage(0x80, 0x14C, 1024);
+    dos[0x80]                = 'N';
+
+    const PEImageInfo dosInfo = Validate(dos, 100);
+    assert(dosInfo.dosHeader && !dosInfo.peHeader && dosInfo.machine == 0);
+
+    // Not an image at all, and files cut short
+    std::vector<uint8_t> text(2048, 'x');
+    assert(!Validate(text, 512).dosHeader);
+    assert(!Validate(std::vector<uint8_t>(amd64.begin(), amd64.begin() + 40), 8).dosHeader);
+    const PEImageInfo truncated = Validate(std::vector<uint8_t>(amd64.begin(), amd64.begin() + 0xFA), 16);
+    assert(truncated.dosHeader && !truncated.peHeader);
+
+    // Complete as soon as the Machine field is in; later bytes do not matter
+    PEHeaderValidator validator;
+    validator.update(amd64.data(), 0xFE);
+    assert(validator.complete());
+    validator.update(text.data(), text.size());
+    assert(validator.info().machine == 0x8664);
+    validator.reset();
+    assert(!validator.complete() && !validator.info().dosHeader);
+
+    assert(PEHeaderValidator::isImageName(std::string("EFI/BOOT/BOOTX64.EFI")));
+    assert(PEHeaderValidator::isImageName(std::wstring(L"setup.exe")));
+    assert(PEHeaderValidator::isImageName(std::string("a.Dll")));
+    assert(!PEHeaderValidator::isImageName(std::string("boot.wim")));
+    assert(!PEHeaderValidator::isImageName(std::string("exe")));
+    assert(!PEHeaderValidator::isImageName(std::string("a.exex")));
+
+    PEImageReport report;
+    report.record("Z:\\EFI\\Boot\\bootx64.efi", Validate(amd64, 4096));
+    PEImageInfo found;
+    assert(report.find("z:/efi/BOOT/BOOTX64.EFI", found) && found.machine == 0x8664);
+    assert(!report.find("Z:\\EFI\\Boot\\bootia32.efi", found));
+    assert(report.size() == 1);
+    return 0;
+}
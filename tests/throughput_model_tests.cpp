@@ -0,0 +1,80 @@
+// The checks are asserts: keep them, and the helpers they use, in Release builds too
+#undef NDEBUG
+#include <cassert>
+#include <cmath>
+#include <string>
+
+#include "../src/models/ThroughputModel.h"
+
+namespace {
+constexpr unsigned long long kMB = 1024ull * 1024;
+
+bool Near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+} // namespace
+
+int main() {
+    ThroughputModel model;
+    assert(!model.ready() && model.secondsLeft(kMB) < 0);
+
+    // Steady 10 MB/s, sampled every 100 ms as the copy loop does
+    model.sample(0, 0);
+    for (int i = 1; i <= 10; ++i)
+        model.sample(i * 0.1, static_cast<unsigned long long>(i) * kMB);
+    assert(Near(model.bytesPerSecond(), 10.0 * kMB, 1));
+    assert(!model.ready()); // still warming up
+    for (int i = 11; i <= 30; ++i)
+        model.sample(i * 0.1, static_cast<unsigned long long>(i) * kMB);
+    assert(model.ready());
+    assert(Near(model.secondsLeft(100 * kMB), 10, 0.01));
+
+    // Repeated or backwards times are ignored
+    model.sample(3.0, 40 * kMB);
+    model.sample(2.5, 40 * kMB);
+    assert(Near(model.bytesPerSecond(), 10.0 * kMB, 1));
+
+    // The rate halves: after one half-life the estimate has moved halfway, after several it has settled
+    unsigned long long bytes = 30 * kMB;
+    double             time  = 3.0;
+    for (int i = 0; i < 50; ++i) {
+        time += 0.1;
+        bytes += kMB / 2;
+        model.sample(time, bytes);
+    }
+    assert(Near(model.bytesPerSecond(), 7.5 * kMB, 0.05 * kMB));
+    for (int i = 0; i < 500; ++i) {
+        time += 0.1;
+        bytes += kMB / 2;
+        model.sample(time, bytes);
+    }
+    assert(Near(model.bytesPerSecond(), 5.0 * kMB, 0.01 * kMB));
+
+    // Uneven intervals give the same answer as even ones
+    ThroughputModel even(2.0);
+    ThroughputModel uneven(2.0);
+    even.sample(0, 0);
+    uneven.sample(0, 0);
+    even.sample(1, 4 * kMB);
+    uneven.sample(1, 4 * kMB);
+    for (int i = 1; i <= 4; ++i)
+        even.sample(1 + i * 0.5, 4 * kMB + static_cast<unsigned long long>(i) * kMB);
+    uneven.sample(2, 6 * kMB);
+    uneven.sample(3, 8 * kMB);
+    assert(Near(even.bytesPerSecond(), uneven.bytesPerSecond(), 1));
+
+    // A stall still gives no estimate until something moves
+    ThroughputModel stalled;
+    stalled.sample(0, 0);
+    stalled.sample(5, 0);
+    assert(!stalled.ready());
+
+    model.reset();
+    assert(!model.ready() && model.bytesPerSecond() == 0);
+
+    assert(ThroughputModel::formatRemaining(-1).empty());
+    assert(ThroughputModel::formatRemaining(12.4) == "quedan 12 s");
+    assert(ThroughputModel::formatRemaining(200) == "quedan 3 min 20 s");
+    assert(ThroughputModel::formatRemaining(3900) == "quedan 1 h 05 min");
+    return 0;
+}
@@ -1,7 +1,9 @@
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include "../src/utils/Utils.h"
+#include "../src/utils/PatternMatcher.h"
 
 int main() {
     const std::string  original  = u8"áéíóúñ ISO";
@@ -16,5 +18,22 @@ int main() {
     const std::string exeDir = Utils::getExeDirectory();
     assert(!exeDir.empty());
 
+    const std::vector<std::string> patterns = {"sources/install.wim", "sources/*.esd", "*.tmp", "efi/?oot/*"};
+    const PatternMatcher           matcher(patterns);
+    const std::vector<std::string> paths    = {"sources/install.wim", "sources/install.esd", "sources/boot.wim",
+                                               "setup.exe",           "a/b/c.tmp",           "efi/boot/bootx64.efi",
+                                               "efi/microsoft",       "sources",             ""};
+    for (const auto &path : paths) {
+        bool expected = false;
+        for (const auto &pattern : patterns) {
+            expected = expected || Utils::matchesPattern(path, pattern);
+        }
+        assert(matcher.matches(path) == expected);
+    }
+    assert(matcher.matches("sources/install.wim"));
+    assert(!matcher.matches("sources/boot.wim"));
+    assert(PatternMatcher().empty());
+    assert(!PatternMatcher().matches("x"));
+
     return 0;
 }
@@ -269,6 +269,10 @@ Z7_COM7F_IMF(CHandler::GetProperty(UInt32 index, PROPID propID, PROPVARIANT *val
         if (!item.IsDir())
           prop = (UInt64)ref.TotalSize;
         break;
+      case kpidOffset:
+        if (!item.IsDir())
+          prop = (UInt64)item.ExtentLocation * kBlockSize;
+        break;
 
       case kpidMTime:
       // case kpidCTime:
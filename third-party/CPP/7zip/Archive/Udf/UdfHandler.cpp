@@ -251,6 +251,26 @@ Z7_COM7F_IMF(CHandler::GetProperty(UInt32 index, PROPID propID, PROPVARIANT *val
       // case kpidGroupId: prop = item.Gid; break;
       // case kpidPosixAttrib: prop = (UInt32)item.Permissions; break;
       case kpidLinks: prop = (UInt32)item.FileLinkCount; break;
+      case kpidOffset:
+        // physical position of the first recorded extent (used to schedule reads in disk order)
+        if (!item.IsDir() && !item.IsInline)
+        {
+          FOR_VECTOR (extentIndex, item.Extents)
+          {
+            const CMyExtent &extent = item.Extents[extentIndex];
+            if (extent.GetLen() == 0)
+              continue;
+            if (extent.PartitionRef >= vol.PartitionMaps.Size())
+              break;
+            const unsigned partitionIndex = vol.PartitionMaps[extent.PartitionRef].PartitionIndex;
+            if (partitionIndex >= _archive.Partitions.Size())
+              break;
+            const CPartition &partition = _archive.Partitions[partitionIndex];
+            prop = ((UInt64)partition.Pos << _archive.SecLogSize) + (UInt64)extent.Pos * vol.BlockSize;
+            break;
+          }
+        }
+        break;
     }
   }
   prop.Detach(value);
@@ -0,0 +1,1467 @@
+#include "ISOImageWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <unordered_map>
+
+namespace {
+constexpr uint32_t kSectorSize      = 2048;
+constexpr uint32_t kSystemAreaEnd   = 16;
+constexpr uint32_t kUdfMainVds      = 32;
+constexpr uint32_t kUdfReserveVds   = 48;
+constexpr uint32_t kUdfIntegrity    = 64;
+constexpr uint32_t kUdfAnchor       = 256;
+constexpr uint32_t kUdfVdsLength    = 6;          // PVD, IUVD, PD, LVD, USD, TD
+constexpr uint64_t kMaxIsoExtent    = 0xFFFFF800; // largest sector-aligned extent a directory record holds
+constexpr uint32_t kMaxUdfExtent    = 0x3FFFF800; // short_ad lengths are 30 bits
+constexpr uint32_t kMaxUdfExtents   = (kSectorSize - 176) / 8;
+constexpr uint32_t kPeHeaderSize    = 0x200;
+constexpr size_t   kWriteChunk      = 1u << 20;
+constexpr char     kApplicationId[] = "BOOTTHATISO ISOGEN";
+constexpr char     kUdfImplId[]     = "*BootThatISO";
+
+// ---------- little helpers ----------
+
+void Put16(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void Put32(uint8_t *p, uint32_t v) {
+    Put16(p, v & 0xFFFF);
+    Put16(p + 2, v >> 16);
+}
+
+void Put64(uint8_t *p, uint64_t v) {
+    Put32(p, static_cast<uint32_t>(v));
+    Put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+void PutBe16(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+void PutBe32(uint8_t *p, uint32_t v) {
+    PutBe16(p, v >> 16);
+    PutBe16(p + 2, v & 0xFFFF);
+}
+
+// ISO9660 "both-byte orders" fields
+void PutBoth16(uint8_t *p, uint32_t v) {
+    Put16(p, v);
+    PutBe16(p + 2, v);
+}
+
+void PutBoth32(uint8_t *p, uint32_t v) {
+    Put32(p, v);
+    PutBe32(p + 4, v);
+}
+
+uint32_t Sectors(uint64_t bytes) {
+    return static_cast<uint32_t>((bytes + kSectorSize - 1) / kSectorSize);
+}
+
+uint64_t SplitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+    uint64_t next() { return SplitMix64(state_++ * 0xD1B54A32D192ED03ULL); }
+    uint64_t below(uint64_t bound) { return bound == 0 ? 0 : next() % bound; }
+    double   unit() { return static_cast<double>(next() >> 11) / 9007199254740992.0; }
+
+private:
+    uint64_t state_;
+};
+
+std::u32string DecodeUtf8(const std::string &text) {
+    std::u32string out;
+    for (size_t i = 0; i < text.size();) {
+        const auto c     = static_cast<unsigned char>(text[i]);
+        size_t     extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : 4;
+        if (extra == 4 || i + extra >= text.size()) {
+            out.push_back(U'\uFFFD');
+            ++i;
+            continue;
+        }
+        char32_t cp = extra == 0 ? c : (c & (0x3F >> extra));
+        for (size_t k = 1; k <= extra; ++k)
+            cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        out.push_back(cp);
+        i += extra + 1;
+    }
+    return out;
+}
+
+// Dates: days since 1970-01-01 to a civil date (proleptic Gregorian)
+struct CivilTime {
+    int year, month, day, hour, minute, second;
+};
+
+CivilTime ToCivil(std::time_t t) {
+    const int64_t secs = static_cast<int64_t>(t);
+    int64_t       days = secs / 86400;
+    int64_t       rem  = secs % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        --days;
+    }
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp  = (5 * doy + 2) / 153;
+    CivilTime     c;
+    c.day    = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    c.month  = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    c.year   = static_cast<int>(yoe + era * 400 + (c.month <= 2 ? 1 : 0));
+    c.hour   = static_cast<int>(rem / 3600);
+    c.minute = static_cast<int>(rem / 60 % 60);
+    c.second = static_cast<int>(rem % 60);
+    return c;
+}
+
+// ---------- ISO9660 / Joliet naming ----------
+
+bool IsDChar(char32_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+std::string ToDChars(const std::u32string &text, size_t maxLength) {
+    std::string out;
+    for (char32_t c : text) {
+        if (out.size() == maxLength)
+            break;
+        if (c >= 'a' && c <= 'z')
+            c = c - 'a' + 'A';
+        out.push_back(IsDChar(c) ? static_cast<char>(c) : '_');
+    }
+    return out;
+}
+
+// Level 2 identifiers: at most 30 characters plus ";1" for files, 31 for directories
+std::string IsoIdentifier(const std::string &name, bool directory, const std::set<std::string> &taken) {
+    const std::u32string wide = DecodeUtf8(name);
+    std::string          base;
+    std::string          ext;
+    if (directory) {
+        base = ToDChars(wide, 31);
+    } else {
+        const size_t dot = wide.find_last_of(U'.');
+        if (dot != std::u32string::npos && dot > 0) {
+            ext  = ToDChars(wide.substr(dot + 1), 8);
+            base = ToDChars(wide.substr(0, dot), 29 - ext.size());
+        } else {
+            base = ToDChars(wide, 29);
+        }
+    }
+    if (base.empty())
+        base = "_";
+    const size_t maxBase = directory ? 31 : 29 - ext.size();
+    auto         compose = [&](const std::string &b) { return directory ? b : b + "." + ext + ";1"; };
+
+    std::string id = compose(base);
+    for (unsigned n = 1; taken.count(id) != 0; ++n) {
+        const std::string suffix = "~" + std::to_string(n);
+        id = compose(base.substr(0, std::min(base.size(), maxBase - suffix.size())) + suffix);
+    }
+    return id;
+}
+
+// Joliet identifiers: UCS-2 big endian, at most 64 characters
+std::string JolietIdentifier(const std::string &name, bool directory, const std::set<std::string> &taken) {
+    std::u16string units;
+    for (char32_t c : DecodeUtf8(name)) {
+        const bool reserved = c < 0x20 || c == '*' || c == '/' || c == ':' || c == ';' || c == '?' || c == '\\';
+        units.push_back(reserved || c > 0xFFFF ? u'_' : static_cast<char16_t>(c));
+    }
+    const size_t maxLength = directory ? 64 : 62;
+    if (units.size() > maxLength)
+        units.resize(maxLength);
+
+    auto encode = [&](const std::u16string &u) {
+        std::string out;
+        for (char16_t c : u) {
+            out.push_back(static_cast<char>(c >> 8));
+            out.push_back(static_cast<char>(c & 0xFF));
+        }
+        if (!directory)
+            out.append({'\0', ';', '\0', '1'});
+        return out;
+    };
+    std::string id = encode(units);
+    for (unsigned n = 1; taken.count(id) != 0; ++n) {
+        std::u16string    candidate = units;
+        const std::string suffix    = "~" + std::to_string(n);
+        candidate.resize(std::min(candidate.size(), maxLength - suffix.size()));
+        candidate.append(suffix.begin(), suffix.end());
+        id = encode(candidate);
+    }
+    return id;
+}
+
+// ---------- UDF (ECMA-167 3rd edition, OSTA UDF 2.01) ----------
+
+uint16_t Crc16(const uint8_t *p, size_t size) {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= static_cast<uint32_t>(p[i]) << 8;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return static_cast<uint16_t>(crc);
+}
+
+// Descriptor tag (ECMA 3/7.2); length is the whole descriptor, tag included
+void PutTag(uint8_t *p, uint16_t id, uint32_t location, size_t length) {
+    const size_t crcLength = length - 16;
+    Put16(p, id);
+    Put16(p + 2, 3); // NSR03
+    Put16(p + 6, 1); // serial number
+    Put16(p + 8, Crc16(p + 16, crcLength));
+    Put16(p + 10, static_cast<uint32_t>(crcLength));
+    Put32(p + 12, location);
+    unsigned sum = 0;
+    for (int i = 0; i < 16; ++i)
+        sum += i == 4 ? 0 : p[i];
+    p[4] = static_cast<uint8_t>(sum);
+}
+
+// OSTA CS0 characters: compression id 8 when everything fits in a byte, 16 (UCS-2 big endian) otherwise
+std::string UdfCharacters(const std::string &name, size_t maxBytes) {
+    const std::u32string wide   = DecodeUtf8(name);
+    const bool           narrow = std::all_of(wide.begin(), wide.end(), [](char32_t c) { return c < 0x100; });
+    std::string          out(1, static_cast<char>(narrow ? 8 : 16));
+    for (char32_t c : wide) {
+        if (out.size() + (narrow ? 1 : 2) > maxBytes)
+            break;
+        if (c > 0xFFFF)
+            c = '_';
+        if (!narrow)
+            out.push_back(static_cast<char>(c >> 8));
+        out.push_back(static_cast<char>(c & 0xFF));
+    }
+    return out;
+}
+
+// Fixed-length dstring: characters, zero padding, used length in the last byte
+void PutDString(uint8_t *p, size_t fieldLength, const std::string &text) {
+    if (text.empty())
+        return;
+    const std::string chars = UdfCharacters(text, fieldLength - 1);
+    std::memcpy(p, chars.data(), chars.size());
+    p[fieldLength - 1] = static_cast<uint8_t>(chars.size());
+}
+
+void PutCharspec(uint8_t *p) {
+    static const char kOsta[] = "OSTA Compressed Unicode";
+    std::memcpy(p + 1, kOsta, sizeof(kOsta) - 1);
+}
+
+void PutRegId(uint8_t *p, const char *id, uint32_t udfRevision = 0) {
+    std::memcpy(p + 1, id, std::strlen(id));
+    if (udfRevision != 0)
+        Put16(p + 24, udfRevision);
+}
+
+void PutUdfTimestamp(uint8_t *p, const CivilTime &t) {
+    Put16(p, 1u << 12); // local time, UTC offset 0
+    Put16(p + 2, static_cast<uint32_t>(t.year));
+    p[4] = static_cast<uint8_t>(t.month);
+    p[5] = static_cast<uint8_t>(t.day);
+    p[6] = static_cast<uint8_t>(t.hour);
+    p[7] = static_cast<uint8_t>(t.minute);
+    p[8] = static_cast<uint8_t>(t.second);
+}
+
+void PutIsoDirectoryDate(uint8_t *p, const CivilTime &t) {
+    p[0] = static_cast<uint8_t>(t.year - 1900);
+    p[1] = static_cast<uint8_t>(t.month);
+    p[2] = static_cast<uint8_t>(t.day);
+    p[3] = static_cast<uint8_t>(t.hour);
+    p[4] = static_cast<uint8_t>(t.minute);
+    p[5] = static_cast<uint8_t>(t.second);
+}
+
+void PutIsoVolumeDate(uint8_t *p, const CivilTime *t) {
+    char text[20];
+    if (t) {
+        std::snprintf(text, sizeof(text), "%04d%02d%02d%02d%02d%02d00", t->year, t->month, t->day, t->hour,
+                      t->minute, t->second);
+    } else {
+        std::memcpy(text, "0000000000000000", 17);
+    }
+    std::memcpy(p, text, 16);
+    p[16] = 0;
+}
+
+void PutPadded(uint8_t *p, size_t fieldLength, const std::string &text) {
+    std::memset(p, ' ', fieldLength);
+    std::memcpy(p, text.data(), std::min(fieldLength, text.size()));
+}
+
+void PutPaddedUcs2(uint8_t *p, size_t fieldLength, const std::string &text) {
+    for (size_t i = 0; i + 1 < fieldLength; i += 2)
+        PutBe16(p + i, ' ');
+    const std::u32string wide = DecodeUtf8(text);
+    for (size_t i = 0; i < wide.size() && 2 * i + 1 < fieldLength; ++i)
+        PutBe16(p + 2 * i, wide[i] > 0xFFFF ? '_' : static_cast<uint32_t>(wide[i]));
+}
+
+// ---------- PE header of generated executables ----------
+
+bool IsExecutableName(const std::string &path) {
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == "efi" || ext == "exe" || ext == "dll" || ext == "sys";
+}
+
+// A minimal PE32+ image: DOS header, COFF header, optional header and one section covering the rest
+void BuildPeHeader(const std::string &path, uint64_t fileSize, uint8_t *h) {
+    std::memset(h, 0, kPeHeaderSize);
+    const size_t dot = path.find_last_of('.');
+    std::string  ext = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    const bool     efi     = ext == "efi";
+    const bool     dll     = ext == "dll" || ext == "sys";
+    const uint32_t rawSize = static_cast<uint32_t>(std::min<uint64_t>((fileSize - kPeHeaderSize) & ~0x1FFULL, 0x7FFFFE00));
+
+    h[0] = 'M';
+    h[1] = 'Z';
+    Put32(h + 0x3C, 0x80);
+    std::memcpy(h + 0x80, "PE\0\0", 4);
+    uint8_t *coff = h + 0x84;
+    Put16(coff, 0x8664);
+    Put16(coff + 2, 1);
+    Put32(coff + 4, 0x65920080);
+    Put16(coff + 16, 0xF0);
+    Put16(coff + 18, dll ? 0x2022 : 0x0022);
+    uint8_t *opt = coff + 20;
+    Put16(opt, 0x20B);
+    opt[2] = 14;
+    Put32(opt + 4, rawSize);
+    Put32(opt + 16, 0x1000);
+    Put32(opt + 20, 0x1000);
+    Put64(opt + 24, dll ? 0x180000000ULL : 0x140000000ULL);
+    Put32(opt + 32, 0x1000);
+    Put32(opt + 36, 0x200);
+    Put16(opt + 40, 6);
+    Put16(opt + 48, 6);
+    Put32(opt + 56, 0x1000 + ((rawSize + 0xFFF) & ~0xFFFu));
+    Put32(opt + 60, kPeHeaderSize);
+    Put16(opt + 68, efi ? 10 : 3);
+    Put16(opt + 70, 0x8160);
+    Put64(opt + 72, 0x100000);
+    Put64(opt + 80, 0x1000);
+    Put64(opt + 88, 0x100000);
+    Put64(opt + 96, 0x1000);
+    Put32(opt + 108, 16);
+    uint8_t *section = opt + 0xF0;
+    std::memcpy(section, ".text", 5);
+    Put32(section + 8, rawSize);
+    Put32(section + 12, 0x1000);
+    Put32(section + 16, rawSize);
+    Put32(section + 20, kPeHeaderSize);
+    Put32(section + 36, 0x60000020);
+}
+
+// ---------- output ----------
+
+class ImageStream {
+public:
+    explicit ImageStream(bool sparse) : sparse_(sparse) {}
+
+    bool open(const std::string &path) {
+        file_.open(std::filesystem::u8path(path), std::ios::binary | std::ios::trunc);
+        return file_.is_open();
+    }
+
+    // Structures are emitted in ascending order; the gap up to offset is zero-filled (or left as a hole)
+    bool moveTo(uint64_t offset) {
+        if (offset < pos_)
+            return false;
+        if (sparse_) {
+            pos_ = offset;
+            return true;
+        }
+        static const std::vector<char> zeros(kWriteChunk, 0);
+        while (pos_ < offset) {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(offset - pos_, zeros.size()));
+            if (!write(zeros.data(), n))
+                return false;
+        }
+        return true;
+    }
+
+    bool write(const void *data, size_t size) {
+        if (streamPos_ != pos_) {
+            file_.seekp(static_cast<std::streamoff>(pos_));
+            streamPos_ = pos_;
+        }
+        file_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        pos_ += size;
+        streamPos_ = pos_;
+        return file_.good();
+    }
+
+    bool writeSector(uint32_t lba, const std::vector<uint8_t> &sectors) {
+        return moveTo(static_cast<uint64_t>(lba) * kSectorSize) && write(sectors.data(), sectors.size());
+    }
+
+    // Makes the file exactly size bytes long, even when it ends in a hole
+    bool finish(uint64_t size) {
+        if (streamPos_ < size) {
+            if (!moveTo(size - 1) || !write("", 1))
+                return false;
+        }
+        file_.flush();
+        return file_.good();
+    }
+
+private:
+    std::ofstream file_;
+    bool          sparse_;
+    uint64_t      pos_       = 0;
+    uint64_t      streamPos_ = 0;
+};
+
+struct DirRecord {
+    uint32_t    lba;
+    uint32_t    length;
+    uint8_t     flags;
+    std::string id;
+};
+
+constexpr uint8_t kFlagDirectory   = 0x02;
+constexpr uint8_t kFlagMultiExtent = 0x80;
+
+size_t RecordLength(const DirRecord &record) {
+    const size_t length = 33 + record.id.size();
+    return length + (length & 1);
+}
+
+// Lays out directory records without letting one cross a sector boundary; returns the extent size
+uint32_t PutDirRecords(const std::vector<DirRecord> &records, const CivilTime &time, uint8_t *out) {
+    size_t offset = 0;
+    for (const auto &record : records) {
+        const size_t length = RecordLength(record);
+        if (offset % kSectorSize + length > kSectorSize)
+            offset = (offset / kSectorSize + 1) * kSectorSize;
+        if (out) {
+            uint8_t *p = out + offset;
+            p[0]       = static_cast<uint8_t>(length);
+            PutBoth32(p + 2, record.lba);
+            PutBoth32(p + 10, record.length);
+            PutIsoDirectoryDate(p + 18, time);
+            p[25] = record.flags;
+            PutBoth16(p + 28, 1);
+            p[32] = static_cast<uint8_t>(record.id.size());
+            std::memcpy(p + 33, record.id.data(), record.id.size());
+        }
+        offset += length;
+    }
+    return Sectors(offset) * kSectorSize;
+}
+} // namespace
+
+struct ISOImageWriter::Node {
+    std::string                             name;
+    bool                                    directory = false;
+    Node                                   *parent    = nullptr;
+    size_t                                  entry     = SIZE_MAX;
+    std::vector<std::unique_ptr<Node>>      children;
+    std::unordered_map<std::string, Node *> byName;
+};
+
+struct ISOImageWriter::Layout {
+    // Where a node ended up in each of the trees
+    struct Placement {
+        std::string isoId;
+        std::string jolietId; // UCS-2 big endian
+        std::string udfId;    // OSTA CS0
+
+        std::vector<const Node *> isoChildren; // sorted the way each tree requires
+        std::vector<const Node *> jolietChildren;
+
+        uint32_t isoNumber    = 0; // path table directory numbers
+        uint32_t jolietNumber = 0;
+        uint32_t isoLba       = 0;
+        uint32_t isoSize      = 0;
+        uint32_t jolietLba    = 0;
+        uint32_t jolietSize   = 0;
+
+        uint32_t udfEntry     = 0; // partition block of the file entry
+        uint32_t udfDataBlock = 0; // directories: partition block of the identifiers
+        uint32_t udfDataSize  = 0;
+        uint32_t uniqueId     = 0;
+
+        uint32_t dataLba = 0; // files
+    };
+
+    std::unordered_map<const Node *, Placement> nodes;
+    std::vector<const Node *>                   isoDirs; // path table order
+    std::vector<const Node *>                   jolietDirs;
+    std::vector<const Node *>                   files; // data order
+    std::vector<const Node *>                   udfNodes;
+
+    uint32_t primaryVd      = 0;
+    uint32_t jolietVd       = 0;
+    uint32_t terminatorVd   = 0;
+    uint32_t isoPathL       = 0;
+    uint32_t isoPathM       = 0;
+    uint32_t isoPathSize    = 0;
+    uint32_t jolietPathL    = 0;
+    uint32_t jolietPathM    = 0;
+    uint32_t jolietPathSize = 0;
+
+    uint32_t partitionStart  = 0;
+    uint32_t partitionLength = 0;
+    uint32_t udfFiles        = 0;
+    uint32_t udfDirectories  = 0;
+    uint32_t nextUniqueId    = 0;
+
+    uint32_t totalSectors = 0;
+
+    const Placement &at(const Node *node) const { return nodes.at(node); }
+
+    // The records of a directory extent; sizes do not depend on any LBA, so this also serves to size
+    // the extents before they are placed
+    std::vector<DirRecord> records(const Node *dir, const std::vector<Entry> &entries, bool joliet) const {
+        const Placement &dp   = at(dir);
+        const Placement &pp   = at(dir->parent ? dir->parent : dir);
+        auto             lba  = [&](const Placement &p) { return joliet ? p.jolietLba : p.isoLba; };
+        auto             size = [&](const Placement &p) { return joliet ? p.jolietSize : p.isoSize; };
+
+        std::vector<DirRecord> list;
+        list.push_back({lba(dp), size(dp), kFlagDirectory, std::string(1, '\0')});
+        list.push_back({lba(pp), size(pp), kFlagDirectory, std::string(1, '\1')});
+        for (const Node *child : joliet ? dp.jolietChildren : dp.isoChildren) {
+            const Placement   &cp = at(child);
+            const std::string &id = joliet ? cp.jolietId : cp.isoId;
+            if (child->directory) {
+                list.push_back({lba(cp), size(cp), kFlagDirectory, id});
+                continue;
+            }
+            // Files past 4 GiB take several records, all but the last flagged multi-extent
+            uint64_t remaining = entries[child->entry].size;
+            uint32_t pieceLba  = cp.dataLba;
+            do {
+                const uint64_t piece = std::min(remaining, kMaxIsoExtent);
+                remaining -= piece;
+                list.push_back({pieceLba, static_cast<uint32_t>(piece),
+                                static_cast<uint8_t>(remaining > 0 ? kFlagMultiExtent : 0), id});
+                pieceLba += static_cast<uint32_t>(piece / kSectorSize);
+            } while (remaining > 0);
+        }
+        return list;
+    }
+};
+
+ISOImageWriter::ISOImageWriter() : root_(std::make_unique<Node>()) {
+    root_->directory = true;
+}
+
+ISOImageWriter::~ISOImageWriter() = default;
+
+ISOImageWriter::Node *ISOImageWriter::findOrCreate(const std::string &path, bool directory) {
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    Node  *node = root_.get();
+    size_t pos  = 0;
+    while (pos < normalized.size()) {
+        size_t end = normalized.find('/', pos);
+        if (end == std::string::npos)
+            end = normalized.size();
+        const std::string part = normalized.substr(pos, end - pos);
+        pos                    = end + 1;
+        if (part.empty() || part == ".")
+            continue;
+        const bool last = pos >= normalized.size();
+        auto       it   = node->byName.find(part);
+        if (it != node->byName.end()) {
+            node = it->second;
+            // A file path reused as a directory (or the reverse) keeps the first kind
+            continue;
+        }
+        auto child       = std::make_unique<Node>();
+        child->name      = part;
+        child->directory = !last || directory;
+        child->parent    = node;
+        Node *raw        = child.get();
+        node->byName.emplace(part, raw);
+        node->children.push_back(std::move(child));
+        if (raw->directory)
+            ++directories_;
+        node = raw;
+    }
+    return node;
+}
+
+void ISOImageWriter::addDirectory(const std::string &path) {
+    findOrCreate(path, true);
+}
+
+void ISOImageWriter::addFile(const std::string &path, uint64_t size, uint64_t seed, Content content) {
+    Node *node = findOrCreate(path, false);
+    if (node->directory)
+        return;
+    Entry entry;
+    entry.path = path;
+    std::replace(entry.path.begin(), entry.path.end(), '\\', '/');
+    entry.size    = size;
+    entry.seed    = seed;
+    entry.content = content;
+    if (node->entry == SIZE_MAX) {
+        node->entry = entries_.size();
+        entries_.push_back(std::move(entry));
+    } else {
+        entries_[node->entry] = std::move(entry);
+    }
+}
+
+void ISOImageWriter::addFile(const std::string &path, const std::string &literal) {
+    addFile(path, literal.size(), 0, Content::Literal);
+    Node *node = findOrCreate(path, false);
+    if (node->entry != SIZE_MAX)
+        entries_[node->entry].literal = literal;
+}
+
+const std::vector<ISOImageWriter::Entry> &ISOImageWriter::entries() const {
+    return entries_;
+}
+
+size_t ISOImageWriter::directoryCount() const {
+    return directories_;
+}
+
+void ISOImageWriter::fillContent(const Entry &entry, uint64_t offset, void *buffer, size_t length) {
+    auto *out = static_cast<uint8_t *>(buffer);
+    switch (entry.content) {
+    case Content::Zero:
+        std::memset(out, 0, length);
+        return;
+    case Content::Literal:
+        std::memset(out, 0, length);
+        if (offset < entry.literal.size())
+            std::memcpy(out, entry.literal.data() + offset,
+                        static_cast<size_t>(std::min<uint64_t>(length, entry.literal.size() - offset)));
+        return;
+    case Content::Random:
+    case Content::PE:
+        break;
+    }
+
+    const uint64_t key = SplitMix64(entry.seed);
+    for (size_t done = 0; done < length;) {
+        const uint64_t pos  = offset + done;
+        const uint64_t word = SplitMix64(key ^ ((pos >> 3) * 0xD6E8FEB86659FD93ULL));
+        const unsigned skip = static_cast<unsigned>(pos & 7);
+        const size_t   take = std::min<size_t>(8 - skip, length - done);
+        for (size_t i = 0; i < take; ++i)
+            out[done + i] = static_cast<uint8_t>(word >> (8 * (skip + i)));
+        done += take;
+    }
+
+    if (entry.content == Content::PE && entry.size >= 2 * kPeHeaderSize && offset < kPeHeaderSize) {
+        uint8_t header[kPeHeaderSize];
+        BuildPeHeader(entry.path, entry.size, header);
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(length, kPeHeaderSize - offset));
+        std::memcpy(out, header + offset, n);
+    }
+}
+
+void ISOImageWriter::computeLayout(const Options &options, Layout &layout) const {
+    layout = Layout();
+
+    // Names and per-tree ordering
+    std::vector<const Node *> all{root_.get()};
+    layout.nodes[root_.get()];
+    for (size_t i = 0; i < all.size(); ++i) {
+        const Node *node = all[i];
+        if (!node->directory)
+            continue;
+        Layout::Placement    &place = layout.nodes[node];
+        std::set<std::string> isoTaken;
+        std::set<std::string> jolietTaken;
+        for (const auto &child : node->children) {
+            Layout::Placement &cp = layout.nodes[child.get()];
+            cp.isoId              = IsoIdentifier(child->name, child->directory, isoTaken);
+            cp.jolietId           = JolietIdentifier(child->name, child->directory, jolietTaken);
+            cp.udfId              = UdfCharacters(child->name, 255);
+            isoTaken.insert(cp.isoId);
+            jolietTaken.insert(cp.jolietId);
+            place.isoChildren.push_back(child.get());
+            place.jolietChildren.push_back(child.get());
+            all.push_back(child.get());
+        }
+        std::sort(place.isoChildren.begin(), place.isoChildren.end(),
+                  [&](const Node *a, const Node *b) { return layout.at(a).isoId < layout.at(b).isoId; });
+        std::sort(place.jolietChildren.begin(), place.jolietChildren.end(),
+                  [&](const Node *a, const Node *b) { return layout.at(a).jolietId < layout.at(b).jolietId; });
+    }
+
+    // Directories breadth-first in each tree's order: that is the path table order
+    auto collectDirs = [&](bool joliet, std::vector<const Node *> &dirs) {
+        dirs.push_back(root_.get());
+        for (size_t i = 0; i < dirs.size(); ++i) {
+            Layout::Placement &place                      = layout.nodes[dirs[i]];
+            (joliet ? place.jolietNumber : place.isoNumber) = static_cast<uint32_t>(i + 1);
+            for (const Node *child : joliet ? place.jolietChildren : place.isoChildren) {
+                if (child->directory)
+                    dirs.push_back(child);
+            }
+        }
+    };
+    collectDirs(false, layout.isoDirs);
+    if (options.joliet)
+        collectDirs(true, layout.jolietDirs);
+
+    auto pathTableSize = [&](const std::vector<const Node *> &dirs, bool joliet) {
+        uint32_t size = 0;
+        for (const Node *dir : dirs) {
+            const Layout::Placement &place  = layout.at(dir);
+            const size_t             length = dir == root_.get() ? 1 : (joliet ? place.jolietId : place.isoId).size();
+            size += static_cast<uint32_t>(8 + length + (length & 1));
+        }
+        return size;
+    };
+    layout.isoPathSize    = pathTableSize(layout.isoDirs, false);
+    layout.jolietPathSize = options.joliet ? pathTableSize(layout.jolietDirs, true) : 0;
+
+    // Volume descriptors, followed for UDF by the volume recognition sequence (BEA01, NSR03, TEA01);
+    // the UDF partition starts after the anchor at 256 with the file set descriptor and its terminator
+    uint32_t cursor     = kSystemAreaEnd;
+    layout.primaryVd    = cursor++;
+    layout.jolietVd     = options.joliet ? cursor++ : 0;
+    layout.terminatorVd = cursor++;
+    if (options.udf) {
+        layout.partitionStart = kUdfAnchor + 1;
+        cursor                = layout.partitionStart + 2;
+    }
+
+    layout.isoPathL = cursor;
+    cursor += Sectors(layout.isoPathSize);
+    layout.isoPathM = cursor;
+    cursor += Sectors(layout.isoPathSize);
+    if (options.joliet) {
+        layout.jolietPathL = cursor;
+        cursor += Sectors(layout.jolietPathSize);
+        layout.jolietPathM = cursor;
+        cursor += Sectors(layout.jolietPathSize);
+    }
+
+    const CivilTime time = ToCivil(options.timestamp);
+    for (const Node *dir : layout.isoDirs) {
+        Layout::Placement &place = layout.nodes[dir];
+        place.isoSize            = PutDirRecords(layout.records(dir, entries_, false), time, nullptr);
+        place.isoLba             = cursor;
+        cursor += place.isoSize / kSectorSize;
+    }
+    for (const Node *dir : layout.jolietDirs) {
+        Layout::Placement &place = layout.nodes[dir];
+        place.jolietSize         = PutDirRecords(layout.records(dir, entries_, true), time, nullptr);
+        place.jolietLba          = cursor;
+        cursor += place.jolietSize / kSectorSize;
+    }
+
+    // UDF file entries: directories first, each followed by its file identifiers, then the files
+    if (options.udf) {
+        uint32_t block    = cursor - layout.partitionStart;
+        uint32_t uniqueId = 16; // 0 is the root, 1-15 are reserved
+        for (const Node *dir : layout.isoDirs) {
+            layout.udfNodes.push_back(dir);
+            Layout::Placement &place = layout.nodes[dir];
+            place.uniqueId           = dir == root_.get() ? 0 : uniqueId++;
+            place.udfEntry           = block++;
+            uint32_t size            = 40; // parent entry
+            for (const Node *child : place.isoChildren)
+                size += static_cast<uint32_t>((38 + layout.at(child).udfId.size() + 3) & ~size_t(3));
+            place.udfDataSize  = size;
+            place.udfDataBlock = block;
+            block += Sectors(size);
+            ++layout.udfDirectories;
+        }
+        for (const Node *dir : layout.isoDirs) {
+            for (const Node *child : layout.at(dir).isoChildren) {
+                if (child->directory)
+                    continue;
+                layout.udfNodes.push_back(child);
+                Layout::Placement &place = layout.nodes[child];
+                place.uniqueId           = uniqueId++;
+                place.udfEntry           = block++;
+                ++layout.udfFiles;
+            }
+        }
+        layout.nextUniqueId = uniqueId;
+        cursor              = layout.partitionStart + block;
+    }
+
+    // File data, depth-first in ISO order like mastering tools write it
+    std::vector<const Node *> stack{root_.get()};
+    while (!stack.empty()) {
+        const Node *dir = stack.back();
+        stack.pop_back();
+        const Layout::Placement &place = layout.at(dir);
+        for (const Node *child : place.isoChildren) {
+            if (child->directory)
+                continue;
+            const uint64_t size         = entries_[child->entry].size;
+            layout.nodes[child].dataLba = size == 0 ? 0 : cursor;
+            cursor += Sectors(size);
+            layout.files.push_back(child);
+        }
+        for (auto it = place.isoChildren.rbegin(); it != place.isoChildren.rend(); ++it) {
+            if ((*it)->directory)
+                stack.push_back(*it);
+        }
+    }
+
+    if (options.udf) {
+        layout.partitionLength = cursor - layout.partitionStart;
+        ++cursor; // closing anchor in the last sector
+    }
+    layout.totalSectors = cursor;
+}
+
+uint64_t ISOImageWriter::imageSize(const Options &options) const {
+    Layout layout;
+    computeLayout(options, layout);
+    return static_cast<uint64_t>(layout.totalSectors) * kSectorSize;
+}
+
+bool ISOImageWriter::write(const std::string &imagePath, const Options &options, std::string *error) const {
+    auto fail = [&](const std::string &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+    for (const auto &entry : entries_) {
+        if (options.udf && entry.size > static_cast<uint64_t>(kMaxUdfExtent) * kMaxUdfExtents)
+            return fail("file too large for a single UDF file entry: " + entry.path);
+    }
+
+    Layout layout;
+    computeLayout(options, layout);
+    if (options.udf && layout.totalSectors <= kUdfAnchor)
+        return fail("internal layout error");
+
+    ImageStream out(options.sparse);
+    if (!out.open(imagePath))
+        return fail("cannot create " + imagePath);
+
+    const CivilTime      time  = ToCivil(options.timestamp);
+    const Node          *root  = root_.get();
+    auto                 place = [&](const Node *node) -> const Layout::Placement & { return layout.at(node); };
+    std::vector<uint8_t> sector(kSectorSize);
+    auto                 clear = [&]() { std::fill(sector.begin(), sector.end(), 0); };
+
+    // System area
+    if (options.hybridMbr) {
+        clear();
+        Put32(&sector[440], static_cast<uint32_t>(SplitMix64(static_cast<uint64_t>(options.timestamp))));
+        uint8_t *part = &sector[446];
+        part[0]       = 0x80;
+        part[2]       = 0x01;
+        part[4]       = 0x17;
+        part[5]       = 0xFE;
+        part[6]       = 0xFF;
+        part[7]       = 0xFF;
+        Put32(part + 12, static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(layout.totalSectors) * 4,
+                                                                  0xFFFFFFFFULL)));
+        sector[510] = 0x55;
+        sector[511] = 0xAA;
+        if (!out.writeSector(0, sector))
+            return fail("write error");
+    }
+
+    // Primary and Joliet volume descriptors
+    auto volumeDescriptor = [&](bool joliet) {
+        clear();
+        sector[0] = joliet ? 2 : 1;
+        std::memcpy(&sector[1], "CD001", 5);
+        sector[6] = 1;
+        if (joliet) {
+            PutPaddedUcs2(&sector[8], 32, "");
+            PutPaddedUcs2(&sector[40], 32, options.volumeLabel);
+            std::memcpy(&sector[88], "%/E", 3);
+        } else {
+            PutPadded(&sector[8], 32, "");
+            PutPadded(&sector[40], 32, ToDChars(DecodeUtf8(options.volumeLabel), 32));
+        }
+        PutBoth32(&sector[80], layout.totalSectors);
+        PutBoth16(&sector[120], 1);
+        PutBoth16(&sector[124], 1);
+        PutBoth16(&sector[128], kSectorSize);
+        PutBoth32(&sector[132], joliet ? layout.jolietPathSize : layout.isoPathSize);
+        Put32(&sector[140], joliet ? layout.jolietPathL : layout.isoPathL);
+        PutBe32(&sector[148], joliet ? layout.jolietPathM : layout.isoPathM);
+
+        const Layout::Placement &rp = place(root);
+        std::vector<DirRecord>   rootRecord{{joliet ? rp.jolietLba : rp.isoLba, joliet ? rp.jolietSize : rp.isoSize,
+                                             kFlagDirectory, std::string(1, '\0')}};
+        PutDirRecords(rootRecord, time, &sector[156]);
+
+        for (size_t field : {190, 318, 446, 574}) {
+            const std::string text = field == 190 ? options.volumeLabel : field == 574 ? kApplicationId : "";
+            if (joliet)
+                PutPaddedUcs2(&sector[field], 128, text);
+            else
+                PutPadded(&sector[field], 128, field == 190 ? ToDChars(DecodeUtf8(text), 128) : text);
+        }
+        for (size_t field : {702, 739, 776}) {
+            if (joliet)
+                PutPaddedUcs2(&sector[field], 37, "");
+            else
+                PutPadded(&sector[field], 37, "");
+        }
+        PutIsoVolumeDate(&sector[813], &time);
+        PutIsoVolumeDate(&sector[830], &time);
+        PutIsoVolumeDate(&sector[847], nullptr);
+        PutIsoVolumeDate(&sector[864], nullptr);
+        sector[881] = 1;
+        return out.writeSector(joliet ? layout.jolietVd : layout.primaryVd, sector);
+    };
+    if (!volumeDescriptor(false) || (options.joliet && !volumeDescriptor(true)))
+        return fail("write error");
+
+    clear();
+    sector[0] = 255;
+    std::memcpy(&sector[1], "CD001", 5);
+    sector[6] = 1;
+    if (!out.writeSector(layout.terminatorVd, sector))
+        return fail("write error");
+
+    // UDF volume structure
+    const uint32_t partitionEnd = layout.partitionStart + layout.partitionLength;
+    if (options.udf) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            static const char *const kVrs[] = {"BEA01", "NSR03", "TEA01"};
+            clear();
+            std::memcpy(&sector[1], kVrs[i], 5);
+            sector[6] = 1;
+            if (!out.writeSector(layout.terminatorVd + 1 + i, sector))
+                return fail("write error");
+        }
+
+        auto volumeSequence = [&](uint32_t start) {
+            std::vector<uint8_t> vds(kUdfVdsLength * kSectorSize, 0);
+
+            uint8_t *pvd = &vds[0];
+            Put32(pvd + 16, 1);
+            PutDString(pvd + 24, 32, options.volumeLabel);
+            Put16(pvd + 56, 1);
+            Put16(pvd + 58, 1);
+            Put16(pvd + 60, 2);
+            Put16(pvd + 62, 2);
+            Put32(pvd + 64, 1);
+            Put32(pvd + 68, 1);
+            char setId[17];
+            std::snprintf(setId, sizeof(setId), "%016llX",
+                          static_cast<unsigned long long>(SplitMix64(static_cast<uint64_t>(options.timestamp))));
+            PutDString(pvd + 72, 128, std::string(setId) + " " + options.volumeLabel);
+            PutCharspec(pvd + 200);
+            PutCharspec(pvd + 264);
+            PutRegId(pvd + 344, kUdfImplId);
+            PutUdfTimestamp(pvd + 376, time);
+            PutRegId(pvd + 388, kUdfImplId);
+            PutTag(pvd, 1, start, 512);
+
+            uint8_t *iuvd = &vds[kSectorSize];
+            Put32(iuvd + 16, 2);
+            PutRegId(iuvd + 20, "*UDF LV Info", 0x0201);
+            PutCharspec(iuvd + 52);
+            PutDString(iuvd + 116, 128, options.volumeLabel);
+            PutRegId(iuvd + 352, kUdfImplId);
+            PutTag(iuvd, 4, start + 1, 512);
+
+            uint8_t *pd = &vds[2 * kSectorSize];
+            Put32(pd + 16, 3);
+            Put16(pd + 20, 1); // allocated
+            PutRegId(pd + 24, "+NSR03");
+            Put32(pd + 184, 1); // read-only
+            Put32(pd + 188, layout.partitionStart);
+            Put32(pd + 192, layout.partitionLength);
+            PutRegId(pd + 196, kUdfImplId);
+            PutTag(pd, 5, start + 2, 512);
+
+            uint8_t *lvd = &vds[3 * kSectorSize];
+            Put32(lvd + 16, 4);
+            PutCharspec(lvd + 20);
+            PutDString(lvd + 84, 128, options.volumeLabel);
+            Put32(lvd + 212, kSectorSize);
+            PutRegId(lvd + 216, "*OSTA UDF Compliant", 0x0201);
+            Put32(lvd + 248, kSectorSize); // file set descriptor at partition block 0
+            PutRegId(lvd + 272, kUdfImplId);
+            Put32(lvd + 432, 2 * kSectorSize);
+            Put32(lvd + 436, kUdfIntegrity);
+            Put32(lvd + 264, 6);
+            Put32(lvd + 268, 1);
+            lvd[440] = 1;
+            lvd[441] = 6;
+            Put16(lvd + 442, 1);
+            Put16(lvd + 444, 0);
+            PutTag(lvd, 6, start + 3, 446);
+
+            uint8_t *usd = &vds[4 * kSectorSize];
+            Put32(usd + 16, 5);
+            PutTag(usd, 7, start + 4, 24);
+
+            PutTag(&vds[5 * kSectorSize], 8, start + 5, 512);
+            return out.writeSector(start, vds);
+        };
+        if (!volumeSequence(kUdfMainVds) || !volumeSequence(kUdfReserveVds))
+            return fail("write error");
+
+        std::vector<uint8_t> lvid(2 * kSectorSize, 0);
+        PutUdfTimestamp(&lvid[16], time);
+        Put32(&lvid[28], 1); // closed
+        Put64(&lvid[40], layout.nextUniqueId);
+        Put32(&lvid[72], 1);
+        Put32(&lvid[76], 46);
+        Put32(&lvid[80], 0); // free space
+        Put32(&lvid[84], layout.partitionLength);
+        PutRegId(&lvid[88], kUdfImplId);
+        Put32(&lvid[120], layout.udfFiles);
+        Put32(&lvid[124], layout.udfDirectories);
+        Put16(&lvid[128], 0x0201);
+        Put16(&lvid[130], 0x0201);
+        Put16(&lvid[132], 0x0201);
+        PutTag(&lvid[0], 9, kUdfIntegrity, 134);
+        PutTag(&lvid[kSectorSize], 8, kUdfIntegrity + 1, 512);
+        if (!out.writeSector(kUdfIntegrity, lvid))
+            return fail("write error");
+    }
+
+    auto anchor = [&](uint32_t lba) {
+        clear();
+        Put32(&sector[16], kUdfVdsLength * kSectorSize);
+        Put32(&sector[20], kUdfMainVds);
+        Put32(&sector[24], kUdfVdsLength * kSectorSize);
+        Put32(&sector[28], kUdfReserveVds);
+        PutTag(sector.data(), 2, lba, 512);
+        return out.writeSector(lba, sector);
+    };
+    if (options.udf && !anchor(kUdfAnchor))
+        return fail("write error");
+
+    // File set descriptor and its terminator open the partition
+    auto icb = [&](uint8_t *p, const Layout::Placement &target) {
+        Put32(p, kSectorSize);
+        Put32(p + 4, target.udfEntry);
+        Put32(p + 12, target.uniqueId); // UDF unique id in the implementation use bytes
+    };
+    if (options.udf) {
+        std::vector<uint8_t> fileSet(2 * kSectorSize, 0);
+        PutUdfTimestamp(&fileSet[16], time);
+        Put16(&fileSet[28], 3);
+        Put16(&fileSet[30], 3);
+        Put32(&fileSet[32], 1);
+        Put32(&fileSet[36], 1);
+        PutCharspec(&fileSet[48]);
+        PutDString(&fileSet[112], 128, options.volumeLabel);
+        PutCharspec(&fileSet[240]);
+        PutDString(&fileSet[304], 32, options.volumeLabel);
+        icb(&fileSet[400], place(root));
+        PutRegId(&fileSet[416], "*OSTA UDF Compliant", 0x0201);
+        PutTag(&fileSet[0], 256, 0, 512);
+        PutTag(&fileSet[kSectorSize], 8, 1, 512);
+        if (!out.writeSector(layout.partitionStart, fileSet))
+            return fail("write error");
+    }
+
+    // Path tables, little and big endian
+    auto pathTable = [&](const std::vector<const Node *> &dirs, bool joliet, bool bigEndian, uint32_t lba) {
+        std::vector<uint8_t> table(Sectors(joliet ? layout.jolietPathSize : layout.isoPathSize) * kSectorSize, 0);
+        size_t               offset = 0;
+        for (const Node *dir : dirs) {
+            const Layout::Placement &dp = place(dir);
+            const Layout::Placement &pp = place(dir == root ? dir : dir->parent);
+            const std::string        id = dir == root ? std::string(1, '\0') : (joliet ? dp.jolietId : dp.isoId);
+            const uint32_t           dl = joliet ? dp.jolietLba : dp.isoLba;
+            const uint32_t           pn = joliet ? pp.jolietNumber : pp.isoNumber;
+            uint8_t                 *p  = &table[offset];
+            p[0]                        = static_cast<uint8_t>(id.size());
+            if (bigEndian) {
+                PutBe32(p + 2, dl);
+                PutBe16(p + 6, pn);
+            } else {
+                Put32(p + 2, dl);
+                Put16(p + 6, pn);
+            }
+            std::memcpy(p + 8, id.data(), id.size());
+            offset += 8 + id.size() + (id.size() & 1);
+        }
+        return table.empty() || out.writeSector(lba, table);
+    };
+    if (!pathTable(layout.isoDirs, false, false, layout.isoPathL) ||
+        !pathTable(layout.isoDirs, false, true, layout.isoPathM))
+        return fail("write error");
+    if (options.joliet && (!pathTable(layout.jolietDirs, true, false, layout.jolietPathL) ||
+                           !pathTable(layout.jolietDirs, true, true, layout.jolietPathM)))
+        return fail("write error");
+
+    // Directory extents
+    auto directory = [&](const Node *dir, bool joliet) {
+        const Layout::Placement &dp = place(dir);
+        std::vector<uint8_t>     extent(joliet ? dp.jolietSize : dp.isoSize, 0);
+        PutDirRecords(layout.records(dir, entries_, joliet), time, extent.data());
+        return out.writeSector(joliet ? dp.jolietLba : dp.isoLba, extent);
+    };
+    for (const Node *dir : layout.isoDirs) {
+        if (!directory(dir, false))
+            return fail("write error");
+    }
+    for (const Node *dir : layout.jolietDirs) {
+        if (!directory(dir, true))
+            return fail("write error");
+    }
+
+    // UDF file entries, directories followed by their file identifiers
+    if (options.udf) {
+        const uint32_t base = layout.partitionStart;
+
+        auto fileEntry = [&](const Node *node) {
+            const Layout::Placement &np = place(node);
+            clear();
+            uint8_t *p = sector.data();
+            p[16 + 4]  = 4; // strategy 4
+            p[16 + 8]  = 1;
+            p[16 + 11] = node->directory ? 4 : 5;
+            Put32(p + 36, 0xFFFFFFFF);
+            Put32(p + 40, 0xFFFFFFFF);
+            Put32(p + 44, node->directory ? 0x14A5 : 0x1084);
+
+            uint16_t links = 1;
+            if (node->directory) {
+                for (const auto &child : node->children)
+                    links = static_cast<uint16_t>(links + (child->directory ? 1 : 0));
+            }
+            Put16(p + 48, links);
+
+            const uint64_t size  = node->directory ? np.udfDataSize : entries_[node->entry].size;
+            uint32_t       first = node->directory ? np.udfDataBlock : size == 0 ? 0 : np.dataLba - base;
+            Put64(p + 56, size);
+            Put64(p + 64, Sectors(size));
+            for (size_t field : {72, 84, 96})
+                PutUdfTimestamp(p + field, time);
+            Put32(p + 108, 1);
+            PutRegId(p + 128, kUdfImplId);
+            Put64(p + 160, np.uniqueId);
+
+            uint32_t adLength = 0;
+            for (uint64_t remaining = size; remaining > 0;) {
+                const uint32_t piece = static_cast<uint32_t>(std::min<uint64_t>(remaining, kMaxUdfExtent));
+                Put32(p + 176 + adLength, piece);
+                Put32(p + 180 + adLength, first);
+                first += Sectors(piece);
+                remaining -= piece;
+                adLength += 8;
+            }
+            Put32(p + 172, adLength);
+            PutTag(p, 261, np.udfEntry, 176 + adLength);
+            return out.writeSector(base + np.udfEntry, sector);
+        };
+
+        auto identifiers = [&](const Node *dir) {
+            const Layout::Placement &dp = place(dir);
+            std::vector<uint8_t>     data(Sectors(dp.udfDataSize) * kSectorSize, 0);
+            size_t                   offset = 0;
+
+            auto fid = [&](uint8_t characteristics, const Layout::Placement &target, const std::string &id) {
+                uint8_t     *p      = &data[offset];
+                const size_t length = (38 + id.size() + 3) & ~size_t(3);
+                Put16(p + 16, 1);
+                p[18] = characteristics;
+                p[19] = static_cast<uint8_t>(id.size());
+                icb(p + 20, target);
+                std::memcpy(p + 38, id.data(), id.size());
+                PutTag(p, 257, dp.udfDataBlock + static_cast<uint32_t>(offset / kSectorSize), length);
+                offset += length;
+            };
+            fid(0x0A, place(dir == root ? dir : dir->parent), std::string()); // parent
+            for (const Node *child : dp.isoChildren)
+                fid(child->directory ? 0x02 : 0x00, place(child), place(child).udfId);
+            return out.writeSector(base + dp.udfDataBlock, data);
+        };
+
+        for (const Node *node : layout.udfNodes) {
+            if (!fileEntry(node) || (node->directory && !identifiers(node)))
+                return fail("write error");
+        }
+    }
+
+    // File data
+    std::vector<uint8_t> buffer(kWriteChunk);
+    for (const Node *node : layout.files) {
+        const Entry &entry = entries_[node->entry];
+        if (entry.size == 0)
+            continue;
+        if (!out.moveTo(static_cast<uint64_t>(place(node).dataLba) * kSectorSize))
+            return fail("write error");
+        if (entry.content == Content::Zero && options.sparse)
+            continue; // the next moveTo leaves the hole
+        for (uint64_t done = 0; done < entry.size;) {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(entry.size - done, buffer.size()));
+            fillContent(entry, done, buffer.data(), n);
+            if (!out.write(buffer.data(), n))
+                return fail("write error");
+            done += n;
+        }
+    }
+
+    if (options.udf && !anchor(partitionEnd))
+        return fail("write error");
+    if (!out.finish(static_cast<uint64_t>(layout.totalSectors) * kSectorSize))
+        return fail("write error");
+    return true;
+}
+
+// ---------- layouts ----------
+
+bool ParseISOSize(const std::string &text, uint64_t &bytes) {
+    if (text.empty())
+        return false;
+    size_t   used  = 0;
+    uint64_t value = 0;
+    try {
+        value = std::stoull(text, &used);
+    } catch (...) {
+        return false;
+    }
+    const std::string suffix = text.substr(used);
+    unsigned          shift  = 0;
+    if (suffix == "k" || suffix == "K")
+        shift = 10;
+    else if (suffix == "m" || suffix == "M")
+        shift = 20;
+    else if (suffix == "g" || suffix == "G")
+        shift = 30;
+    else if (!suffix.empty())
+        return false;
+    bytes = value << shift;
+    return true;
+}
+
+bool ISOSizeDistribution::parse(const std::string &spec, ISOSizeDistribution &out) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos)
+        return false;
+    const std::string kind  = spec.substr(0, colon);
+    const std::string range = spec.substr(colon + 1);
+    ISOSizeDistribution result;
+    if (kind == "fixed") {
+        result.kind = Kind::Fixed;
+        if (!ParseISOSize(range, result.min))
+            return false;
+        result.max = result.min;
+    } else {
+        if (kind == "uniform")
+            result.kind = Kind::Uniform;
+        else if (kind == "log")
+            result.kind = Kind::LogUniform;
+        else
+            return false;
+        const size_t dash = range.find('-');
+        if (dash == std::string::npos || !ParseISOSize(range.substr(0, dash), result.min) ||
+            !ParseISOSize(range.substr(dash + 1), result.max) || result.min > result.max)
+            return false;
+    }
+    out = result;
+    return true;
+}
+
+namespace {
+// FNV-1a: seeds derived from paths must not depend on the standard library
+uint64_t HashPath(const std::string &path) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (unsigned char c : path)
+        hash = (hash ^ c) * 0x100000001B3ULL;
+    return hash;
+}
+
+ISOImageWriter::Content ContentFor(const std::string &path) {
+    return IsExecutableName(path) ? ISOImageWriter::Content::PE : ISOImageWriter::Content::Random;
+}
+
+uint64_t DrawSize(const ISOSizeDistribution &sizes, Rng &rng) {
+    switch (sizes.kind) {
+    case ISOSizeDistribution::Kind::Fixed:
+        return sizes.min;
+    case ISOSizeDistribution::Kind::Uniform:
+        return sizes.min + rng.below(sizes.max - sizes.min + 1);
+    case ISOSizeDistribution::Kind::LogUniform:
+        break;
+    }
+    const double lo = std::log(static_cast<double>(std::max<uint64_t>(sizes.min, 1)));
+    const double hi = std::log(static_cast<double>(std::max<uint64_t>(sizes.max, 1)));
+    const auto   v  = static_cast<uint64_t>(std::exp(lo + (hi - lo) * rng.unit()));
+    return std::min(std::max(v, sizes.min), sizes.max);
+}
+
+std::string RandomName(Rng &rng, size_t index, bool unicode) {
+    static const char *const kSyllables[] = {"win", "dow", "set", "up", "boot", "mgr", "core", "net", "drv",
+                                             "sys", "lib", "font", "loc", "img", "pkg", "res", "cat", "data"};
+    static const char *const kUnicode[]   = {"données", "ñandú", "Übersicht", "файл", "ドライバ", "驱动", "αρχείο"};
+    std::string              name;
+    if (unicode && rng.below(4) == 0) {
+        name = kUnicode[rng.below(sizeof(kUnicode) / sizeof(kUnicode[0]))];
+    } else {
+        const uint64_t parts = 1 + rng.below(3);
+        for (uint64_t i = 0; i < parts; ++i)
+            name += kSyllables[rng.below(sizeof(kSyllables) / sizeof(kSyllables[0]))];
+    }
+    return name + "_" + std::to_string(index);
+}
+
+std::string PickExtension(Rng &rng) {
+    static const char *const kExtensions[] = {"bin", "dat", "txt", "dll", "inf", "cab", "mui", "cat", "xml", "efi"};
+    return kExtensions[rng.below(sizeof(kExtensions) / sizeof(kExtensions[0]))];
+}
+
+void AddFiles(ISOImageWriter &writer, Rng &rng, const std::string &dir, const std::string &stem,
+              const std::string &ext, size_t count, const ISOSizeDistribution &sizes, uint64_t seed) {
+    for (size_t i = 0; i < count; ++i) {
+        const std::string path = dir + "/" + stem + std::to_string(i) + "." + ext;
+        writer.addFile(path, DrawSize(sizes, rng), SplitMix64(seed ^ HashPath(path)), ContentFor(path));
+    }
+}
+} // namespace
+
+void AddRandomLayout(ISOImageWriter &writer, const ISORandomLayout &layout) {
+    Rng rng(layout.seed);
+
+    struct Dir {
+        std::string path;
+        unsigned    depth;
+    };
+    std::vector<Dir> dirs{{"", 0}};
+    const size_t     dirCount = std::max<size_t>(1, layout.fileCount / std::max<size_t>(1, layout.filesPerDir));
+    for (size_t i = 1; i < dirCount && layout.maxDepth > 0; ++i) {
+        const Dir *parent = &dirs[rng.below(dirs.size())];
+        for (int tries = 0; parent->depth >= layout.maxDepth && tries < 8; ++tries)
+            parent = &dirs[rng.below(dirs.size())];
+        if (parent->depth >= layout.maxDepth)
+            parent = &dirs[0];
+        Dir dir{(parent->path.empty() ? "" : parent->path + "/") + RandomName(rng, i, layout.unicodeNames),
+                parent->depth + 1};
+        writer.addDirectory(dir.path);
+        dirs.push_back(std::move(dir));
+    }
+
+    for (size_t i = 0; i < layout.fileCount; ++i) {
+        const Dir        &dir  = dirs[rng.below(dirs.size())];
+        const std::string name = RandomName(rng, i, layout.unicodeNames) + "." + PickExtension(rng);
+        const std::string path = dir.path.empty() ? name : dir.path + "/" + name;
+        writer.addFile(path, DrawSize(layout.sizes, rng), SplitMix64(layout.seed * 0x100000001B3ULL + i),
+                       ContentFor(path));
+    }
+}
+
+void AddWindowsLayout(ISOImageWriter &writer, uint64_t installWimSize, uint64_t seed) {
+    Rng  rng(seed);
+    auto add = [&](const std::string &path, uint64_t size) {
+        writer.addFile(path, size, SplitMix64(seed ^ HashPath(path)), ContentFor(path));
+    };
+
+    writer.addFile("autorun.inf", "[AutoRun.Amd64]\r\nopen=setup.exe\r\nicon=setup.exe,0\r\n\r\n[AutoRun]\r\n"
+                                  "open=sources\\SetupError.exe x64\r\nicon=sources\\SetupError.exe,0\r\n");
+    add("bootmgr", 413738);
+    add("bootmgr.efi", 2539320);
+    add("setup.exe", 99624);
+
+    add("boot/bcd", 16384);
+    add("boot/boot.sdi", 3170304);
+    add("boot/bootfix.bin", 1024);
+    add("boot/bootsect.exe", 119608);
+    add("boot/etfsboot.com", 4096);
+    add("boot/memtest.exe", 1224000);
+    add("boot/en-us/bootsect.exe.mui", 17248);
+    AddFiles(writer, rng, "boot/fonts", "font", "ttf", 12, {ISOSizeDistribution::Kind::LogUniform, 16u << 10, 4u << 20},
+             seed);
+
+    add("efi/boot/bootx64.efi", 2555696);
+    add("efi/microsoft/boot/bcd", 16384);
+    add("efi/microsoft/boot/cdboot.efi", 1572352);
+    add("efi/microsoft/boot/efisys.bin", 1474560);
+    add("efi/microsoft/boot/efisys_noprompt.bin", 1474560);
+    AddFiles(writer, rng, "efi/microsoft/boot/fonts", "font", "ttf", 8,
+             {ISOSizeDistribution::Kind::LogUniform, 16u << 10, 4u << 20}, seed);
+
+    // The WIMs dominate the image; boot.wim scales with install.wim so small test images stay small
+    add("sources/boot.wim", std::min<uint64_t>(std::max<uint64_t>(installWimSize / 8, 1u << 20), 640ULL << 20));
+    add("sources/install.wim", installWimSize);
+    add("sources/setup.exe", 317000);
+    add("sources/setupprep.exe", 1103000);
+    AddFiles(writer, rng, "sources", "setup", "dll", 240, {ISOSizeDistribution::Kind::LogUniform, 4u << 10, 256u << 10},
+             seed);
+    AddFiles(writer, rng, "sources", "component", "inf", 40, {ISOSizeDistribution::Kind::LogUniform, 512, 32u << 10},
+             seed);
+    AddFiles(writer, rng, "sources/en-us", "setup", "dll.mui", 120,
+             {ISOSizeDistribution::Kind::LogUniform, 2u << 10, 64u << 10}, seed);
+    AddFiles(writer, rng, "sources/dlmanifests", "manifest", "man", 60,
+             {ISOSizeDistribution::Kind::LogUniform, 512, 16u << 10}, seed);
+    AddFiles(writer, rng, "support/logging", "logging", "dll", 6,
+             {ISOSizeDistribution::Kind::LogUniform, 16u << 10, 256u << 10}, seed);
+}
+
+void AddLinuxLayout(ISOImageWriter &writer, uint64_t squashfsSize, uint64_t seed) {
+    Rng  rng(seed);
+    auto add = [&](const std::string &path, uint64_t size) {
+        writer.addFile(path, size, SplitMix64(seed ^ HashPath(path)), ContentFor(path));
+    };
+
+    writer.addFile(".disk/info", "Ubuntu 24.04 LTS \"Noble Numbat\" - Release amd64 (20240424)");
+    writer.addFile("boot/grub/grub.cfg", "set timeout=30\n\nloadfont unicode\n\nmenuentry \"Try or Install Ubuntu\" {\n"
+                                         "\tset gfxpayload=keep\n\tlinux\t/casper/vmlinuz  --- quiet splash\n"
+                                         "\tinitrd\t/casper/initrd\n}\n");
+    writer.addFile("isolinux/isolinux.cfg", "default vesamenu.c32\ntimeout 300\ninclude txt.cfg\n");
+    add("md5sum.txt", 36864);
+
+    add("boot/grub/fonts/unicode.pf2", 2392304);
+    add("boot/grub/i386-pc/eltorito.img", 30720);
+    AddFiles(writer, rng, "boot/grub/x86_64-efi", "module", "mod", 280,
+             {ISOSizeDistribution::Kind::LogUniform, 1u << 10, 64u << 10}, seed);
+    AddFiles(writer, rng, "boot/grub/i386-pc", "module", "mod", 200,
+             {ISOSizeDistribution::Kind::LogUniform, 1u << 10, 48u << 10}, seed);
+
+    // Kernel and initrd scale with the squashfs so small test images stay small
+    add("casper/vmlinuz.efi", std::min<uint64_t>(std::max<uint64_t>(squashfsSize / 200, 64u << 10), 14u << 20));
+    add("casper/initrd", std::min<uint64_t>(std::max<uint64_t>(squashfsSize / 50, 256u << 10), 64u << 20));
+    add("casper/filesystem.squashfs", squashfsSize);
+    add("casper/filesystem.manifest", 61440);
+    writer.addFile("casper/filesystem.size", std::to_string(squashfsSize * 3) + "\n");
+
+    add("efi/boot/bootx64.efi", 966664);
+    add("efi/boot/grubx64.efi", 2320264);
+    add("efi/boot/mmx64.efi", 856280);
+
+    add("isolinux/isolinux.bin", 40960);
+    add("isolinux/ldlinux.c32", 119520);
+    AddFiles(writer, rng, "isolinux", "menu", "c32", 16, {ISOSizeDistribution::Kind::LogUniform, 4u << 10, 192u << 10},
+             seed);
+
+    static const char *const kPackages[] = {"grub-efi-amd64", "shim-signed", "linux-generic", "mokutil",
+                                            "efibootmgr",     "os-prober",   "cryptsetup",    "lvm2"};
+    for (size_t i = 0; i < 200; ++i) {
+        const std::string package = kPackages[i % (sizeof(kPackages) / sizeof(kPackages[0]))];
+        const std::string path    = "pool/main/" + package.substr(0, 1) + "/" + package + "/" + package + "_" +
+                                 std::to_string(i) + ".0_amd64.deb";
+        add(path, DrawSize({ISOSizeDistribution::Kind::LogUniform, 8u << 10, 512u << 10}, rng));
+    }
+}
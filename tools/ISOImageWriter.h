@@ -0,0 +1,119 @@
+#ifndef ISOIMAGEWRITER_H
+#define ISOIMAGEWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Builds synthetic optical images for tests and benchmarks: an ISO9660 tree (with an optional Joliet
+// tree) and an optional UDF 2.01 bridge that shares the file data, laid out the way mastering tools
+// lay out Windows and Linux installation media. File contents are generated from a per-file seed, so
+// a test can recompute the expected bytes of any range without keeping a copy (see fillContent).
+// Everything is deterministic: the same entries and options give a byte-identical image.
+class ISOImageWriter {
+public:
+    enum class Content {
+        Random, // pseudo-random bytes derived from the entry seed
+        PE,     // a minimal PE32+ header followed by pseudo-random bytes (.efi, .exe, .dll)
+        Zero,   // zeros; written as a hole when Options::sparse is set
+        Literal // the bytes given to addFile
+    };
+
+    struct Entry {
+        std::string path; // UTF-8, '/' separators, relative to the root
+        uint64_t    size    = 0;
+        uint64_t    seed    = 0;
+        Content     content = Content::Random;
+        std::string literal;
+    };
+
+    struct Options {
+        std::string volumeLabel = "BTISO_TEST";
+        bool        joliet      = true;
+        bool        udf         = true;
+
+        // Protective MBR in the system area with one partition spanning the image, as isohybrid and
+        // xorriso write it, so the image can also be dd'ed to a USB stick
+        bool hybridMbr = false;
+
+        // Leave Zero entries (and the gaps between structures) as holes instead of writing them out
+        bool sparse = false;
+
+        // Recording time stamped on every structure; fixed so images are reproducible
+        std::time_t timestamp = 1704067200; // 2024-01-01 00:00:00 UTC
+    };
+
+    ISOImageWriter();
+    ~ISOImageWriter();
+    ISOImageWriter(const ISOImageWriter &)            = delete;
+    ISOImageWriter &operator=(const ISOImageWriter &) = delete;
+
+    // Parent directories are created implicitly; adding a path twice replaces the earlier entry
+    void addDirectory(const std::string &path);
+    void addFile(const std::string &path, uint64_t size, uint64_t seed, Content content = Content::Random);
+    void addFile(const std::string &path, const std::string &literal);
+
+    // Files added so far, in the order they were added
+    const std::vector<Entry> &entries() const;
+    size_t                    directoryCount() const;
+
+    // Writes the image; on failure error (if given) describes what went wrong
+    bool write(const std::string &imagePath, const Options &options, std::string *error = nullptr) const;
+
+    // Size of the image write() produces for options, in bytes
+    uint64_t imageSize(const Options &options) const;
+
+    // The bytes [offset, offset + length) of a generated entry, as written to the image
+    static void fillContent(const Entry &entry, uint64_t offset, void *buffer, size_t length);
+
+private:
+    struct Node;
+    struct Layout;
+
+    Node *findOrCreate(const std::string &path, bool directory);
+    void  computeLayout(const Options &options, Layout &layout) const;
+
+    std::unique_ptr<Node> root_;
+    std::vector<Entry>    entries_;
+    size_t                directories_ = 0;
+};
+
+// "4096", "64k", "2m", "5g" (binary multiples); false if text is not a size
+bool ParseISOSize(const std::string &text, uint64_t &bytes);
+
+// How file sizes of a generated layout are drawn
+struct ISOSizeDistribution {
+    enum class Kind { Fixed, Uniform, LogUniform };
+    Kind     kind = Kind::LogUniform;
+    uint64_t min  = 512;
+    uint64_t max  = 1u << 20;
+
+    // "fixed:4k", "uniform:1k-64k", "log:512-1g"; false if spec is malformed
+    static bool parse(const std::string &spec, ISOSizeDistribution &out);
+};
+
+struct ISORandomLayout {
+    size_t              fileCount    = 1000;
+    unsigned            maxDepth     = 4;
+    size_t              filesPerDir  = 16; // average, decides how many directories are created
+    ISOSizeDistribution sizes;
+    bool                unicodeNames = false; // some names outside Latin-1, to exercise Joliet/UDF naming
+    uint64_t            seed         = 1;
+};
+
+// Populates writer with a tree of randomly named files and directories
+void AddRandomLayout(ISOImageWriter &writer, const ISORandomLayout &layout);
+
+// A Windows installation medium: bootmgr, boot/, efi/boot/bootx64.efi, efi/microsoft/boot/,
+// sources/boot.wim, sources/install.wim (installWimSize; above 4 GiB it needs multi-extent records)
+// and a few hundred small setup files under sources/ and support/
+void AddWindowsLayout(ISOImageWriter &writer, uint64_t installWimSize, uint64_t seed = 1);
+
+// A Linux live medium: casper/ (kernel, initrd, a large squashfs), boot/grub/ with its modules,
+// efi/boot/, isolinux/ and a package pool of many small files
+void AddLinuxLayout(ISOImageWriter &writer, uint64_t squashfsSize, uint64_t seed = 1);
+
+#endif // ISOIMAGEWRITER_H
@@ -0,0 +1,726 @@
+/**
+ * Benchmark de ISOReader
+ *
+ * Genera (o reutiliza) imágenes de prueba con ISOImageWriter y mide, para una distribución con muchos
+ * archivos pequeños y otra dominada por archivos grandes:
+ * - latencia de apertura de la imagen
+ * - listado completo (entradas/s)
+ * - latencia de búsqueda de rutas (aciertos, variantes de mayúsculas y fallos)
+ * - extracción completa (MB/s y archivos/s), verificando cantidad y tamaño de lo extraído
+ * - pico de memoria residente del proceso
+ *
+ * El resultado es JSON, para poder comparar ejecuciones a lo largo del tiempo. En Windows se mide
+ * ISOSession; en el resto de plataformas (donde ISOReader.cpp no compila, porque usa Win32) se miden los
+ * mismos handlers Udf/Iso de 7-Zip y el mismo índice ISOCatalog sobre los que está construida ISOSession.
+ */
+
+#include "ISOImageWriter.h"
+
+#ifdef _WIN32
+#include "models/ISOReader.h"
+
+#include <windows.h>
+#include <psapi.h>
+#else
+#include "models/ISOCatalog.h"
+
+#include <sys/resource.h>
+
+#include "7zip/Archive/IArchive.h"
+#include "7zip/Common/FileStreams.h"
+#include "7zip/PropID.h"
+#include "Common/MyCom.h"
+#include "Common/UTFConvert.h"
+#include "Windows/PropVariant.h"
+
+// Functions exported by ArchiveExports.cpp (linked statically)
+STDAPI CreateArchiver(const GUID *clsid, const GUID *iid, void **outObject);
+STDAPI GetNumberOfFormats(UInt32 *numFormats);
+STDAPI GetHandlerProperty2(UInt32 formatIndex, PROPID propID, PROPVARIANT *value);
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double ElapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+#ifdef _WIN32
+// ISOSession, the reader the application uses
+class ImageUnderTest {
+public:
+    static const char *readerName() {
+        return "ISOSession";
+    }
+
+    bool open(const std::string &isoPath) {
+        session_ = ISOSession::open(isoPath);
+        return session_ != nullptr;
+    }
+    void close() {
+        session_.reset();
+    }
+    std::vector<std::string> list() {
+        return session_->listFiles();
+    }
+    bool exists(const std::string &path) {
+        return session_->fileExists(path);
+    }
+    bool extractAll(const std::string &destDir) {
+        return session_->extractAll(destDir);
+    }
+
+private:
+    std::shared_ptr<ISOSession> session_;
+};
+
+uint64_t PeakRssKb() {
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize) / 1024;
+}
+#else
+std::string BstrToUtf8(const PROPVARIANT &prop) {
+    AString utf8;
+    ConvertUnicodeToUTF8(UString(prop.bstrVal), utf8);
+    return std::string(utf8.Ptr(), utf8.Len());
+}
+
+bool FindHandlerClsid(const wchar_t *wantName, GUID &clsidOut) {
+    UInt32 num = 0;
+    if (GetNumberOfFormats(&num) != S_OK)
+        return false;
+    for (UInt32 i = 0; i < num; ++i) {
+        NWindows::NCOM::CPropVariant prop;
+        if (GetHandlerProperty2(i, NArchive::NHandlerPropID::kName, &prop) != S_OK || prop.vt != VT_BSTR ||
+            !prop.bstrVal || std::wstring(prop.bstrVal) != wantName)
+            continue;
+        prop.Clear();
+        if (GetHandlerProperty2(i, NArchive::NHandlerPropID::kClassID, &prop) == S_OK && prop.vt == VT_BSTR &&
+            prop.bstrVal && SysStringByteLen(prop.bstrVal) == sizeof(GUID)) {
+            memcpy(&clsidOut, prop.bstrVal, sizeof(GUID));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Writes every extracted item under baseDir, one COutFileStream per file
+class ExtractCallback : public IArchiveExtractCallback {
+public:
+    ExtractCallback(IInArchive *archive, const std::filesystem::path &baseDir)
+        : _ref(1), _archive(archive), _baseDir(baseDir) {
+    }
+
+    // IUnknown
+    STDMETHOD(QueryInterface)(REFIID riid, void **ppvObject) override {
+        if (!ppvObject)
+            return E_INVALIDARG;
+        *ppvObject = nullptr;
+        if (riid == IID_IUnknown || riid == IID_IArchiveExtractCallback || riid == IID_IProgress) {
+            *ppvObject = static_cast<IArchiveExtractCallback *>(this);
+            AddRef();
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    STDMETHOD_(ULONG, AddRef)() override {
+        return ++_ref;
+    }
+    STDMETHOD_(ULONG, Release)() override {
+        const ULONG r = --_ref;
+        if (r == 0)
+            delete this;
+        return r;
+    }
+
+    // IProgress
+    STDMETHOD(SetTotal)(UInt64) Z7_COM7F_E override {
+        return S_OK;
+    }
+    STDMETHOD(SetCompleted)(const UInt64 *) Z7_COM7F_E override {
+        return S_OK;
+    }
+
+    // IArchiveExtractCallback
+    STDMETHOD(GetStream)(UInt32 index, ISequentialOutStream **outStream, Int32 askExtractMode) Z7_COM7F_E override {
+        if (!outStream)
+            return E_INVALIDARG;
+        *outStream = nullptr;
+        if (askExtractMode != NArchive::NExtract::NAskMode::kExtract)
+            return S_OK;
+
+        NWindows::NCOM::CPropVariant prop;
+        std::string                  relPath;
+        if (_archive->GetProperty(index, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal)
+            relPath = BstrToUtf8(prop);
+        prop.Clear();
+        bool isDir = false;
+        if (_archive->GetProperty(index, kpidIsDir, &prop) == S_OK && prop.vt == VT_BOOL)
+            isDir = prop.boolVal != VARIANT_FALSE;
+
+        std::error_code             ec;
+        const std::filesystem::path outPath = _baseDir / std::filesystem::u8path(relPath);
+        if (isDir) {
+            std::filesystem::create_directories(outPath, ec);
+            return S_OK;
+        }
+        std::filesystem::create_directories(outPath.parent_path(), ec);
+
+        COutFileStream                 *fileSpec = new COutFileStream();
+        CMyComPtr<ISequentialOutStream> out      = fileSpec;
+        if (!fileSpec->Create(outPath.c_str(), true)) {
+            _failed = true;
+            return S_OK;
+        }
+        *outStream = out.Detach();
+        return S_OK;
+    }
+    STDMETHOD(PrepareOperation)(Int32) Z7_COM7F_E override {
+        return S_OK;
+    }
+    STDMETHOD(SetOperationResult)(Int32 opRes) Z7_COM7F_E override {
+        if (opRes != NArchive::NExtract::NOperationResult::kOK)
+            _failed = true;
+        return S_OK;
+    }
+
+    bool failed() const {
+        return _failed;
+    }
+
+private:
+    virtual ~ExtractCallback() = default;
+
+    ULONG                 _ref;
+    IInArchive           *_archive;
+    std::filesystem::path _baseDir;
+    bool                  _failed = false;
+};
+
+// ISOReader.cpp is written against Win32, so elsewhere this drives the pieces ISOSession is built on the
+// way ISOSession drives them: the Udf handler (Iso as fallback) over the image, every item interned once
+// into an ISOCatalog that answers lookups, and one Extract call over all items in physical order
+class ImageUnderTest {
+public:
+    static const char *readerName() {
+        return "7-Zip Udf/Iso + ISOCatalog";
+    }
+
+    bool open(const std::string &isoPath) {
+        close();
+        CInFileStream       *fileSpec = new CInFileStream();
+        CMyComPtr<IInStream> file     = fileSpec;
+        if (!fileSpec->Open(std::filesystem::u8path(isoPath).c_str()))
+            return false;
+
+        const UInt64 kMaxCheckStartPosition = 1 << 20;
+        for (const wchar_t *handler : {L"Udf", L"Iso"}) {
+            GUID                  clsid{};
+            CMyComPtr<IInArchive> archive;
+            if (!FindHandlerClsid(handler, clsid) ||
+                CreateArchiver(&clsid, &IID_IInArchive, reinterpret_cast<void **>(&archive)) != S_OK || !archive)
+                continue;
+            if (archive->Open(file, &kMaxCheckStartPosition, nullptr) == S_OK) {
+                archive_ = archive;
+                break;
+            }
+        }
+        if (!archive_ || archive_->GetNumberOfItems(&numItems_) != S_OK)
+            return false;
+
+        catalog_.reserve(numItems_);
+        for (UInt32 i = 0; i < numItems_; ++i) {
+            NWindows::NCOM::CPropVariant prop;
+            std::string                  path;
+            if (archive_->GetProperty(i, kpidPath, &prop) == S_OK && prop.vt == VT_BSTR && prop.bstrVal)
+                path = BstrToUtf8(prop);
+            prop.Clear();
+            if (path.empty())
+                continue;
+            bool isDir = false;
+            if (archive_->GetProperty(i, kpidIsDir, &prop) == S_OK && prop.vt == VT_BOOL)
+                isDir = prop.boolVal != VARIANT_FALSE;
+            prop.Clear();
+            UInt64 size = 0;
+            if (archive_->GetProperty(i, kpidSize, &prop) == S_OK && prop.vt == VT_UI8)
+                size = prop.uhVal.QuadPart;
+            prop.Clear();
+            UInt64 offset = ISOCatalog::kNoOffset;
+            if (archive_->GetProperty(i, kpidOffset, &prop) == S_OK && prop.vt == VT_UI8)
+                offset = prop.uhVal.QuadPart;
+            catalog_.add(path, size, isDir, i, offset);
+        }
+        return true;
+    }
+
+    void close() {
+        if (archive_)
+            archive_->Close();
+        archive_.Release();
+        catalog_.clear();
+        numItems_ = 0;
+    }
+
+    std::vector<std::string> list() {
+        std::vector<std::string> files;
+        files.reserve(numItems_);
+        for (UInt32 i = 0; i < numItems_; ++i) {
+            const uint32_t entry = catalog_.byArchiveIndex(i);
+            if (entry != ISOCatalog::kNone)
+                files.emplace_back(catalog_.fullPath(entry));
+        }
+        return files;
+    }
+
+    bool exists(const std::string &path) {
+        const uint32_t entry = catalog_.find(path);
+        return entry != ISOCatalog::kNone && catalog_.entry(entry).archiveIndex != ISOCatalog::kNone;
+    }
+
+    bool extractAll(const std::string &destDir) {
+        std::vector<UInt32> indices(numItems_);
+        for (UInt32 i = 0; i < numItems_; ++i)
+            indices[i] = i;
+        auto offsetOf = [this](UInt32 archiveIndex) {
+            const uint32_t entry = catalog_.byArchiveIndex(archiveIndex);
+            return entry == ISOCatalog::kNone ? ISOCatalog::kNoOffset : catalog_.entry(entry).offset;
+        };
+        std::sort(indices.begin(), indices.end(), [&](UInt32 a, UInt32 b) {
+            const uint64_t offsetA = offsetOf(a);
+            const uint64_t offsetB = offsetOf(b);
+            return offsetA != offsetB ? offsetA < offsetB : a < b;
+        });
+
+        ExtractCallback                   *spec = new ExtractCallback(archive_, std::filesystem::u8path(destDir));
+        CMyComPtr<IArchiveExtractCallback> cb;
+        cb.Attach(spec); // adopt the constructor's reference
+        const HRESULT result = archive_->Extract(indices.data(), numItems_, 0, cb);
+        return result == S_OK && !spec->failed();
+    }
+
+private:
+    CMyComPtr<IInArchive> archive_;
+    ISOCatalog            catalog_;
+    UInt32                numItems_ = 0;
+};
+
+uint64_t PeakRssKb() {
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024; // bytes on macOS, KiB elsewhere
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+}
+#endif
+
+struct Summary {
+    double min    = 0;
+    double median = 0;
+    double max    = 0;
+};
+
+Summary Summarize(std::vector<double> values) {
+    Summary summary;
+    if (values.empty())
+        return summary;
+    std::sort(values.begin(), values.end());
+    summary.min    = values.front();
+    summary.max    = values.back();
+    const size_t middle = values.size() / 2;
+    summary.median      = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    return summary;
+}
+
+// Nearest-rank percentile of sorted values, q in [0, 1]
+double Percentile(const std::vector<double> &sorted, double q) {
+    if (sorted.empty())
+        return 0;
+    const size_t rank = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+std::string JsonString(const std::string &text) {
+    std::string out = "\"";
+    for (const char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(ch));
+            out += escaped;
+        } else {
+            out += ch;
+        }
+    }
+    return out + "\"";
+}
+
+std::string JsonNumber(double value, int decimals = 3) {
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(decimals);
+    out << value;
+    return out.str();
+}
+
+std::string JsonSummary(const Summary &summary) {
+    return "{\"min\": " + JsonNumber(summary.min) + ", \"median\": " + JsonNumber(summary.median) +
+           ", \"max\": " + JsonNumber(summary.max) + "}";
+}
+
+std::string UtcTimestamp() {
+    const std::time_t now = std::time(nullptr);
+    std::tm           utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return text;
+}
+
+struct Settings {
+    std::filesystem::path workDir = std::filesystem::temp_directory_path() / "BenchISOReader";
+    std::string           outputPath;
+    std::string           only;
+    unsigned              iterations = 3;
+    size_t                smallFiles = 20000;
+    uint64_t              largeSize  = 1ULL << 30;
+    size_t                lookups    = 20000;
+    bool                  regenerate = false;
+};
+
+// A fixture image and what the benchmark expects to find in it
+struct Fixture {
+    std::string                     name;
+    std::string                     description;
+    std::unique_ptr<ISOImageWriter> writer = std::make_unique<ISOImageWriter>();
+    std::filesystem::path           imagePath;
+    uint64_t                        imageBytes = 0;
+    uint64_t                        dataBytes  = 0;
+    double                          generateMs = 0; // 0 when an existing image was reused
+};
+
+bool PrepareImage(Fixture &fixture, const Settings &settings) {
+    const ISOImageWriter::Options options;
+    fixture.imagePath  = settings.workDir / (fixture.name + ".iso");
+    fixture.imageBytes = fixture.writer->imageSize(options);
+    for (const auto &entry : fixture.writer->entries())
+        fixture.dataBytes += entry.size;
+
+    // The generator is deterministic, so an image of the expected size was written from the same entries
+    std::error_code ec;
+    if (!settings.regenerate && std::filesystem::file_size(fixture.imagePath, ec) == fixture.imageBytes && !ec)
+        return true;
+
+    std::cerr << "Generando " << fixture.imagePath.string() << " (" << (fixture.imageBytes >> 20) << " MB)...\n";
+    const auto  start = Clock::now();
+    std::string error;
+    if (!fixture.writer->write(fixture.imagePath.string(), options, &error)) {
+        std::cerr << "Error: " << error << "\n";
+        return false;
+    }
+    fixture.generateMs = ElapsedMs(start);
+    return true;
+}
+
+// Paths to look up: listed paths, the same paths in upper case (lookups are case-insensitive) and paths
+// that do not exist, shuffled with a fixed seed so every run issues the same sequence
+struct LookupQuery {
+    std::string path;
+    bool        expected;
+};
+
+std::vector<LookupQuery> MakeQueries(const std::vector<std::string> &listed, size_t count) {
+    std::vector<LookupQuery> queries;
+    if (listed.empty())
+        return queries;
+    std::mt19937_64 rng(42);
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string path = listed[rng() % listed.size()];
+        switch (i % 4) {
+        case 0:
+        case 1:
+            queries.push_back({path, true});
+            break;
+        case 2:
+            std::transform(path.begin(), path.end(), path.begin(),
+                           [](char ch) { return ch >= 'a' && ch <= 'z' ? static_cast<char>(ch - 'a' + 'A') : ch; });
+            queries.push_back({path, true});
+            break;
+        default:
+            queries.push_back({path + ".missing", false});
+            break;
+        }
+    }
+    return queries;
+}
+
+// Counts the regular files and bytes under dir
+void MeasureTree(const std::filesystem::path &dir, uint64_t &files, uint64_t &bytes) {
+    files = 0;
+    bytes = 0;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(dir, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            ++files;
+            bytes += it->file_size(ec);
+        }
+    }
+}
+
+// Runs every measurement against fixture and returns its JSON object; ok is cleared on any failure
+std::string RunFixture(const Fixture &fixture, const Settings &settings, bool &ok) {
+    const std::filesystem::path destDir     = settings.workDir / ("extract-" + fixture.name);
+    const std::string           isoPath     = fixture.imagePath.string();
+    const uint64_t              expectFiles = fixture.writer->entries().size();
+
+    std::vector<double> openMs, listMs, extractMs, lookupNs;
+    size_t              listed       = 0;
+    size_t              lookupErrors = 0;
+    bool                verified     = true;
+
+    for (unsigned iteration = 0; iteration < settings.iterations; ++iteration) {
+        std::cerr << "  " << fixture.name << ": iteración " << (iteration + 1) << "/" << settings.iterations << "\n";
+        ImageUnderTest image;
+
+        auto start = Clock::now();
+        if (!image.open(isoPath)) {
+            std::cerr << "Error: no se pudo abrir " << isoPath << "\n";
+            ok = false;
+            return "{\"name\": " + JsonString(fixture.name) + ", \"error\": \"open failed\"}";
+        }
+        openMs.push_back(ElapsedMs(start));
+
+        start                                = Clock::now();
+        const std::vector<std::string> paths = image.list();
+        listMs.push_back(ElapsedMs(start));
+        listed = paths.size();
+
+        const std::vector<LookupQuery> queries = MakeQueries(paths, settings.lookups);
+        for (const auto &query : queries) {
+            const auto lookupStart = Clock::now();
+            const bool found       = image.exists(query.path);
+            lookupNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - lookupStart).count());
+            if (found != query.expected)
+                ++lookupErrors;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove_all(destDir, ec);
+        start              = Clock::now();
+        const bool success = image.extractAll(destDir.string());
+        extractMs.push_back(ElapsedMs(start));
+        image.close();
+
+        uint64_t files = 0, bytes = 0;
+        MeasureTree(destDir, files, bytes);
+        if (!success || files != expectFiles || bytes != fixture.dataBytes) {
+            std::cerr << "Error: extracción incompleta de " << fixture.name << " (" << files << "/" << expectFiles
+                      << " archivos, " << bytes << "/" << fixture.dataBytes << " bytes)\n";
+            verified = false;
+        }
+        std::filesystem::remove_all(destDir, ec);
+    }
+    if (lookupErrors != 0 || !verified)
+        ok = false;
+
+    const Summary open    = Summarize(openMs);
+    const Summary list    = Summarize(listMs);
+    const Summary extract = Summarize(extractMs);
+    std::sort(lookupNs.begin(), lookupNs.end());
+    double lookupTotal = 0;
+    for (const double ns : lookupNs)
+        lookupTotal += ns;
+    const double extractSeconds = extract.median / 1000.0;
+    const double listSeconds    = list.median / 1000.0;
+
+    std::ostringstream json;
+    json << "    {\n"
+         << "      \"name\": " << JsonString(fixture.name) << ",\n"
+         << "      \"description\": " << JsonString(fixture.description) << ",\n"
+         << "      \"image\": {\"bytes\": " << fixture.imageBytes << ", \"files\": " << expectFiles
+         << ", \"directories\": " << fixture.writer->directoryCount() << ", \"data_bytes\": " << fixture.dataBytes
+         << ", \"generate_ms\": " << JsonNumber(fixture.generateMs) << "},\n"
+         << "      \"open_ms\": " << JsonSummary(open) << ",\n"
+         << "      \"list\": {\"entries\": " << listed << ", \"ms\": " << JsonSummary(list) << ", \"entries_per_s\": "
+         << JsonNumber(listSeconds > 0 ? static_cast<double>(listed) / listSeconds : 0, 0) << "},\n"
+         << "      \"lookup\": {\"queries\": " << lookupNs.size() << ", \"errors\": " << lookupErrors
+         << ", \"mean_ns\": " << JsonNumber(lookupNs.empty() ? 0 : lookupTotal / static_cast<double>(lookupNs.size()), 1)
+         << ", \"median_ns\": " << JsonNumber(Percentile(lookupNs, 0.5), 1)
+         << ", \"p99_ns\": " << JsonNumber(Percentile(lookupNs, 0.99), 1) << "},\n"
+         << "      \"extract\": {\"files\": " << expectFiles << ", \"bytes\": " << fixture.dataBytes
+         << ", \"ms\": " << JsonSummary(extract) << ", \"mb_per_s\": "
+         << JsonNumber(extractSeconds > 0 ? static_cast<double>(fixture.dataBytes) / 1e6 / extractSeconds : 0, 1)
+         << ", \"files_per_s\": "
+         << JsonNumber(extractSeconds > 0 ? static_cast<double>(expectFiles) / extractSeconds : 0, 0)
+         << ", \"verified\": " << (verified ? "true" : "false") << "}\n"
+         << "    }";
+    return json.str();
+}
+
+void printUsage() {
+    std::cout << "Uso: BenchISOReader [opciones]\n\n"
+              << "  --work DIR          directorio de imágenes y extracción (por defecto: <temp>/BenchISOReader)\n"
+              << "  --iterations N      repeticiones por medición (por defecto: 3)\n"
+              << "  --small-files N     archivos de la imagen small-files (por defecto: 20000)\n"
+              << "  --large-size TAMAÑO install.wim de la imagen large-files (por defecto: 1g)\n"
+              << "  --lookups N         búsquedas por iteración (por defecto: 20000)\n"
+              << "  --only NOMBRE       solo small-files o large-files (para medir el pico de RSS de cada una)\n"
+              << "  --regenerate        volver a generar las imágenes aunque existan\n"
+              << "  --output ARCHIVO    escribir el JSON en ARCHIVO en lugar de la salida estándar\n";
+}
+
+bool parseCount(const char *text, uint64_t &value) {
+    char *end = nullptr;
+    value     = std::strtoull(text, &end, 10);
+    return end && *end == '\0' && end != text && value > 0;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg    = argv[i];
+        const char       *value  = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint64_t          number = 0;
+        bool              ok     = true;
+        if (arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "--regenerate") {
+            settings.regenerate = true;
+            continue;
+        } else if (!value) {
+            ok = false;
+        } else if (arg == "--work") {
+            settings.workDir = std::filesystem::u8path(value);
+        } else if (arg == "--iterations") {
+            ok                  = parseCount(value, number);
+            settings.iterations = static_cast<unsigned>(number);
+        } else if (arg == "--small-files") {
+            ok                  = parseCount(value, number);
+            settings.smallFiles = static_cast<size_t>(number);
+        } else if (arg == "--large-size") {
+            ok = ParseISOSize(value, settings.largeSize);
+        } else if (arg == "--lookups") {
+            ok               = parseCount(value, number);
+            settings.lookups = static_cast<size_t>(number);
+        } else if (arg == "--only") {
+            settings.only = value;
+            ok            = settings.only == "small-files" || settings.only == "large-files";
+        } else if (arg == "--output") {
+            settings.outputPath = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Error: opción no válida: " << arg << (value ? std::string(" ") + value : "") << "\n\n";
+            printUsage();
+            return 1;
+        }
+        ++i;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(settings.workDir, ec);
+    if (ec) {
+        std::cerr << "Error: no se pudo crear " << settings.workDir.string() << "\n";
+        return 1;
+    }
+
+    std::vector<Fixture> fixtures;
+    if (settings.only.empty() || settings.only == "small-files") {
+        Fixture fixture;
+        fixture.name        = "small-files";
+        fixture.description = "random layout, " + std::to_string(settings.smallFiles) + " files of 512 B-64 KiB";
+        ISORandomLayout layout;
+        layout.fileCount   = settings.smallFiles;
+        layout.maxDepth    = 5;
+        layout.filesPerDir = 32;
+        ISOSizeDistribution::parse("log:512-64k", layout.sizes);
+        AddRandomLayout(*fixture.writer, layout);
+        fixtures.push_back(std::move(fixture));
+    }
+    if (settings.only.empty() || settings.only == "large-files") {
+        Fixture fixture;
+        fixture.name        = "large-files";
+        fixture.description = "Windows installation layout, " + std::to_string(settings.largeSize >> 20) +
+                              " MiB install.wim";
+        AddWindowsLayout(*fixture.writer, settings.largeSize);
+        fixtures.push_back(std::move(fixture));
+    }
+
+    for (auto &fixture : fixtures) {
+        if (!PrepareImage(fixture, settings))
+            return 1;
+    }
+
+    bool        ok = true;
+    std::string results;
+    for (const auto &fixture : fixtures) {
+        if (!results.empty())
+            results += ",\n";
+        results += RunFixture(fixture, settings, ok);
+    }
+
+    // Peak RSS is a high-water mark of the whole process, image generation included, so it is only reported
+    // once; comparing fixtures takes one run per fixture (--only)
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"BenchISOReader\",\n"
+         << "  \"timestamp\": " << JsonString(UtcTimestamp()) << ",\n"
+         << "  \"reader\": " << JsonString(ImageUnderTest::readerName()) << ",\n"
+#ifdef _WIN32
+         << "  \"platform\": \"windows\",\n"
+#else
+         << "  \"platform\": \"posix\",\n"
+#endif
+         << "  \"iterations\": " << settings.iterations << ",\n"
+         << "  \"lookups\": " << settings.lookups << ",\n"
+         << "  \"page_cache\": \"warm\",\n"
+         << "  \"fixtures\": [\n"
+         << results << "\n"
+         << "  ],\n"
+         << "  \"peak_rss_kb\": " << PeakRssKb() << "\n"
+         << "}\n";
+
+    if (settings.outputPath.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream output(settings.outputPath, std::ios::binary | std::ios::trunc);
+        output << json.str();
+        if (!output.good()) {
+            std::cerr << "Error: no se pudo escribir " << settings.outputPath << "\n";
+            return 1;
+        }
+        std::cerr << "[OK] Resultados en " << settings.outputPath << "\n";
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+/**
+ * Generador de imágenes ISO sintéticas para pruebas y benchmarks
+ *
+ * Escribe una imagen ISO9660 (+ Joliet) con puente UDF 2.01 y una de estas distribuciones:
+ * - windows: medio de instalación de Windows (sources/boot.wim, sources/install.wim, efi/boot/bootx64.efi...)
+ * - linux:   medio live de Linux (casper/, boot/grub/, efi/boot/, isolinux/, pool/)
+ * - random:  árbol aleatorio con cantidad de archivos, tamaños y profundidad configurables
+ *
+ * El contenido es determinista (depende de la semilla), así que las pruebas pueden recalcular
+ * los bytes esperados con ISOImageWriter::fillContent.
+ */
+
+#include "ISOImageWriter.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+void printUsage() {
+    std::cout << "Uso: GenerateTestISO <salida.iso> [opciones]\n\n"
+              << "  --layout windows|linux|random  distribución de archivos (por defecto: random)\n"
+              << "  --files N                      cantidad de archivos (random)\n"
+              << "  --depth N                      profundidad máxima de directorios (random)\n"
+              << "  --per-dir N                    archivos por directorio en promedio (random)\n"
+              << "  --sizes SPEC                   tamaños: fixed:4k | uniform:1k-64k | log:512-1m (random)\n"
+              << "  --unicode                      incluir nombres fuera de Latin-1 (random)\n"
+              << "  --big-size TAMAÑO              install.wim (windows) o filesystem.squashfs (linux)\n"
+              << "  --seed N                       semilla del contenido\n"
+              << "  --label TEXTO                  etiqueta del volumen\n"
+              << "  --no-joliet                    sin árbol Joliet\n"
+              << "  --no-udf                       solo ISO9660\n"
+              << "  --hybrid                       MBR híbrido (isohybrid) en el área de sistema\n"
+              << "  --zero                         archivos a ceros (con --sparse la imagen ocupa solo metadatos)\n"
+              << "  --sparse                       dejar huecos en lugar de escribir ceros\n"
+              << "  --list ARCHIVO                 escribir \"tamaño<TAB>ruta\" de cada archivo\n";
+}
+
+bool parseCount(const char *text, uint64_t &value) {
+    char *end = nullptr;
+    value     = std::strtoull(text, &end, 10);
+    return end && *end == '\0' && end != text;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "--help") {
+        printUsage();
+        return argc < 2 ? 1 : 0;
+    }
+
+    const std::string       outputPath = argv[1];
+    std::string             layoutName = "random";
+    std::string             listPath;
+    uint64_t                bigSize     = 64ULL << 20;
+    bool                    zeroContent = false;
+    ISORandomLayout         random;
+    ISOImageWriter::Options options;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg    = argv[i];
+        const char       *value  = i + 1 < argc ? argv[i + 1] : nullptr;
+        uint64_t          number = 0;
+        bool              ok     = true;
+        if (arg == "--no-joliet") {
+            options.joliet = false;
+            continue;
+        } else if (arg == "--no-udf") {
+            options.udf = false;
+            continue;
+        } else if (arg == "--hybrid") {
+            options.hybridMbr = true;
+            continue;
+        } else if (arg == "--sparse") {
+            options.sparse = true;
+            continue;
+        } else if (arg == "--zero") {
+            zeroContent = true;
+            continue;
+        } else if (arg == "--unicode") {
+            random.unicodeNames = true;
+            continue;
+        } else if (!value) {
+            ok = false;
+        } else if (arg == "--layout") {
+            layoutName = value;
+            ok         = layoutName == "windows" || layoutName == "linux" || layoutName == "random";
+        } else if (arg == "--files") {
+            ok               = parseCount(value, number);
+            random.fileCount = static_cast<size_t>(number);
+        } else if (arg == "--depth") {
+            ok              = parseCount(value, number);
+            random.maxDepth = static_cast<unsigned>(number);
+        } else if (arg == "--per-dir") {
+            ok                 = parseCount(value, number) && number > 0;
+            random.filesPerDir = static_cast<size_t>(number);
+        } else if (arg == "--sizes") {
+            ok = ISOSizeDistribution::parse(value, random.sizes);
+        } else if (arg == "--big-size") {
+            ok = ParseISOSize(value, bigSize);
+        } else if (arg == "--seed") {
+            ok          = parseCount(value, number);
+            random.seed = number;
+        } else if (arg == "--label") {
+            options.volumeLabel = value;
+        } else if (arg == "--list") {
+            listPath = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Error: opción no válida: " << arg << (value ? std::string(" ") + value : "") << "\n\n";
+            printUsage();
+            return 1;
+        }
+        ++i;
+    }
+
+    ISOImageWriter writer;
+    if (layoutName == "windows")
+        AddWindowsLayout(writer, bigSize, random.seed);
+    else if (layoutName == "linux")
+        AddLinuxLayout(writer, bigSize, random.seed);
+    else
+        AddRandomLayout(writer, random);
+
+    if (zeroContent) {
+        const std::vector<ISOImageWriter::Entry> generated = writer.entries();
+        for (const auto &entry : generated) {
+            if (entry.content != ISOImageWriter::Content::Literal)
+                writer.addFile(entry.path, entry.size, entry.seed, ISOImageWriter::Content::Zero);
+        }
+    }
+
+    uint64_t totalBytes = 0;
+    for (const auto &entry : writer.entries())
+        totalBytes += entry.size;
+    std::cout << "Generando " << outputPath << ": " << writer.entries().size() << " archivos, "
+              << writer.directoryCount() << " directorios, " << (totalBytes >> 20) << " MB de datos ("
+              << (writer.imageSize(options) >> 20) << " MB de imagen)\n";
+
+    std::string error;
+    if (!writer.write(outputPath, options, &error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    if (!listPath.empty()) {
+        std::ofstream list(listPath, std::ios::binary | std::ios::trunc);
+        for (const auto &entry : writer.entries())
+            list << entry.size << '\t' << entry.path << '\n';
+        if (!list.good()) {
+            std::cerr << "Error: no se pudo escribir " << listPath << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "[OK] Imagen generada\n";
+    return 0;
+}